@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/grammar.hpp"
+#include "../include/slr1_parser.hpp"
+#include "generated/grammar_2_slr.hpp"
+
+// Direct-coded (codegen slr) vs table-driven SLR(1) parsing of
+// examples/grammar_2.txt. Regenerate the parser with:
+//   load examples/grammar_2.txt
+//   codegen slr bench/generated/grammar_2_slr.cpp
+
+namespace {
+
+using namespace grammar_2_slr;
+
+/// Appends a random expression of roughly `budget` tokens.
+void RandomExpression(std::mt19937& rng, size_t budget, int depth,
+                      std::vector<int>& out) {
+    size_t start = out.size();
+    do {
+        if (out.size() != start) {
+            out.push_back(TOK_plus);
+        }
+        if (depth < 16 && rng() % 4 == 0) {
+            out.push_back(TOK_ap);
+            RandomExpression(rng, budget / 4, depth + 1, out);
+            out.push_back(TOK_cp);
+        } else {
+            out.push_back(TOK_n);
+        }
+    } while (out.size() - start < budget);
+}
+
+std::vector<int> Input(size_t tokens) {
+    std::mt19937     rng(7);
+    std::vector<int> input;
+    RandomExpression(rng, tokens, 0, input);
+    return input;
+}
+
+const SLR1Parser& TableParser() {
+    static SLR1Parser parser = [] {
+        Grammar gr;
+        gr.ReadFromFile(PLSHELL_EXAMPLES_DIR "/grammar_2.txt");
+        SLR1Parser p(gr);
+        p.MakeParser();
+        return p;
+    }();
+    return parser;
+}
+
+void BM_TableDriven(benchmark::State& state) {
+    const SLR1Parser&      parser = TableParser();
+    const std::vector<int> input  = Input(state.range(0));
+    if (!parser.table_.Parse(input)) {
+        state.SkipWithError("table-driven parser rejected the input");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.table_.Parse(input));
+    }
+    state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void BM_DirectCoded(benchmark::State& state) {
+    const std::vector<int> input = Input(state.range(0));
+    if (!Parse(input.data(), input.size())) {
+        state.SkipWithError("generated parser rejected the input");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Parse(input.data(), input.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_TableDriven)->Range(64, 64 << 10);
+BENCHMARK(BM_DirectCoded)->Range(64, 64 << 10);
@@ -0,0 +1,163 @@
+// SLR(1) parser generated by PLShell. Do not edit.
+#include "grammar_2_slr.hpp"
+
+namespace grammar_2_slr {
+
+bool Parse(const int* tokens, std::size_t n) {
+    unsigned    stack[kMaxDepth];
+    std::size_t sp  = 0;
+    std::size_t pos = 0;
+    int         tok = n > 0 ? tokens[0] : TOK_EOL;
+
+    goto state_0;
+
+state_0:
+    stack[sp] = 0;
+    switch (tok) {
+    case TOK_ap:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_3;
+    case TOK_n:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_4;
+    default:
+        return false;
+    }
+
+state_3:
+    stack[sp] = 3;
+    switch (tok) {
+    case TOK_ap:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_3;
+    case TOK_n:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_4;
+    default:
+        return false;
+    }
+
+state_4:
+    stack[sp] = 4;
+    switch (tok) {
+    default:
+        // T -> n
+        sp -= 1;
+        goto goto_2;
+    }
+
+state_2:
+    stack[sp] = 2;
+    switch (tok) {
+    default:
+        // E -> T
+        sp -= 1;
+        goto goto_1;
+    }
+
+state_5:
+    stack[sp] = 5;
+    switch (tok) {
+    case TOK_ap:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_3;
+    case TOK_n:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_4;
+    default:
+        return false;
+    }
+
+state_1:
+    stack[sp] = 1;
+    switch (tok) {
+    case TOK_EOL:
+        return pos >= n || (pos == n - 1 && tok == TOK_EOL);
+    case TOK_plus:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_5;
+    default:
+        return false;
+    }
+
+state_6:
+    stack[sp] = 6;
+    switch (tok) {
+    case TOK_cp:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_8;
+    case TOK_plus:
+        if (pos >= n || ++sp == kMaxDepth)
+            return false;
+        tok = ++pos < n ? tokens[pos] : TOK_EOL;
+        goto state_5;
+    default:
+        return false;
+    }
+
+state_7:
+    stack[sp] = 7;
+    switch (tok) {
+    default:
+        // E -> E plus T
+        sp -= 3;
+        goto goto_1;
+    }
+
+state_8:
+    stack[sp] = 8;
+    switch (tok) {
+    default:
+        // T -> ap E cp
+        sp -= 3;
+        goto goto_2;
+    }
+
+goto_1: // E
+    switch (stack[sp]) {
+    case 0:
+        if (++sp == kMaxDepth)
+            return false;
+        goto state_1;
+    case 3:
+        if (++sp == kMaxDepth)
+            return false;
+        goto state_6;
+    default:
+        return false;
+    }
+
+goto_2: // T
+    switch (stack[sp]) {
+    case 0:
+    case 3:
+        if (++sp == kMaxDepth)
+            return false;
+        goto state_2;
+    case 5:
+        if (++sp == kMaxDepth)
+            return false;
+        goto state_7;
+    default:
+        return false;
+    }
+
+}
+
+} // namespace grammar_2_slr
@@ -0,0 +1,24 @@
+// SLR(1) parser generated by PLShell. Do not edit.
+#pragma once
+
+#include <cstddef>
+
+namespace grammar_2_slr {
+
+/// Terminal ids. The input must be a sequence of these values,
+/// optionally terminated by TOK_EOL.
+enum Token : int {
+    TOK_EOL = 0, // $
+    TOK_ap = 1, // ap
+    TOK_cp = 2, // cp
+    TOK_n = 3, // n
+    TOK_plus = 4, // plus
+};
+
+/// Maximum nesting depth, Parse fails when it is exceeded.
+constexpr std::size_t kMaxDepth = 4096;
+
+/// Returns true if the tokens are a sentence of the grammar.
+bool Parse(const int* tokens, std::size_t n);
+
+} // namespace grammar_2_slr
@@ -0,0 +1,600 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "../include/first_follow.hpp"
+#include "../include/grammar.hpp"
+#include "../include/grammar_factory.hpp"
+#include "../include/ll1_parser.hpp"
+#include "../include/slr1_parser.hpp"
+#include "../include/stats.hpp"
+#include "../include/symbol_index.hpp"
+
+// Every analysis phase over examples/*.txt and over generated grammars of
+// increasing size. Besides time, each benchmark reports the heap allocations
+// (and bytes) per iteration, counted by the operator new of heap_counter.cpp.
+// Only the heap counters are enabled: phase timers stay off, so that they do
+// not add to the times.
+
+namespace {
+
+/// Sizes (non-terminals) of the generated grammars.
+const std::vector<unsigned> kGeneratedSizes{16, 64, 256};
+
+/// Sizes of the generated SLR(1) grammars used to measure parsing throughput.
+const std::vector<unsigned> kParseSizes{64, 256, 1024};
+
+/// Precedence levels of the generated expression grammars, whose unit rule
+/// chains are what the unit rule bypass skips.
+const std::vector<unsigned> kStratifiedLevels{4, 16, 64};
+
+/// Sizes of the generated grammars used to compare sequential and parallel
+/// FIRST/FOLLOW.
+const std::vector<unsigned> kFirstFollowSizes{1024, 4096};
+
+/// Rules of the generated grammar edited by the incremental benchmarks.
+constexpr unsigned kEditedRules = 2048;
+
+/// Tokens of the inputs used to measure parsing throughput.
+constexpr size_t kParseTokens = 64 << 10;
+
+std::uint64_t Allocations() {
+    return stats::HeapAllocations();
+}
+
+std::uint64_t Bytes() {
+    return stats::HeapBytes();
+}
+
+/**
+ * Counts the allocations made while it is alive and reports them per
+ * iteration. Allocations made between `Pause` and `Resume` (which also stop
+ * the timer) are not counted.
+ */
+class AllocationCounter {
+  public:
+    explicit AllocationCounter(benchmark::State& state)
+        : state_(state), allocations_(Allocations()),
+          bytes_(Bytes()) {}
+
+    ~AllocationCounter() {
+        using benchmark::Counter;
+        state_.counters["allocs"] =
+            Counter(Allocations() - allocations_,
+                    Counter::kAvgIterations);
+        state_.counters["bytes"] =
+            Counter(Bytes() - bytes_, Counter::kAvgIterations);
+    }
+
+    void Pause() {
+        state_.PauseTiming();
+        paused_allocations_ = Allocations();
+        paused_bytes_       = Bytes();
+    }
+
+    void Resume() {
+        allocations_ += Allocations() - paused_allocations_;
+        bytes_ += Bytes() - paused_bytes_;
+        state_.ResumeTiming();
+    }
+
+  private:
+    benchmark::State& state_;
+    size_t            allocations_;
+    size_t            bytes_;
+    size_t            paused_allocations_ = 0;
+    size_t            paused_bytes_       = 0;
+};
+
+struct Case {
+    std::string name;
+    /// Path of the grammar file, empty for generated grammars.
+    std::string              path;
+    std::function<Grammar()> make;
+};
+
+Grammar Generated(unsigned n) {
+    GrammarFactory::Params params;
+    params.non_terminals = n;
+    params.terminals     = 8 + n / 8;
+    params.rules         = 3 * n;
+    return GrammarFactory().Generate(params);
+}
+
+/// `Generated(n)` with a terminal of its own at the start of every rule,
+/// which makes it LR(0).
+Grammar GeneratedSLR1(unsigned n) {
+    GrammarFactory::Params params;
+    params.non_terminals = n;
+    params.terminals     = 8 + n / 8;
+    params.rules         = 3 * n;
+    params.keyed         = true;
+    return GrammarFactory().Generate(params);
+}
+
+/**
+ * Expression grammar with one binary operator per precedence level, as in
+ * examples/grammar_4.txt: `E<i> -> E<i> o<i> E<i+1> | E<i+1>` down to
+ * `E<levels> -> ap E0 cp | n`. A lone operand is reduced through a chain of
+ * `levels` unit rules.
+ */
+Grammar Stratified(unsigned levels) {
+    Grammar gr;
+    auto    level = [](unsigned i) { return "E" + std::to_string(i); };
+    gr.axiom_     = "S";
+    gr.st_.PutSymbol(gr.axiom_);
+    gr.order.push_back(gr.axiom_);
+    for (unsigned i = 0; i <= levels; ++i) {
+        gr.st_.PutSymbol(level(i));
+        gr.order.push_back(level(i));
+    }
+    for (const std::string terminal : {"ap", "cp", "n"}) {
+        gr.st_.PutSymbol(terminal, terminal);
+    }
+    gr.AddProduction(gr.axiom_, {level(0), gr.st_.EOL_});
+    for (unsigned i = 0; i < levels; ++i) {
+        const std::string op = "o" + std::to_string(i);
+        gr.st_.PutSymbol(op, op);
+        gr.AddProduction(level(i), {level(i), op, level(i + 1)});
+        gr.AddProduction(level(i), {level(i + 1)});
+    }
+    gr.AddProduction(level(levels), {"ap", level(0), "cp"});
+    gr.AddProduction(level(levels), {"n"});
+    return gr;
+}
+
+std::vector<Case> Cases() {
+    std::vector<Case>                  cases;
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry :
+         std::filesystem::directory_iterator(PLSHELL_EXAMPLES_DIR)) {
+        if (entry.path().extension() == ".txt") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    for (const std::filesystem::path& file : files) {
+        cases.push_back({file.stem().string(), file.string(), [file] {
+                             Grammar gr;
+                             gr.ReadFromFile(file.string());
+                             return gr;
+                         }});
+    }
+    for (unsigned n : kGeneratedSizes) {
+        cases.push_back({"generated_" + std::to_string(n), "",
+                         [n] { return Generated(n); }});
+    }
+    return cases;
+}
+
+/// Grammars of `Parse` and `ParseUnitBypass`: the SLR(1) examples, generated
+/// SLR(1) grammars of increasing size and stratified expression grammars.
+std::vector<Case> ParseCases(const std::vector<Case>& cases) {
+    std::vector<Case> parse;
+    for (const Case& c : cases) {
+        if (!c.path.empty() && SLR1Parser(c.make()).MakeParser()) {
+            parse.push_back(c);
+        }
+    }
+    for (unsigned n : kParseSizes) {
+        parse.push_back({"generated_slr1_" + std::to_string(n), "",
+                         [n] { return GeneratedSLR1(n); }});
+    }
+    for (unsigned levels : kStratifiedLevels) {
+        parse.push_back({"stratified_" + std::to_string(levels), "",
+                         [levels] { return Stratified(levels); }});
+    }
+    return parse;
+}
+
+/**
+ * Random sentence of about `target` tokens (without EOL). Non-terminals are
+ * expanded at random, with rules that have non-terminals if there are any,
+ * until the target is reached and then with the rule of shortest yield, so
+ * the derivation always ends.
+ */
+std::vector<int> Sentence(const SymbolIndex& index, size_t target) {
+    const int                          n_terminals = index.terminals_.size();
+    const size_t                       n = index.non_terminals_.size();
+    std::vector<std::vector<unsigned>> rules(n);
+    std::vector<std::vector<unsigned>> growing(n);
+    for (unsigned r = 0; r < index.rules_.size(); ++r) {
+        rules[index.rules_[r].lhs_].push_back(r);
+        const std::vector<int>& rhs = index.rules_[r].rhs_;
+        if (std::any_of(rhs.begin(), rhs.end(),
+                        [&](int s) { return s >= n_terminals; })) {
+            growing[index.rules_[r].lhs_].push_back(r);
+        }
+    }
+
+    // Shortest yield of every non-terminal, only updated on strict
+    // improvements so that following `shortest` always terminates
+    constexpr size_t      kInf = std::numeric_limits<size_t>::max();
+    std::vector<size_t>   yield(n, kInf);
+    std::vector<unsigned> shortest(n);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (unsigned r = 0; r < index.rules_.size(); ++r) {
+            size_t len = 0;
+            for (int s : index.rules_[r].rhs_) {
+                const size_t y = s < n_terminals ? 1 : yield[s - n_terminals];
+                len = y == kInf || len == kInf ? kInf : len + y;
+            }
+            const int lhs = index.rules_[r].lhs_;
+            if (len < yield[lhs]) {
+                yield[lhs]    = len;
+                shortest[lhs] = r;
+                changed       = true;
+            }
+        }
+    }
+
+    std::mt19937     rng(7);
+    std::vector<int> out;
+    std::vector<int> pending{n_terminals}; // the axiom
+    while (!pending.empty()) {
+        const int s = pending.back();
+        pending.pop_back();
+        if (s < n_terminals) {
+            if (s != 0) {
+                out.push_back(s);
+            }
+            continue;
+        }
+        // Below the target, rules that keep non-terminals, so that the
+        // derivation does not end before reaching it. Pending symbols count
+        // towards the target, so left recursion stops growing too.
+        const std::vector<unsigned>& candidates =
+            growing[s - n_terminals].empty() ? rules[s - n_terminals]
+                                             : growing[s - n_terminals];
+        const unsigned r = out.size() + pending.size() < target
+                               ? candidates[rng() % candidates.size()]
+                               : shortest[s - n_terminals];
+        const std::vector<int>& rhs = index.rules_[r].rhs_;
+        pending.insert(pending.end(), rhs.rbegin(), rhs.rend());
+    }
+    return out;
+}
+
+void BM_Load(benchmark::State& state, const Case& c) {
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        Grammar gr;
+        benchmark::DoNotOptimize(gr.ReadFromFile(c.path));
+    }
+}
+
+void BM_Split(benchmark::State& state, const Case& c) {
+    Grammar                  gr = c.make();
+    std::vector<std::string> consequents;
+    for (const auto& [nt, productions] : gr.g_) {
+        for (const production& prod : productions) {
+            std::string joined;
+            for (const std::string& symbol : prod) {
+                joined += symbol;
+            }
+            consequents.push_back(joined);
+        }
+    }
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        for (const std::string& consequent : consequents) {
+            benchmark::DoNotOptimize(gr.Split(consequent));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * consequents.size());
+}
+
+void BM_First(benchmark::State& state, const Case& c) {
+    LL1Parser         parser(c.make());
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        parser.ComputeFirstSets();
+        benchmark::ClobberMemory();
+    }
+}
+
+void BM_Follow(benchmark::State& state, const Case& c) {
+    LL1Parser         parser(c.make());
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        parser.ComputeFollowSets();
+        benchmark::ClobberMemory();
+    }
+}
+
+// Sequential FIRST and FOLLOW, against `first_follow::Compute` with
+// `state.range(0)` threads.
+void BM_FirstFollow(benchmark::State& state, const Grammar& gr) {
+    LL1Parser         parser(gr);
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        parser.ComputeFirstSets();
+        parser.ComputeFollowSets();
+        benchmark::ClobberMemory();
+    }
+}
+
+void BM_FirstFollowParallel(benchmark::State& state, const Grammar& gr) {
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(first_follow::Compute(gr, state.range(0)));
+    }
+}
+
+// Removing a rule from a loaded grammar and adding it back, which updates
+// FIRST, FOLLOW and the tables incrementally, against loading it again. The
+// grammar is SLR(1), so the edits patch the flat tables too.
+struct Edit {
+    Grammar     gr;
+    std::string antecedent;
+    production  consequent;
+};
+
+/// `GeneratedSLR1` with `kEditedRules` rules, editing the last rule of a
+/// non-terminal that keeps another one.
+Edit EditedGrammar() {
+    Edit edit{GeneratedSLR1(kEditedRules / 3), "", {}};
+    for (const auto& [antecedent, rules] : edit.gr.g_) {
+        if (antecedent != edit.gr.axiom_ && rules.size() > 1 &&
+            antecedent >= "N100") {
+            edit.antecedent = antecedent;
+            edit.consequent = rules.back();
+            break;
+        }
+    }
+    return edit;
+}
+
+void BM_EditLL1(benchmark::State& state) {
+    const Edit edit = EditedGrammar();
+    LL1Parser  parser(edit.gr);
+    parser.CreateLL1Table();
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        parser.RemoveRule(edit.antecedent, edit.consequent);
+        parser.AddRule(edit.antecedent, edit.consequent);
+    }
+}
+
+void BM_EditSLR1(benchmark::State& state) {
+    const Edit edit = EditedGrammar();
+    SLR1Parser parser(edit.gr);
+    parser.MakeParser();
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        parser.RemoveRule(edit.antecedent, edit.consequent);
+        parser.AddRule(edit.antecedent, edit.consequent);
+    }
+}
+
+void BM_RebuildAfterEdit(benchmark::State& state) {
+    Edit edit = EditedGrammar();
+    edit.gr.RemoveRule(edit.antecedent, edit.consequent);
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        LL1Parser ll1(edit.gr);
+        benchmark::DoNotOptimize(ll1.CreateLL1Table());
+        SLR1Parser slr1(edit.gr);
+        benchmark::DoNotOptimize(slr1.MakeParser());
+    }
+}
+
+void BM_CreateLL1Table(benchmark::State& state, const Case& c) {
+    const LL1Parser   prototype(c.make());
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        counter.Pause();
+        LL1Parser parser(prototype);
+        counter.Resume();
+        benchmark::DoNotOptimize(parser.CreateLL1Table());
+    }
+}
+
+void BM_Closure(benchmark::State& state, const Case& c) {
+    SLR1Parser parser(c.make());
+    parser.MakeParser();
+    // Closure of the kernel of every state of the automaton
+    std::vector<std::unordered_set<Lr0Item>> kernels;
+    for (const auto& st : parser.states_) {
+        std::unordered_set<Lr0Item> kernel;
+        for (const Lr0Item& item : st.items_) {
+            if (item.dot_ > 0 || item.antecedent_ == parser.gr_.axiom_) {
+                kernel.insert(item);
+            }
+        }
+        kernels.push_back(std::move(kernel));
+    }
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        for (const auto& kernel : kernels) {
+            std::unordered_set<Lr0Item> items(kernel);
+            parser.Closure(items);
+            benchmark::DoNotOptimize(items);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kernels.size());
+}
+
+void BM_MakeParser(benchmark::State& state, const Case& c) {
+    const Grammar     gr = c.make();
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        counter.Pause();
+        SLR1Parser parser(gr);
+        counter.Resume();
+        benchmark::DoNotOptimize(parser.MakeParser());
+    }
+}
+
+void BM_MakeParserParallel(benchmark::State& state, const Case& c) {
+    const Grammar     gr = c.make();
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        counter.Pause();
+        SLR1Parser parser(gr);
+        parser.threads_ = std::max(2u, std::thread::hardware_concurrency());
+        counter.Resume();
+        benchmark::DoNotOptimize(parser.MakeParser());
+    }
+}
+
+void BM_Parse(benchmark::State& state, const Case& c) {
+    SLR1Parser parser(c.make());
+    if (!parser.MakeParser()) {
+        state.SkipWithError("grammar is not SLR(1)");
+        return;
+    }
+    const std::vector<int> input = Sentence(parser.index_, kParseTokens);
+    if (!parser.table_.Parse(input)) {
+        state.SkipWithError("parser rejected the generated sentence");
+        return;
+    }
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.table_.Parse(input));
+    }
+    state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+/// Parse with the unit rule bypass off (`state.range(0) == 0`) or on, with
+/// the reductions per token of the input.
+void BM_ParseUnitBypass(benchmark::State& state, const Case& c) {
+    SLR1Parser parser(c.make());
+    parser.bypass_unit_rules_ = state.range(0) != 0;
+    if (!parser.MakeParser()) {
+        state.SkipWithError("grammar is not SLR(1)");
+        return;
+    }
+    const std::vector<int> input = Sentence(parser.index_, kParseTokens);
+    LRTable::ParseStats    stats;
+    if (!parser.table_.Parse(input, &stats)) {
+        state.SkipWithError("parser rejected the generated sentence");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.table_.Parse(input));
+    }
+    state.SetItemsProcessed(state.iterations() * input.size());
+    state.counters["reductions/token"] =
+        static_cast<double>(stats.reductions) / input.size();
+    state.counters["bypassed_gotos"] = parser.unit_bypasses_;
+}
+
+/**
+ * Whether every parse case builds an SLR(1) parser, with and without the unit
+ * rule bypass, that accepts a generated sentence of about `kParseTokens`
+ * tokens. A case that did not would only be skipped by `Parse` or
+ * `ParseUnitBypass`, or measured on a tiny input, and its numbers would
+ * silently be missing.
+ */
+bool CheckParseCases(const std::vector<Case>& cases) {
+    for (const Case& c : cases) {
+        for (bool bypass : {false, true}) {
+            SLR1Parser parser(c.make());
+            parser.bypass_unit_rules_ = bypass;
+            if (!parser.MakeParser()) {
+                std::cerr << "plshell_bench: " << c.name
+                          << " is not SLR(1)\n";
+                return false;
+            }
+            const std::vector<int> input =
+                Sentence(parser.index_, kParseTokens);
+            if (input.size() < kParseTokens / 2) {
+                std::cerr << "plshell_bench: " << c.name
+                          << " only generated a " << input.size()
+                          << " token sentence\n";
+                return false;
+            }
+            if (!parser.table_.Parse(input)) {
+                std::cerr << "plshell_bench: the parser of " << c.name
+                          << (bypass ? " with the unit rule bypass" : "")
+                          << " rejects its generated sentence\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Register(const std::vector<Case>& cases,
+              const std::vector<Case>& parse_cases) {
+    using Phase = void (*)(benchmark::State&, const Case&);
+    const std::vector<std::pair<std::string, Phase>> phases{
+        {"Split", BM_Split},
+        {"First", BM_First},
+        {"Follow", BM_Follow},
+        {"CreateLL1Table", BM_CreateLL1Table},
+        {"Closure", BM_Closure},
+        {"MakeParser", BM_MakeParser},
+        {"MakeParserParallel", BM_MakeParserParallel},
+    };
+    for (const Case& c : cases) {
+        if (!c.path.empty()) {
+            benchmark::RegisterBenchmark(("Load/" + c.name).c_str(), BM_Load,
+                                         c)
+                ->Unit(benchmark::kMicrosecond);
+        }
+        for (const auto& [name, phase] : phases) {
+            benchmark::RegisterBenchmark((name + "/" + c.name).c_str(), phase,
+                                         c)
+                ->Unit(benchmark::kMicrosecond);
+        }
+    }
+    for (const Case& c : parse_cases) {
+        benchmark::RegisterBenchmark(("Parse/" + c.name).c_str(), BM_Parse, c)
+            ->Unit(benchmark::kMicrosecond);
+        benchmark::RegisterBenchmark(("ParseUnitBypass/" + c.name).c_str(),
+                                     BM_ParseUnitBypass, c)
+            ->Arg(0)
+            ->Arg(1)
+            ->Unit(benchmark::kMicrosecond);
+    }
+    benchmark::RegisterBenchmark("EditLL1", BM_EditLL1)
+        ->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("EditSLR1", BM_EditSLR1)
+        ->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("RebuildAfterEdit", BM_RebuildAfterEdit)
+        ->Unit(benchmark::kMicrosecond);
+    for (unsigned n : kFirstFollowSizes) {
+        const Grammar     gr   = Generated(n);
+        const std::string name = "/generated_" + std::to_string(n);
+        benchmark::RegisterBenchmark(("FirstFollow" + name).c_str(),
+                                     BM_FirstFollow, gr)
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("FirstFollowParallel" + name).c_str(),
+                                     BM_FirstFollowParallel, gr)
+            ->Arg(1)
+            ->Arg(2)
+            ->Arg(4)
+            ->Arg(8)
+            ->Unit(benchmark::kMillisecond);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    stats::heap_enabled = true;
+    static const std::vector<Case> cases       = Cases();
+    static const std::vector<Case> parse_cases = ParseCases(cases);
+    if (!CheckParseCases(parse_cases)) {
+        return 1;
+    }
+    Register(cases, parse_cases);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Batch analysis of grammar files.
+ *
+ * Each grammar is analyzed by a single task that owns its `Grammar`,
+ * `LL1Parser` and `SLR1Parser`, so a directory of grammars can be analyzed on
+ * a `ThreadPool` without sharing any state between tasks.
+ */
+namespace analysis {
+
+/**
+ * @brief Result of analyzing a grammar file.
+ */
+struct GrammarReport {
+    std::string path;
+    /// @brief Why the file could not be loaded, empty if it was.
+    std::string error;
+    std::size_t non_terminals = 0;
+    std::size_t terminals     = 0;
+    std::size_t rules         = 0;
+    bool        ll1           = false;
+    /// @brief LL(1) table cells with more than one production.
+    std::size_t ll1_conflicts = 0;
+    bool        slr1          = false;
+    /// @brief States of the LR(0) automaton.
+    std::size_t states = 0;
+    /// @brief Cells of the action table with a shift/reduce or reduce/reduce
+    /// conflict.
+    std::size_t slr1_conflicts = 0;
+    /// @brief Wall time of loading, of the LL(1) table (including FIRST and
+    /// FOLLOW) and of the SLR(1) automaton and tables, in milliseconds.
+    double load_ms = 0;
+    double ll1_ms  = 0;
+    double slr1_ms = 0;
+};
+
+/**
+ * @brief Loads a grammar file and builds its LL(1) table and SLR(1) parser.
+ *
+ * @param path Grammar file.
+ * @return The report of the grammar. If it could not be loaded, only `path`
+ * and `error` are set.
+ */
+GrammarReport AnalyzeGrammar(const std::string& path);
+
+/**
+ * @brief Analyzes every `.txt` file of a directory on a thread pool.
+ *
+ * @param dir Directory with the grammar files. It is not searched
+ * recursively.
+ * @param threads Number of workers, 0 for one per hardware thread.
+ * @return The reports of the grammars, sorted by path.
+ */
+std::vector<GrammarReport> AnalyzeDirectory(const std::string& dir,
+                                            unsigned           threads = 0);
+
+} // namespace analysis
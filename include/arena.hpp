@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+/**
+ * @brief Session arenas for the short-lived containers of an analysis.
+ *
+ * An `Arena` takes memory from the heap in growing blocks and gives all of it
+ * back at once when it is destroyed. Freed blocks are kept in size-class pools
+ * and reused, so a long session does not grow with every temporary it
+ * creates. An arena is not thread-safe: every thread installs its own with a
+ * `Scope`, and hot code builds its `std::pmr` containers on `Current()`.
+ * Without an arena installed, `Current()` is the default resource, which
+ * uses the global `operator new`.
+ */
+namespace arena {
+
+class Arena {
+  public:
+    /**
+     * @brief Creates an arena whose first block has `initial_bytes` bytes.
+     */
+    explicit Arena(std::size_t initial_bytes = 64 << 10)
+        : blocks_(initial_bytes), pools_(&blocks_) {}
+
+    Arena(const Arena&)            = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    std::pmr::memory_resource* Resource() { return &pools_; }
+
+  private:
+    std::pmr::monotonic_buffer_resource    blocks_;
+    std::pmr::unsynchronized_pool_resource pools_;
+};
+
+namespace detail {
+inline thread_local std::pmr::memory_resource* current = nullptr;
+} // namespace detail
+
+/// @brief Resource of the arena installed on the calling thread.
+inline std::pmr::memory_resource* Current() {
+    return detail::current ? detail::current
+                           : std::pmr::get_default_resource();
+}
+
+/**
+ * @brief Installs an arena on the calling thread for the lifetime of the
+ * scope, and restores the previous one afterwards. Containers built on the
+ * arena must not outlive the scope.
+ */
+class Scope {
+  public:
+    explicit Scope(Arena& arena) : previous_(detail::current) {
+        detail::current = arena.Resource();
+    }
+
+    ~Scope() { detail::current = previous_; }
+
+    Scope(const Scope&)            = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    std::pmr::memory_resource* previous_;
+};
+
+} // namespace arena
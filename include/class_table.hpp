@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Parse table compressed with row and column equivalence classes.
+ *
+ * Columns (terminals) whose cells are identical in every row are merged into a
+ * single column class, and then rows (states or non-terminals) that are
+ * identical over the column classes are merged into a single row class. A
+ * lookup goes through two small remap arrays and reads one cell of the merged
+ * table:
+ *
+ *     cells_[row_map_[row] * n_col_classes_ + col_map_[col]]
+ *
+ * Unlike row displacement, this compression is lossless: empty cells are kept,
+ * so it can be applied to any dense table (LL(1) or LR action tables).
+ */
+struct ClassTable {
+    ClassTable() = default;
+
+    /**
+     * @brief Compresses a dense, row-major table.
+     *
+     * @param dense Dense table with `rows * cols` cells.
+     * @param rows Number of rows.
+     * @param cols Number of columns.
+     */
+    ClassTable(const std::vector<int>& dense, unsigned rows, unsigned cols);
+
+    /**
+     * @brief Updates the classes after some rows of the dense table changed.
+     *
+     * A changed row keeps its class when no other row shares it, and takes a
+     * new one otherwise. The table is compressed again when a changed row
+     * tells apart two columns of a class, or when half of the row classes are
+     * left unused.
+     *
+     * @param dense Dense table with `rows * n_cols_` cells.
+     * @param rows Number of rows, which may differ from `n_rows_`.
+     * @param changed Rows whose cells changed, including every row past the
+     * old `n_rows_`.
+     */
+    void PatchRows(const std::vector<int>& dense, unsigned rows,
+                   const std::vector<unsigned>& changed);
+
+    /// @brief Looks up a cell of the original table.
+    int Lookup(unsigned row, unsigned col) const {
+        return cells_[row_map_[row] * n_col_classes_ + col_map_[col]];
+    }
+
+    /// @brief Bytes used by the remap arrays and the merged cells.
+    size_t Bytes() const;
+
+    unsigned n_rows_        = 0;
+    unsigned n_cols_        = 0;
+    unsigned n_row_classes_ = 0;
+    unsigned n_col_classes_ = 0;
+
+    /// @brief Row class of every row.
+    std::vector<unsigned> row_map_;
+    /// @brief Column class of every column.
+    std::vector<unsigned> col_map_;
+    /// @brief Merged table, `n_row_classes_ * n_col_classes_`.
+    std::vector<int> cells_;
+};
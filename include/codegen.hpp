@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+
+#include "ll1_parser.hpp"
+#include "slr1_parser.hpp"
+
+/**
+ * @brief Generators of standalone C++ parsers.
+ *
+ * Every generator writes two files: the parser itself (`out.cpp`) and a tiny
+ * runtime header next to it (`out.hpp`) that declares the token enumeration
+ * and the `Parse` entry point. The generated code only depends on the C++
+ * standard library headers, so it can be embedded without linking PLShell.
+ */
+namespace codegen {
+
+/**
+ * @brief Writes a direct-coded LR parser for the SLR(1) tables of a parser.
+ *
+ * Every state becomes a label and every action a jump: a `switch` on the
+ * lookahead token shifts (pushes the state and jumps to the target label) or
+ * reduces (pops the right-hand side and jumps to the goto dispatcher of the
+ * antecedent). No table is consulted at runtime. States are laid out by
+ * decreasing number of incoming transitions, so the states reached most often
+ * are placed first.
+ *
+ * @param parser An SLR(1) parser whose tables were built by `MakeParser`.
+ * @param out_path Path of the `.cpp` file to write. The header is written to
+ * the same path with the `.hpp` extension.
+ * @return `true` if both files were written, `false` if the parser has no
+ * tables or the files could not be written.
+ */
+bool WriteSLR1Parser(const SLR1Parser& parser, const std::string& out_path);
+
+/**
+ * @brief Writes a recursive-descent parser for the LL(1) table of a parser.
+ *
+ * Every non-terminal becomes a function that switches on the lookahead token
+ * id. The case labels of each production are its prediction symbols, taken
+ * from the LL(1) table, and the case body matches terminals and calls the
+ * functions of the non-terminals in order. The generated code does not
+ * allocate: the only state is the input cursor and the call stack, whose
+ * depth is bounded by `kMaxDepth`.
+ *
+ * @param parser An LL(1) parser whose table was built by `CreateLL1Table`.
+ * @param out_path Path of the `.cpp` file to write. The header is written to
+ * the same path with the `.hpp` extension.
+ * @return `true` if both files were written, `false` if the table is missing
+ * or has conflicts, or the files could not be written.
+ */
+bool WriteLL1Parser(const LL1Parser& parser, const std::string& out_path);
+
+} // namespace codegen
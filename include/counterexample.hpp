@@ -0,0 +1,200 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "grammar.hpp"
+#include "lr0_item.hpp"
+#include "slr1_parser.hpp"
+#include "state.hpp"
+
+/**
+ * @brief Counterexamples of LL(1) and SLR(1) conflicts, in the style of
+ * Bison's `-Wcounterexamples`.
+ *
+ * A conflict gets two sentential forms, one for each of two of its actions,
+ * with a conflict point (`•`) where the parser cannot choose between them.
+ * The forms of an SLR(1) conflict come from the shortest lookahead-sensitive
+ * paths to the conflicting items in the LR(0) automaton: a path tracks
+ * whether the conflict symbol can follow the rule it is in, so that a
+ * reduction is only reached where the symbol really follows it. The forms of
+ * an LL(1) conflict come from the shortest sentential form where the
+ * non-terminal is followed by what the conflicting rules need.
+ *
+ * A breadth-first search then expands the non-terminals of both forms, at
+ * the first position where they differ, until they are equal. If it
+ * succeeds, the counterexample is unifying: both actions lead to the same
+ * sentential form, so the grammar is ambiguous. The search is bounded by a
+ * number of forms and by a time budget shared by all the conflicts; when
+ * either runs out, the two forms are reported as they are. The budget also
+ * bounds the shortest strings and the lookahead-sensitive searches: past
+ * it, the forms come from the paths found so far, and the non-terminals
+ * without a shortest string are left in the example.
+ */
+namespace counterexample {
+
+/// @brief Marker of the conflict point in a sentential form.
+inline const std::string kDot = "•";
+
+/**
+ * @brief A sentential form split at the conflict point.
+ */
+struct Derivation {
+    std::vector<std::string> before;
+    std::vector<std::string> after;
+
+    /// @brief Symbols separated by spaces, with `•` at the conflict point
+    /// and without EOL.
+    std::string ToString(const std::string& eol) const;
+
+    bool operator==(const Derivation&) const = default;
+};
+
+/**
+ * @brief Counterexample of a conflict.
+ */
+struct Example {
+    /// @brief Whether both actions lead to the same sentential form.
+    bool unifying = false;
+    /// @brief Whether the search for a unifying form was stopped by the time
+    /// budget or by its size bound. Past the budget, the forms and the
+    /// sentence may be partial too.
+    bool bounded = false;
+    /// @brief Set when the conflict symbol is in FOLLOW of the reduced
+    /// non-terminal, but cannot follow it in the conflict state: the
+    /// conflict comes from SLR(1) using FOLLOW, and LALR(1) would not have
+    /// it.
+    bool follow_only = false;
+    /// @brief What the two forms show: the items of an SLR(1) conflict or
+    /// the rules of an LL(1) conflict.
+    std::string first_label;
+    std::string second_label;
+    /// @brief Forms of both actions, equal if `unifying`.
+    Derivation first;
+    Derivation second;
+    /// @brief Terminal string of `first`, where every non-terminal derives
+    /// its shortest string, with `•` at the conflict point.
+    std::vector<std::string> sentence;
+};
+
+/**
+ * @brief Builds counterexamples for the conflicts of one grammar.
+ *
+ * The shortest strings of the non-terminals are computed once, and so are
+ * the lookahead-sensitive searches for each conflict symbol, so the cost of
+ * a conflict is mostly its bounded unifying search.
+ */
+class Finder {
+  public:
+    using SetMap =
+        std::unordered_map<std::string, std::unordered_set<std::string>>;
+
+    /**
+     * @param gr Grammar of the conflicts, with its axiom rule.
+     * @param first_sets FIRST of every non-terminal, with EPSILON if it is
+     * nullable.
+     * @param budget Time for all the work of this finder, from its
+     * construction on.
+     */
+    Finder(const Grammar& gr, const SetMap& first_sets,
+           std::chrono::milliseconds budget);
+
+    /**
+     * @brief Counterexample of an SLR(1) conflict: of a shift (or accept)
+     * and a reduction, or of the first two reductions.
+     *
+     * @param slr1 Parser whose automaton has the conflict, built from the
+     * grammar of the finder.
+     * @param conflict One of `slr1.Conflicts()`.
+     */
+    Example Find(const SLR1Parser& slr1, const SLR1Parser::Conflict& conflict);
+
+    /**
+     * @brief Counterexample of an LL(1) conflict.
+     *
+     * @param non_terminal Row of the conflicting cell.
+     * @param symbol Column of the conflicting cell.
+     * @param first One of the rules in the cell.
+     * @param second Another rule in the cell.
+     */
+    Example Find(const std::string& non_terminal, const std::string& symbol,
+                 const production& first, const production& second);
+
+  private:
+    /// @brief Node of a search: its parent, the edge from it (for context
+    /// searches) and the distance to the root.
+    struct Visit {
+        int      parent = -1;
+        int      edge   = -1;
+        unsigned depth  = 0;
+        bool     seen   = false;
+    };
+
+    bool IsNonTerminal(const std::string& symbol) const;
+
+    /// @brief Whether the time budget ran out, which is kept in `expired_`.
+    bool Expired();
+
+    /**
+     * @brief Whether `symbol` begins a string derived from `symbols`, and
+     * whether `symbols` is nullable.
+     */
+    bool Starts(const std::vector<std::string>& symbols, size_t from,
+                const std::string& symbol, bool& nullable) const;
+
+    /// @brief Builds the item graph of the automaton of `slr1`.
+    void BuildGraph(const SLR1Parser& slr1);
+
+    /// @brief Lookahead-sensitive search of the item graph for a symbol.
+    const std::vector<Visit>& SearchItems(const std::string& symbol);
+
+    /// @brief Form of the shortest path to an item node.
+    Derivation ItemForm(const std::vector<Visit>& visits, unsigned node) const;
+
+    /// @brief Lookahead-sensitive search of the contexts of non-terminals.
+    const std::vector<Visit>& SearchContexts(const std::string& symbol);
+
+    /// @brief Expands both forms until they are equal.
+    void Unify(Example& example);
+
+    /// @brief Fills `example.sentence` from `example.first`.
+    void Sentence(Example& example) const;
+
+    const Grammar&                        gr_;
+    const SetMap&                         first_;
+    std::chrono::steady_clock::time_point deadline_;
+    /// @brief Set when the budget ran out, so that later searches stop too.
+    bool expired_ = false;
+    /// @brief Shortest terminal string of every productive non-terminal.
+    std::unordered_map<std::string, std::vector<std::string>> yield_;
+    /// @brief Rules of every non-terminal, shortest strings first.
+    std::unordered_map<std::string, std::vector<const production*>> rules_;
+
+    /// @brief Item graph: the states by id, the item of every node and its
+    /// edges (moving the dot, or expanding the non-terminal after it).
+    const SLR1Parser*                            graph_of_ = nullptr;
+    std::vector<const state*>                    states_;
+    std::vector<const Lr0Item*>                  items_;
+    std::vector<std::vector<unsigned>>           edges_;
+    std::unordered_map<const Lr0Item*, unsigned> node_;
+    unsigned                                     root_ = 0;
+    /// @brief Item searches by conflict symbol; node `2 n + f` is item `n`
+    /// with `f` set if the symbol can follow the rule of the item.
+    std::unordered_map<std::string, std::vector<Visit>> item_searches_;
+
+    /// @brief Non-terminals numbered for the context searches, and every
+    /// occurrence of a non-terminal in a rule (the rule and the position),
+    /// listed by the antecedent of the rule.
+    std::vector<std::string>                            names_;
+    std::unordered_map<std::string, unsigned>           index_;
+    std::vector<std::pair<const production*, unsigned>> uses_;
+    std::vector<std::vector<unsigned>>                  uses_by_lhs_;
+    std::unordered_map<std::string, std::vector<Visit>> context_searches_;
+};
+
+} // namespace counterexample
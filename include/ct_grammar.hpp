@@ -0,0 +1,532 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Compile-time grammars and parse tables.
+ *
+ * A grammar is declared as a `constexpr` object whose symbols are integers,
+ * and its FIRST/FOLLOW sets and LL(1) or SLR(1) tables are built by `consteval`
+ * versions of the algorithms in `LL1Parser` and `SLR1Parser`. A conflict is
+ * reported by throwing during constant evaluation, so a grammar that is not
+ * LL(1) (or SLR(1)) does not compile. The resulting tables are `constexpr`
+ * arrays, placed in read-only data with no startup cost, and the drivers are
+ * specialized on the sizes of the grammar.
+ *
+ * Symbols follow the conventions of `SymbolIndex`: terminal 0 is the end of
+ * input marker and non-terminal 0 is the axiom, whose only rule must be the
+ * first one and end with `kEol`. Inside a rule body, non-terminals are written
+ * with `Nt` to tell them apart from terminals:
+ *
+ * ~~~{.cpp}
+ * enum Tok { EOL, N, PLUS };
+ * enum Var { S, E };
+ * constexpr ct::Grammar<3, 2, 3> kSum{{{
+ *     {S, {ct::Nt(E), EOL}},
+ *     {E, {ct::Nt(E), PLUS, N}},
+ *     {E, {N}},
+ * }}};
+ * static_assert(ct::kSLR1<kSum>.Parse(std::array<int, 3>{N, PLUS, N}));
+ * ~~~
+ */
+namespace ct {
+
+/// @brief Id of the end of input marker.
+inline constexpr int kEol = 0;
+
+/// @brief Encodes non-terminal `n` as a symbol of a rule body.
+constexpr int Nt(int n) {
+    return -n - 1;
+}
+
+/// @brief Whether a symbol of a rule body is a non-terminal.
+constexpr bool IsNt(int symbol) {
+    return symbol < 0;
+}
+
+/// @brief Non-terminal id of a symbol of a rule body.
+constexpr int NtId(int symbol) {
+    return -symbol - 1;
+}
+
+/**
+ * @brief Production with at most `L` symbols. Epsilon productions have an
+ * empty body.
+ */
+template <std::size_t L> struct Rule {
+    int                lhs = 0;
+    std::array<int, L> rhs{};
+    std::size_t        length = 0;
+
+    constexpr Rule() = default;
+    constexpr Rule(int lhs, std::initializer_list<int> body)
+        : lhs(lhs), length(body.size()) {
+        if (body.size() > L) {
+            throw std::length_error("rule body is longer than L");
+        }
+        std::copy(body.begin(), body.end(), rhs.begin());
+    }
+};
+
+/**
+ * @brief Grammar with `T` terminals (including `kEol`), `N` non-terminals and
+ * `R` rules of at most `L` symbols.
+ */
+template <std::size_t T, std::size_t N, std::size_t R, std::size_t L = 8>
+struct Grammar {
+    static constexpr std::size_t kTerminals    = T;
+    static constexpr std::size_t kNonTerminals = N;
+    static constexpr std::size_t kRules        = R;
+    static constexpr std::size_t kMaxLength    = L;
+
+    std::array<Rule<L>, R> rules;
+};
+
+/**
+ * @brief Nullable, FIRST and FOLLOW sets of every non-terminal.
+ */
+template <std::size_t T, std::size_t N> struct Sets {
+    std::array<bool, N>                nullable{};
+    std::array<std::array<bool, T>, N> first{};
+    std::array<std::array<bool, T>, N> follow{};
+};
+
+namespace detail {
+
+template <typename G> consteval void Validate(const G& g) {
+    if (g.rules[0].lhs != 0 || g.rules[0].length == 0 ||
+        g.rules[0].rhs[g.rules[0].length - 1] != kEol) {
+        throw std::logic_error("the first rule must be 'axiom -> ... EOL'");
+    }
+    for (std::size_t r = 0; r < G::kRules; ++r) {
+        const auto& rule = g.rules[r];
+        if (rule.lhs < 0 || rule.lhs >= static_cast<int>(G::kNonTerminals) ||
+            (r > 0 && rule.lhs == 0)) {
+            throw std::logic_error("invalid antecedent");
+        }
+        for (std::size_t i = 0; i < rule.length; ++i) {
+            const int s = rule.rhs[i];
+            if (IsNt(s) ? NtId(s) >= static_cast<int>(G::kNonTerminals)
+                        : s >= static_cast<int>(G::kTerminals)) {
+                throw std::logic_error("invalid symbol in rule body");
+            }
+            if (s == kEol && (r > 0 || i + 1 != rule.length)) {
+                throw std::logic_error("EOL can only end the axiom rule");
+            }
+        }
+    }
+}
+
+/**
+ * Adds FIRST(body[from..]) to `out` and returns whether that suffix is
+ * nullable.
+ */
+template <std::size_t L, std::size_t T, std::size_t N>
+constexpr bool FirstOf(const Rule<L>& rule, std::size_t from,
+                       const Sets<T, N>& sets, std::array<bool, T>& out) {
+    for (std::size_t i = from; i < rule.length; ++i) {
+        const int s = rule.rhs[i];
+        if (!IsNt(s)) {
+            out[s] = true;
+            return false;
+        }
+        for (std::size_t t = 0; t < T; ++t) {
+            out[t] = out[t] || sets.first[NtId(s)][t];
+        }
+        if (!sets.nullable[NtId(s)]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace detail
+
+/**
+ * @brief Computes the nullable, FIRST and FOLLOW sets with the same fixed
+ * point iterations as `ComputeFirstSets` and `ComputeFollowSets`.
+ */
+template <typename G> consteval auto ComputeSets(const G& g) {
+    constexpr std::size_t T = G::kTerminals;
+    constexpr std::size_t N = G::kNonTerminals;
+    Sets<T, N>            sets;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& rule : g.rules) {
+            std::array<bool, T> first = sets.first[rule.lhs];
+            const bool nullable = detail::FirstOf(rule, 0, sets, first);
+            if (first != sets.first[rule.lhs] ||
+                (nullable && !sets.nullable[rule.lhs])) {
+                sets.first[rule.lhs] = first;
+                sets.nullable[rule.lhs] =
+                    sets.nullable[rule.lhs] || nullable;
+                changed = true;
+            }
+        }
+    }
+
+    sets.follow[0][kEol] = true;
+    changed              = true;
+    while (changed) {
+        changed = false;
+        for (const auto& rule : g.rules) {
+            for (std::size_t i = 0; i < rule.length; ++i) {
+                if (!IsNt(rule.rhs[i])) {
+                    continue;
+                }
+                std::array<bool, T>& follow = sets.follow[NtId(rule.rhs[i])];
+                std::array<bool, T>  next   = follow;
+                if (detail::FirstOf(rule, i + 1, sets, next)) {
+                    for (std::size_t t = 0; t < T; ++t) {
+                        next[t] = next[t] || sets.follow[rule.lhs][t];
+                    }
+                }
+                if (next != follow) {
+                    follow  = next;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return sets;
+}
+
+/**
+ * @brief LL(1) table built at compile time, with its predictive driver.
+ */
+template <std::size_t T, std::size_t N, std::size_t R, std::size_t L>
+struct LL1Table {
+    /// @brief Rule id for every (non-terminal, terminal) pair, or -1.
+    std::array<int, N * T> predict{};
+    std::array<Rule<L>, R> rules{};
+
+    constexpr int Predict(std::size_t non_terminal,
+                          std::size_t terminal) const {
+        return predict[non_terminal * T + terminal];
+    }
+
+    /**
+     * @brief Runs the predictive parser.
+     *
+     * @tparam D Capacity of the symbol stack, the parse fails if it is
+     * exceeded.
+     * @param tokens Terminal ids of the input. The end of input marker is
+     * implicit if it is not the last token.
+     * @return `true` if the input is accepted.
+     */
+    template <std::size_t D = 1024>
+    constexpr bool Parse(std::span<const int> tokens) const {
+        std::array<int, D> stack{};
+        std::size_t        top = 0;
+        std::size_t        pos = 0;
+        stack[top++]           = Nt(0);
+        while (top > 0) {
+            const int symbol = stack[--top];
+            const int tok    = pos < tokens.size() ? tokens[pos] : kEol;
+            if (tok < 0 || tok >= static_cast<int>(T)) {
+                return false;
+            }
+            if (!IsNt(symbol)) {
+                if (symbol != tok) {
+                    return false;
+                }
+                if (pos < tokens.size()) {
+                    ++pos;
+                }
+                continue;
+            }
+            const int rule = Predict(NtId(symbol), tok);
+            if (rule < 0 || top + rules[rule].length > D) {
+                return false;
+            }
+            for (std::size_t i = rules[rule].length; i > 0; --i) {
+                stack[top++] = rules[rule].rhs[i - 1];
+            }
+        }
+        return pos >= tokens.size();
+    }
+};
+
+/**
+ * @brief Builds the LL(1) table of a grammar. Does not compile if the grammar
+ * is not LL(1).
+ */
+template <auto G> consteval auto MakeLL1() {
+    using GT                = decltype(G);
+    constexpr std::size_t T = GT::kTerminals;
+    constexpr std::size_t N = GT::kNonTerminals;
+    detail::Validate(G);
+    const auto sets = ComputeSets(G);
+
+    LL1Table<T, N, GT::kRules, GT::kMaxLength> table;
+    table.rules = G.rules;
+    table.predict.fill(-1);
+    for (std::size_t r = 0; r < GT::kRules; ++r) {
+        const auto&         rule = G.rules[r];
+        std::array<bool, T> predict{};
+        if (detail::FirstOf(rule, 0, sets, predict)) {
+            for (std::size_t t = 0; t < T; ++t) {
+                predict[t] = predict[t] || sets.follow[rule.lhs][t];
+            }
+        }
+        for (std::size_t t = 0; t < T; ++t) {
+            if (!predict[t]) {
+                continue;
+            }
+            int& cell = table.predict[rule.lhs * T + t];
+            if (cell != -1) {
+                throw std::logic_error("LL(1) conflict");
+            }
+            cell = static_cast<int>(r);
+        }
+    }
+    return table;
+}
+
+/**
+ * @brief SLR(1) tables built at compile time, with the LR driver. Actions use
+ * the encoding of `LRTable`.
+ */
+template <std::size_t S, std::size_t T, std::size_t N, std::size_t R>
+struct SLR1Table {
+    static constexpr int kError  = 0;
+    static constexpr int kAccept = std::numeric_limits<int>::max();
+
+    /// @brief Smallest unsigned type that holds every state id.
+    using StateType = std::conditional_t<
+        (S <= 0xff), std::uint8_t,
+        std::conditional_t<(S <= 0xffff), std::uint16_t, std::uint32_t>>;
+
+    static constexpr std::size_t kStates = S;
+
+    std::array<int, S * T> action{};
+    /// @brief Goto table, -1 if there is no transition.
+    std::array<int, S * N>     go{};
+    std::array<int, R>         rule_lhs{};
+    std::array<std::size_t, R> rule_length{};
+
+    /**
+     * @brief Runs the LR driver.
+     *
+     * @tparam D Capacity of the state stack, the parse fails if it is
+     * exceeded.
+     * @param tokens Terminal ids of the input. The end of input marker is
+     * implicit if it is not the last token.
+     * @return `true` if the input is accepted.
+     */
+    template <std::size_t D = 1024>
+    constexpr bool Parse(std::span<const int> tokens) const {
+        std::array<StateType, D> stack{};
+        std::size_t              top = 1;
+        std::size_t              pos = 0;
+        while (true) {
+            const int tok = pos < tokens.size() ? tokens[pos] : kEol;
+            if (tok < 0 || tok >= static_cast<int>(T)) {
+                return false;
+            }
+            const int a = action[stack[top - 1] * T + tok];
+            if (a == kAccept) {
+                return pos + 1 >= tokens.size();
+            }
+            if (a > 0) {
+                if (top == D) {
+                    return false;
+                }
+                stack[top++] = static_cast<StateType>(a - 1);
+                if (pos < tokens.size()) {
+                    ++pos;
+                }
+            } else if (a < 0) {
+                const int rule = -a - 1;
+                top -= rule_length[rule];
+                const int next = go[stack[top - 1] * N + rule_lhs[rule]];
+                if (next < 0 || top == D) {
+                    return false;
+                }
+                stack[top++] = static_cast<StateType>(next);
+            } else {
+                return false;
+            }
+        }
+    }
+};
+
+namespace detail {
+
+/// LR(0) items of a grammar, numbered rule by rule and dot by dot.
+template <auto G> consteval std::size_t ItemCount() {
+    std::size_t n = 0;
+    for (const auto& rule : G.rules) {
+        n += rule.length + 1;
+    }
+    return n;
+}
+
+template <auto G> struct Collection {
+    static constexpr std::size_t I = ItemCount<G>();
+    static constexpr std::size_t V =
+        decltype(G)::kTerminals + decltype(G)::kNonTerminals;
+
+    using ItemSet = std::array<bool, I>;
+
+    std::array<std::size_t, decltype(G)::kRules> offset{};
+    std::vector<ItemSet>                         states;
+    /// Transitions of every state over every symbol (terminals first), or -1.
+    std::vector<std::array<int, V>> transitions;
+
+    consteval int Symbol(int s) const {
+        return IsNt(s) ? static_cast<int>(decltype(G)::kTerminals) + NtId(s)
+                       : s;
+    }
+
+    consteval void Closure(ItemSet& items) const {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (std::size_t r = 0; r < G.rules.size(); ++r) {
+                for (std::size_t dot = 0; dot < G.rules[r].length; ++dot) {
+                    const int s = G.rules[r].rhs[dot];
+                    if (!items[offset[r] + dot] || !IsNt(s)) {
+                        continue;
+                    }
+                    for (std::size_t q = 0; q < G.rules.size(); ++q) {
+                        if (G.rules[q].lhs == NtId(s) && !items[offset[q]]) {
+                            items[offset[q]] = true;
+                            changed          = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /// Canonical LR(0) collection, same construction as `MakeParser`.
+    consteval Collection() {
+        Validate(G);
+        std::size_t n = 0;
+        for (std::size_t r = 0; r < G.rules.size(); ++r) {
+            offset[r] = n;
+            n += G.rules[r].length + 1;
+        }
+        ItemSet initial{};
+        initial[offset[0]] = true;
+        Closure(initial);
+        states.push_back(initial);
+
+        for (std::size_t st = 0; st < states.size(); ++st) {
+            std::array<int, V> row;
+            row.fill(-1);
+            // There is no transition over EOL: the state with the axiom item
+            // before it accepts, as in `SolveLRConflicts`
+            for (std::size_t x = kEol + 1; x < V; ++x) {
+                ItemSet next{};
+                bool    any = false;
+                for (std::size_t r = 0; r < G.rules.size(); ++r) {
+                    for (std::size_t dot = 0; dot < G.rules[r].length; ++dot) {
+                        if (states[st][offset[r] + dot] &&
+                            Symbol(G.rules[r].rhs[dot]) ==
+                                static_cast<int>(x)) {
+                            next[offset[r] + dot + 1] = true;
+                            any                       = true;
+                        }
+                    }
+                }
+                if (!any) {
+                    continue;
+                }
+                Closure(next);
+                auto it = std::find(states.begin(), states.end(), next);
+                row[x]  = static_cast<int>(it - states.begin());
+                if (it == states.end()) {
+                    states.push_back(next);
+                }
+            }
+            transitions.push_back(row);
+        }
+    }
+};
+
+} // namespace detail
+
+/// @brief Number of states of the LR(0) automaton of a grammar.
+template <auto G> consteval std::size_t StateCount() {
+    return detail::Collection<G>().states.size();
+}
+
+/**
+ * @brief Builds the SLR(1) tables of a grammar. Does not compile if the
+ * grammar is not SLR(1).
+ *
+ * The collection is built twice: once to count the states, which sizes the
+ * table type, and once to fill it, since memory allocated during constant
+ * evaluation cannot outlive it.
+ */
+template <auto G> consteval auto MakeSLR1() {
+    using GT                = decltype(G);
+    constexpr std::size_t S = StateCount<G>();
+    constexpr std::size_t T = GT::kTerminals;
+    constexpr std::size_t N = GT::kNonTerminals;
+    using Table             = SLR1Table<S, T, N, GT::kRules>;
+    const detail::Collection<G> collection;
+    const auto                  sets = ComputeSets(G);
+
+    Table table;
+    for (std::size_t r = 0; r < GT::kRules; ++r) {
+        table.rule_lhs[r]    = G.rules[r].lhs;
+        table.rule_length[r] = G.rules[r].length;
+    }
+    for (std::size_t st = 0; st < S; ++st) {
+        for (std::size_t t = 0; t < T; ++t) {
+            const int to             = collection.transitions[st][t];
+            table.action[st * T + t] = to < 0 ? Table::kError : to + 1;
+        }
+        for (std::size_t nt = 0; nt < N; ++nt) {
+            table.go[st * N + nt] = collection.transitions[st][T + nt];
+        }
+        const std::size_t accept_item =
+            collection.offset[0] + G.rules[0].length - 1;
+        if (collection.states[st][accept_item]) {
+            table.action[st * T + kEol] = Table::kAccept;
+        }
+        for (std::size_t r = 1; r < GT::kRules; ++r) {
+            const auto& rule = G.rules[r];
+            if (!collection.states[st][collection.offset[r] + rule.length]) {
+                continue;
+            }
+            const int reduce = -static_cast<int>(r) - 1;
+            for (std::size_t t = 0; t < T; ++t) {
+                if (!sets.follow[rule.lhs][t]) {
+                    continue;
+                }
+                int& cell = table.action[st * T + t];
+                if (cell != Table::kError && cell != reduce) {
+                    if (cell > 0 && cell != Table::kAccept) {
+                        throw std::logic_error("SLR(1) shift/reduce conflict");
+                    }
+                    throw std::logic_error("SLR(1) reduce/reduce conflict");
+                }
+                cell = reduce;
+            }
+        }
+    }
+    return table;
+}
+
+/// @brief LL(1) table of `G`, computed at compile time.
+template <auto G> inline constexpr auto kLL1 = MakeLL1<G>();
+
+/// @brief SLR(1) tables of `G`, computed at compile time.
+template <auto G> inline constexpr auto kSLR1 = MakeSLR1<G>();
+
+} // namespace ct
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "grammar.hpp"
+
+/**
+ * @brief FIRST and FOLLOW sets solved over the condensation of their
+ * dependency graphs.
+ *
+ * FIRST(A) depends on FIRST(B) when B can begin a rule of A, and FOLLOW(B)
+ * depends on FOLLOW(A) when B can end a rule of A. Once nullable symbols are
+ * known, all the non-terminals of a strongly connected component of one of
+ * those graphs have the same set (besides EPSILON, which only depends on
+ * nullability), so every component is solved with one union of the
+ * contributions of its members and of the components it depends on. The
+ * components whose dependencies are solved form a wave, and the components
+ * of a wave are solved in parallel, with sets stored as bitsets over the
+ * terminals.
+ *
+ * The result is the least fixed point, identical to the sets computed by
+ * `ComputeFirstSets` and `ComputeFollowSets` of `LL1Parser` and `SLR1Parser`.
+ */
+namespace first_follow {
+
+using SetMap = std::unordered_map<std::string, std::unordered_set<std::string>>;
+
+struct Sets {
+    /// @brief FIRST of every non-terminal, including EPSILON if nullable.
+    SetMap first;
+    /// @brief FOLLOW of every non-terminal.
+    SetMap follow;
+};
+
+/**
+ * @brief Computes FIRST and FOLLOW of every non-terminal of a grammar.
+ *
+ * @param gr Grammar, with its axiom rule.
+ * @param threads Number of threads, 0 for one per hardware thread.
+ * @return The sets of every non-terminal with productions.
+ */
+Sets Compute(const Grammar& gr, unsigned threads = 0);
+
+/**
+ * @brief Non-terminals whose sets changed in an `Update`, and the terminals
+ * that changed in their FOLLOW.
+ */
+struct Changes {
+    std::unordered_set<std::string> first;
+    std::unordered_set<std::string> follow;
+    /// @brief Terminals added to or removed from the FOLLOW of some
+    /// non-terminal of `follow`.
+    std::unordered_set<std::string> follow_terminals;
+};
+
+/**
+ * @brief Updates FIRST and FOLLOW after a rule was added or removed.
+ *
+ * Only the sets that can depend on the edited rule are solved again: FIRST of
+ * the non-terminals that derive a sentential form containing `antecedent`,
+ * and FOLLOW of the non-terminals of the edited rule, of the rules where a
+ * FIRST changed, and of everything that inherits their FOLLOW. All the other
+ * sets are kept, so the result equals computing every set from scratch.
+ *
+ * @param gr Grammar, already edited.
+ * @param antecedent Left-hand side of the edited rule.
+ * @param consequent Right-hand side of the edited rule.
+ * @param first FIRST of every non-terminal before the edit, updated in place.
+ * @param follow FOLLOW of every non-terminal before the edit, updated in
+ * place.
+ * @return The non-terminals whose FIRST or FOLLOW changed, and the terminals
+ * that changed in those FOLLOW sets.
+ */
+Changes Update(const Grammar& gr, const std::string& antecedent,
+               const production& consequent, SetMap& first, SetMap& follow);
+
+/**
+ * @brief Computes FIRST of some non-terminals, when FIRST of every other
+ * non-terminal that their rules use is already known.
+ *
+ * @param gr Grammar.
+ * @param targets Non-terminals with productions to solve.
+ * @param first FIRST of the non-terminals used by `targets`. The sets of
+ * `targets` are replaced.
+ */
+void SolveFirst(const Grammar& gr, const std::vector<std::string>& targets,
+                SetMap& first);
+
+/**
+ * @brief FIRST sets of the modules of loaded grammars (see
+ * `Grammar::ReadFromFile`), kept between loads.
+ *
+ * The rules of a module only use its non-terminals and the ones of the
+ * modules it imports, so its FIRST sets (with EPSILON for the nullable
+ * non-terminals) only change when its file or an imported one changes.
+ * Modules are visited in topological order of the import graph, with
+ * modules that import each other as one unit, and the key of a unit hashes
+ * the files of its members, the terminals and the keys of the units they
+ * import. A unit whose key is cached reuses its sets; the others are solved
+ * again with `SolveFirst`, so editing a module analyzes that module and the
+ * ones that import it.
+ */
+class ModuleCache {
+  public:
+    /**
+     * @brief FIRST of every non-terminal of a grammar.
+     *
+     * @param gr Grammar. Without modules, every set is computed.
+     * @return FIRST of every non-terminal with productions.
+     */
+    SetMap First(const Grammar& gr);
+
+    /// @brief Names of the modules solved by the last `First`, the loaded
+    /// file as an empty name.
+    std::vector<std::string> analyzed_;
+
+  private:
+    struct Entry {
+        size_t key;
+        SetMap first;
+    };
+
+    /// @brief Sets of every module, by path.
+    std::unordered_map<std::string, Entry> entries_;
+};
+
+} // namespace first_follow
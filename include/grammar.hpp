@@ -1,5 +1,7 @@
 #pragma once
 #include "symbol_table.hpp"
+#include <cstddef>
+#include <ostream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -16,10 +18,81 @@
  */
 using production = std::vector<std::string>;
 
+/**
+ * @brief A rule added to or removed from a loaded grammar.
+ */
+struct RuleEdit {
+    /// @brief `true` if the rule is added, `false` if it is removed.
+    bool        add;
+    std::string antecedent;
+    production  consequent;
+};
+
+/**
+ * @brief A grammar file read by `Grammar::ReadFromFile`: the loaded file or
+ * one of the modules it imports.
+ */
+struct Module {
+    /// @brief Namespace of its non-terminals (the file name without its
+    /// extension), empty for the loaded file.
+    std::string name;
+    /// @brief Path of the file.
+    std::string path;
+    /// @brief Hash of the contents of the file.
+    size_t fingerprint = 0;
+    /// @brief Names of the modules it imports.
+    std::vector<std::string> imports;
+};
+
+/**
+ * @brief Precedence of a terminal declared with `%left`, `%right` or
+ * `%nonassoc`, used to resolve shift/reduce conflicts as yacc does.
+ */
+struct Precedence {
+    enum class Associativity { Left, Right, NonAssoc };
+
+    /// @brief Line of the declaration: later lines bind tighter.
+    unsigned      level;
+    Associativity associativity;
+
+    bool operator==(const Precedence&) const = default;
+};
+
 struct Grammar {
 
     Grammar() = default;
 
+    /**
+     * @brief Reads a grammar file: `terminal name regex;` lines and the
+     * `start with S;` line, a `;` line, one rule per line (`A -> a B;`, or
+     * `A ->;` for EPSILON) and a final `;` line.
+     *
+     * `import "expr.txt";` lines, with paths relative to the importing file,
+     * read other grammar files as modules. The non-terminals of a module are
+     * named `expr.E` outside of it and `E` inside; terminals are shared by all
+     * the files, and a terminal declared twice must have the same pattern.
+     * Every file is read once, even if several files import it, and modules
+     * may import each other. Their `start with` lines are ignored.
+     *
+     * Rule bodies may use the EBNF operators `|`, `( )`, `?`, `*` and `+`.
+     * They are desugared into helper non-terminals right after the rule's
+     * antecedent in `order`, sharing one helper between equal
+     * sub-expressions: `X?` is `H -> X | EPSILON`, `X*` is
+     * `H -> X H | EPSILON` and `X+` is `X H` with `H` the helper of `X*`.
+     *
+     * `%left plus minus;`, `%right` and `%nonassoc` lines give the listed
+     * terminals a precedence, higher on every line than on the previous
+     * ones. Like `start with`, they are only read from the loaded file.
+     *
+     * Rules such as `list(X) -> X list(X);` are parameterized: they are not
+     * non-terminals, but `list(E)` in a body is, with the rule's bodies for
+     * `X = E`. An argument may be any EBNF expression. Each distinct rule and
+     * argument tuple gives one non-terminal, `list_E`, shared by every body
+     * of the file that uses it. Parameterized rules are local to their file.
+     *
+     * @param filename Path of the grammar file.
+     * @return `false` if the file cannot be read or is malformed.
+     */
     bool ReadFromFile(const std::string& filename);
 
     std::vector<std::string> Split(const std::string& s);
@@ -69,6 +142,25 @@ struct Grammar {
      */
     void Debug();
 
+    /**
+     * @brief Writes the grammar in the format read by `ReadFromFile`.
+     *
+     * Terminals are written in name order with their patterns, and rules in
+     * the order of `order`, so that a transformed grammar can be saved and
+     * loaded again.
+     *
+     * @param out Stream to write to.
+     */
+    void Write(std::ostream& out) const;
+
+    /**
+     * @brief Writes the grammar to a file, as `Write`.
+     *
+     * @param filename Path of the file.
+     * @return `false` if the file could not be written.
+     */
+    bool WriteToFile(const std::string& filename) const;
+
     /**
      * @brief Checks if a rule exhibits left recursion.
      *
@@ -100,6 +192,60 @@ struct Grammar {
     void AddProduction(const std::string&              antecedent,
                        const std::vector<std::string>& consequent);
 
+    /**
+     * @brief Adds a rule to a loaded grammar.
+     *
+     * A new antecedent is declared as a non-terminal. The rule is rejected if
+     * the antecedent is a terminal or the axiom (whose rule must be unique),
+     * if a symbol of the consequent is not declared, if it contains EOL, or if
+     * the rule already exists. An epsilon rule is `{EPSILON}`.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Symbols of the right-hand side.
+     * @return `true` if the rule was added.
+     */
+    bool InsertRule(const std::string& antecedent,
+                    const production&  consequent);
+
+    /**
+     * @brief Removes a rule from a loaded grammar.
+     *
+     * The axiom rule cannot be removed, and neither can the last rule of a
+     * non-terminal that is still used by another rule. When the last rule of
+     * an unused non-terminal is removed, the non-terminal is removed too.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Symbols of the right-hand side.
+     * @return `true` if the rule was removed.
+     */
+    bool RemoveRule(const std::string& antecedent,
+                    const production&  consequent);
+
+    /**
+     * @brief Applies an edit with `InsertRule` or `RemoveRule`.
+     *
+     * @param edit Rule to add or remove.
+     * @return `true` if the edit was accepted.
+     */
+    bool Apply(const RuleEdit& edit);
+
+    /**
+     * @brief Finds the rule edits that turn this grammar into another one.
+     *
+     * Both grammars must declare the same terminals, with the same patterns
+     * and precedences, and have the same axiom rule. Rules are compared as
+     * sets, so moving a rule is not an edit. The edits are ordered so that
+     * `Apply` accepts each of them: rules are added before they are removed,
+     * so that a non-terminal whose rules were replaced is never left without
+     * rules, and a rule waits for the rules that declare or free its symbols.
+     *
+     * @param next Grammar to reach.
+     * @param edits Filled with the edits, in the order they must be applied.
+     * @return `false` if the terminals or the axiom rule differ, or if no
+     * order of the edits is accepted.
+     */
+    bool EditsTo(const Grammar& next, std::vector<RuleEdit>& edits) const;
+
     /**
      * @brief Stores the grammar rules with each antecedent mapped to a list of
      * productions.
@@ -121,4 +267,34 @@ struct Grammar {
      * @brief Symbol Table of the grammar.
      */
     SymbolTable st_;
+
+    /**
+     * @brief Terminals declared with `%left`, `%right` or `%nonassoc`.
+     */
+    std::unordered_map<std::string, Precedence> precedence_;
+
+    /**
+     * @brief Returns the precedence of a rule: the one of its rightmost
+     * terminal that has one.
+     *
+     * @param consequent Right-hand side of the rule.
+     * @return The precedence, or `nullptr` if no terminal of the rule has
+     * one.
+     */
+    const Precedence* RulePrecedence(const production& consequent) const;
+
+    /**
+     * @brief Files read by `ReadFromFile`: the loaded file first, then its
+     * modules in the order they were imported. Empty for grammars built in
+     * code.
+     */
+    std::vector<Module> modules_;
+
+    /**
+     * @brief Returns the module of a non-terminal.
+     *
+     * @param non_terminal Non-terminal of the grammar.
+     * @return Index in `modules_`, 0 for the loaded file.
+     */
+    size_t ModuleOf(const std::string& non_terminal) const;
 };
@@ -2,6 +2,8 @@
 
 #include "grammar.hpp"
 #include "symbol_table.hpp"
+#include <cstdint>
+#include <random>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -53,12 +55,104 @@ struct GrammarFactory {
         void Debug();
     };
 
+    /**
+     * @struct Params
+     * @brief Shape of a grammar built by `Generate`.
+     */
+    struct Params {
+        /// @brief Number of non-terminals, not counting the axiom.
+        unsigned non_terminals = 10;
+
+        /// @brief Number of terminals, not counting EOL.
+        unsigned terminals = 8;
+
+        /// @brief Number of rules, not counting the axiom rule. At least one
+        /// rule is created for every non-terminal.
+        unsigned rules = 20;
+
+        /**
+         * @brief Relative weight of every right-hand side length: the length
+         * of a rule is `i` with probability `length_weights[i] / sum`. A zero
+         * length adds an epsilon rule.
+         */
+        std::vector<double> length_weights{0, 3, 4, 2, 1};
+
+        /// @brief Fraction of the non-terminals that get an epsilon rule.
+        double nullable_ratio = 0.1;
+
+        /// @brief Probability of a symbol being a terminal.
+        double terminal_ratio = 0.5;
+
+        /**
+         * @brief How far back (in non-terminal order) a rule can refer, which
+         * bounds the length of the recursive cycles. 0 disables recursion.
+         * Back references are never the first symbol of a rule, so there is
+         * no left recursion other than through nullable prefixes.
+         */
+        unsigned recursion_depth = 3;
+
+        /**
+         * @brief Start every rule with a terminal of its own (`k0`, `k1`,
+         * ...), so that no rule is empty. Every state of the LR(0) automaton
+         * then has a single kernel item, and the grammar is LR(0), and so
+         * SLR(1), whatever its other parameters. `nullable_ratio` is ignored.
+         */
+        bool keyed = false;
+
+        /// @brief Seed of the random generator. Equal parameters always
+        /// generate the same grammar.
+        std::uint32_t seed = 42;
+    };
+
+    /**
+     * @struct Pruned
+     * @brief What `Prune` removed from a grammar.
+     */
+    struct Pruned {
+        /// @brief Non-terminals that cannot derive a terminal string.
+        std::vector<std::string> unproductive;
+
+        /// @brief Productive non-terminals that the axiom cannot reach once
+        /// the unproductive ones are gone.
+        std::vector<std::string> unreachable;
+
+        /// @brief Number of removed productions.
+        size_t rules = 0;
+
+        /// @brief Whether the axiom is unproductive. The grammar is then left
+        /// as it was, since removing its useless symbols would remove all.
+        bool empty_language = false;
+    };
+
+    /**
+     * @brief Generates a random grammar with the given shape.
+     *
+     * Non-terminals are named `N0`, `N1`, ... and terminals `t0`, `t1`, ...,
+     * and the axiom is `S -> N0 $`. The non-terminals form a binary tree
+     * (`Ni` refers to `N(2i+1)` and `N(2i+2)` in its first rule), so every
+     * one of them is reachable, and the first rule of every non-terminal only
+     * refers forward, so every one of them is productive. Rules are added
+     * directly, without going through the symbol table split, so it scales to
+     * tens of thousands of non-terminals.
+     *
+     * @param params Shape of the grammar.
+     * @return The generated grammar.
+     */
+    Grammar Generate(const Params& params);
+
     /**
      * @brief Initializes the GrammarFactory and populates the items vector with
      * initial grammar items.
      */
     void Init();
 
+    /**
+     * @brief Seeds the random generator used by `PickOne`, the level
+     * generators and `GenLL1Grammar`/`GenSLR1Grammar`.
+     * @param seed The new seed.
+     */
+    void Seed(std::uint32_t seed);
+
     /**
      * @brief Picks a random grammar based on the specified difficulty level (1,
      * 2, or 3).
@@ -165,11 +259,22 @@ struct GrammarFactory {
      */
     FactoryItem CreateLv2Item();
 
+    /**
+     * @brief Creates a grammar item of the given level, by combining an item
+     * of the previous level with a Level 1 item whose non-terminal replaces
+     * one of the terminals of the former.
+     *
+     * @param level The level, from 1 to 7.
+     * @return A FactoryItem of that level.
+     */
+    FactoryItem CreateLvItem(int level);
+
     // -------- SANITY CHECKS --------
 
     /**
      * @brief Checks if a grammar contains unreachable symbols (non-terminals
-     * that cannot be derived from the start symbol).
+     * that cannot be derived from the start symbol). Runs in time linear in
+     * the size of the grammar, with a worklist over integer symbols.
      * @param grammar The grammar to check.
      * @return true if there are unreachable symbols, false otherwise.
      */
@@ -182,12 +287,25 @@ struct GrammarFactory {
      * without reaching terminal symbols. For example, a production like: S -> A
      * A -> a A | B
      * B -> c B
-     * could lead to an infinite derivation of non-terminals.
+     * could lead to an infinite derivation of non-terminals. Every production
+     * keeps a counter of the non-terminals of its body not yet known to be
+     * productive, so each occurrence is visited once.
      * @param grammar The grammar to check.
      * @return true if the grammar has infinite derivations, false otherwise.
      */
     bool IsInfinite(Grammar& grammar);
 
+    /**
+     * @brief Removes useless symbols: first the unproductive non-terminals
+     * and every production that uses one, then the non-terminals that the
+     * axiom no longer reaches, with their productions. Both steps are linear
+     * in the size of the grammar. Terminals are kept, even if no production
+     * uses them anymore.
+     * @param grammar The grammar to prune.
+     * @return What was removed.
+     */
+    Pruned Prune(Grammar& grammar);
+
     /**
      * @brief Checks if a grammar contains direct left recursion (a non-terminal
      * can produce itself on the left side of a production in one step).
@@ -198,12 +316,17 @@ struct GrammarFactory {
 
     // -------- TRANSFORMATIONS --------
     /**
-     * @brief Removes direct left recursion in a grammar. A grammar has direct
-     * left recursion when one of its productions is A -> A a, where A is a non
-     * terminal symbol and "a" the rest of the production. The procedure removes
-     * direct left recursion by adding a new non terminal. So, if the
-     * productions with left recursion are A -> A a | b, the result would be A
-     * -> b A'; A'-> a A' | EPSILON
+     * @brief Removes left recursion in a grammar, direct or indirect. A grammar
+     * has direct left recursion when one of its productions is A -> A a, where
+     * A is a non terminal symbol and "a" the rest of the production, and
+     * indirect left recursion when A derives A a in more than one step. The
+     * non terminals that can start with each other are the strongly connected
+     * components of the left-corner graph (A -> B when a production of A
+     * starts with B). In each of them, taken in grammar order, the productions
+     * that start with an earlier non terminal of the component are replaced by
+     * the productions of that one, and direct left recursion is removed by
+     * adding a new non terminal. So, if the productions with left recursion
+     * are A -> A a | b, the result would be A -> b A'; A'-> a A' | EPSILON
      * @param grammar The grammar to remove left recursion
      */
     void RemoveLeftRecursion(Grammar& grammar);
@@ -211,11 +334,15 @@ struct GrammarFactory {
     /**
      * @brief Removes unit rules of the type A -> B, where A and B are non
      * terminal symbols. Unit rules can introduce some redundancy depending on
-     * the grammar. It is performed by adding all the productions of B to A.
-     * This process could lead to B being unreachable, if that is the case
-     * unreachable symbols are removed. For example: A -> a A | B; B -> c |
-     * EPSILON would be A -> a A | c | EPSILON;. B becomes unreachable once A ->
-     * B it is removed, so B is removed alongside its productions.
+     * the grammar. Non terminals in a cycle of unit rules derive each other,
+     * so every strongly connected component of the unit rule graph is merged
+     * into one non terminal (the axiom, or the first one in grammar order).
+     * Then, in topological order, each of them takes the productions of the
+     * non terminals its unit rules lead to. This process could lead to B being
+     * unreachable, if that is the case unreachable symbols are removed. For
+     * example: A -> a A | B; B -> c | EPSILON would be A -> a A | c |
+     * EPSILON;. B becomes unreachable once A -> B it is removed, so B is
+     * removed alongside its productions.
      * @param grammar. The grammar to remove unit rules.
      */
     void RemoveUnitRules(Grammar& grammar);
@@ -224,10 +351,10 @@ struct GrammarFactory {
      * @brief Perfoms left factorization. A grammar could be left factorized if
      * it have productions with the same prefix for one non terminal. For
      * example, A -> a x | a y; could be left factorized because it has "a" as
-     * the common prefix. The left factorization is done by adding a new non
-     * terminal symbol that contains the uncommon part, and by unifying the
-     * common prefix in a one producion. So, A -> a x | a y would be A -> a A';
-     * A' -> x | y.
+     * the common prefix. The productions of each non terminal are inserted in
+     * a prefix trie: every path without branches is a common prefix, and every
+     * branch below the root becomes a new non terminal symbol that contains
+     * the uncommon parts. So, A -> a x | a y would be A -> a A'; A' -> x | y.
      * @param grammar The grammar to be left factorized.
      */
     void LeftFactorize(Grammar& grammar);
@@ -265,10 +392,11 @@ struct GrammarFactory {
     /**
      * @brief Generates a new non-terminal symbol that is unique in the grammar.
      *
-     * This function creates a new non-terminal symbol by appending a prime
-     * symbol (') to the base name until the resulting symbol is not already
-     * present in the grammar's symbol table. It is used during left
-     * factorization to introduce new non-terminals for factored productions.
+     * This function appends a prime symbol (') to the base name and, if the
+     * result is already in the grammar's symbol table, a number after it. The
+     * numbers for each base are remembered in `fresh_`, so that generating
+     * many symbols for the same base does not test every name again. It is
+     * used by the transformations to introduce new non-terminals.
      *
      * @param grammar The grammar in which the new non-terminal will be added.
      * @param base The base name for the new non-terminal.
@@ -293,4 +421,15 @@ struct GrammarFactory {
      */
     std::vector<std::string> non_terminal_alphabet_{"A", "B", "C", "D",
                                                     "E", "F", "G"};
+
+    /**
+     * @brief Random generator of the level grammars, seeded with `Seed`.
+     */
+    std::mt19937 rng_{42};
+
+    /**
+     * @brief Next number to try after the prime for every base name, reset
+     * by each transformation.
+     */
+    std::unordered_map<std::string, unsigned> fresh_;
 };
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Graph algorithms over nodes numbered from 0, shared by the analyses
+ * and the grammar transformations.
+ */
+namespace graph {
+
+/// @brief For every node, the nodes it has an edge to.
+using Adjacency = std::vector<std::vector<unsigned>>;
+
+/**
+ * @brief Strongly connected components (iterative Tarjan).
+ *
+ * Components are numbered in the order they are completed, so the
+ * components reachable from a component always have smaller numbers.
+ *
+ * @param edges Edges of every node.
+ * @param count Set to the number of components.
+ * @return The component of every node.
+ */
+inline std::vector<unsigned> Components(const Adjacency& edges,
+                                        unsigned&        count) {
+    constexpr unsigned    kNone = std::numeric_limits<unsigned>::max();
+    const size_t          n     = edges.size();
+    std::vector<unsigned> index(n, kNone);
+    std::vector<unsigned> low(n);
+    std::vector<unsigned> comp(n, kNone);
+    std::vector<unsigned> stack;
+    // Explicit call stack: node and next edge to visit
+    std::vector<std::pair<unsigned, size_t>> calls;
+    unsigned                                 next = 0;
+    count                                         = 0;
+
+    for (unsigned root = 0; root < n; ++root) {
+        if (index[root] != kNone) {
+            continue;
+        }
+        index[root] = low[root] = next++;
+        stack.push_back(root);
+        calls.push_back({root, 0});
+        while (!calls.empty()) {
+            const unsigned v = calls.back().first;
+            if (calls.back().second < edges[v].size()) {
+                const unsigned w = edges[v][calls.back().second++];
+                if (index[w] == kNone) {
+                    index[w] = low[w] = next++;
+                    stack.push_back(w);
+                    calls.push_back({w, 0});
+                } else if (comp[w] == kNone) { // w is on the stack
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+            if (low[v] == index[v]) {
+                unsigned w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    comp[w] = count;
+                } while (w != v);
+                ++count;
+            }
+            calls.pop_back();
+            if (!calls.empty()) {
+                const unsigned parent = calls.back().first;
+                low[parent]           = std::min(low[parent], low[v]);
+            }
+        }
+    }
+    return comp;
+}
+
+} // namespace graph
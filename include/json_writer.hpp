@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Minimal streaming JSON writer.
+ *
+ * Every call writes to the stream straight away, so documents are never built
+ * in memory. Commas between members and elements are inserted automatically;
+ * alternating keys and values is up to the caller.
+ */
+class JsonWriter {
+  public:
+    explicit JsonWriter(std::ostream& os) : os_(os) {}
+
+    JsonWriter& BeginObject() {
+        Separate();
+        os_ << '{';
+        first_.push_back(true);
+        return *this;
+    }
+
+    JsonWriter& EndObject() {
+        first_.pop_back();
+        os_ << '}';
+        return *this;
+    }
+
+    JsonWriter& BeginArray() {
+        Separate();
+        os_ << '[';
+        first_.push_back(true);
+        return *this;
+    }
+
+    JsonWriter& EndArray() {
+        first_.pop_back();
+        os_ << ']';
+        return *this;
+    }
+
+    JsonWriter& Key(std::string_view key) {
+        Separate();
+        WriteString(key);
+        os_ << ':';
+        after_key_ = true;
+        return *this;
+    }
+
+    JsonWriter& Value(std::string_view value) {
+        Separate();
+        WriteString(value);
+        return *this;
+    }
+
+    JsonWriter& Value(const char* value) {
+        return Value(std::string_view(value));
+    }
+
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    JsonWriter& Value(T value) {
+        Separate();
+        if constexpr (std::is_same_v<T, bool>) {
+            os_ << (value ? "true" : "false");
+        } else {
+            os_ << +value;
+        }
+        return *this;
+    }
+
+    /// @brief Writes an array with the strings of a range, in order.
+    template <typename Range> JsonWriter& Strings(const Range& range) {
+        BeginArray();
+        for (const auto& s : range) {
+            Value(std::string_view(s));
+        }
+        return EndArray();
+    }
+
+    /// @brief Writes an already serialized JSON value.
+    JsonWriter& Raw(std::string_view json) {
+        Separate();
+        os_ << json;
+        return *this;
+    }
+
+  private:
+    void Separate() {
+        if (after_key_) {
+            after_key_ = false;
+        } else if (!first_.empty()) {
+            if (!first_.back()) {
+                os_ << ',';
+            }
+            first_.back() = false;
+        }
+    }
+
+    void WriteString(std::string_view s) {
+        os_ << '"';
+        for (const char c : s) {
+            switch (c) {
+            case '"':
+                os_ << "\\\"";
+                break;
+            case '\\':
+                os_ << "\\\\";
+                break;
+            case '\n':
+                os_ << "\\n";
+                break;
+            case '\t':
+                os_ << "\\t";
+                break;
+            case '\r':
+                os_ << "\\r";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[7];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    os_ << escaped;
+                } else {
+                    os_ << c;
+                }
+            }
+        }
+        os_ << '"';
+    }
+
+    std::ostream&     os_;
+    std::vector<bool> first_;
+    bool              after_key_ = false;
+};
@@ -1,5 +1,7 @@
 #pragma once
+#include "class_table.hpp"
 #include "grammar.hpp"
+#include "symbol_index.hpp"
 #include <span>
 #include <stack>
 #include <string>
@@ -28,6 +30,9 @@ class LL1Parser {
         std::string, std::unordered_map<std::string, std::vector<production>>>;
 
   public:
+    /// @brief Cell of `compressed_` holding more than one production.
+    static constexpr int kConflict = -2;
+
     LL1Parser() = default;
     /**
      * @brief Constructs an LL1Parser with a grammar object and an input file.
@@ -36,6 +41,17 @@ class LL1Parser {
      */
     LL1Parser(Grammar gr);
 
+    /**
+     * @brief Constructs an LL1Parser whose FIRST sets are already known, such
+     * as the ones of a `first_follow::ModuleCache`. Only FOLLOW is computed.
+     *
+     * @param gr Grammar object to parse with.
+     * @param first_sets FIRST of every non-terminal of `gr`.
+     */
+    LL1Parser(Grammar gr,
+              std::unordered_map<std::string, std::unordered_set<std::string>>
+                  first_sets);
+
     /**
      * @brief Creates the LL(1) parsing table for the grammar.
      *
@@ -59,8 +75,85 @@ class LL1Parser {
      */
     bool CreateLL1Table();
 
+    /**
+     * @brief Builds the row of a non-terminal in `ll1_t_`.
+     *
+     * @param non_terminal Non-terminal with productions.
+     * @return `false` if a cell of the row has more than one production.
+     */
+    bool BuildRow(const std::string& non_terminal);
+
+    /**
+     * @brief Adds a rule to the grammar and updates FIRST, FOLLOW and the
+     * table without building them again.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Right-hand side of the rule.
+     * @return `false` if the rule was rejected (see `Grammar::InsertRule`).
+     */
+    bool AddRule(const std::string& antecedent, const production& consequent);
+
+    /**
+     * @brief Removes a rule from the grammar and updates FIRST, FOLLOW and
+     * the table without building them again.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Right-hand side of the rule.
+     * @return `false` if the rule was rejected (see `Grammar::RemoveRule`).
+     */
+    bool RemoveRule(const std::string& antecedent,
+                    const production&  consequent);
+
+    /**
+     * @brief Applies rule edits and updates the sets and rows that depend on
+     * them.
+     *
+     * FIRST and FOLLOW are updated with `first_follow::Update` after every
+     * edit. Only the rows of the edited antecedents, of the non-terminals
+     * whose FOLLOW changed and of the non-terminals with a rule that uses a
+     * changed FIRST are built again, once all the edits are applied.
+     * `compressed_` is left stale until `BuildCompressedTable` is called.
+     *
+     * @param edits Edits, in the order `Grammar::EditsTo` gives them.
+     * @return `false` if an edit was rejected. The edits before it are kept.
+     */
+    bool EditRules(const std::vector<RuleEdit>& edits);
+
+    /**
+     * @brief Checks that no cell of `ll1_t_` has more than one production.
+     */
+    bool IsLL1() const;
+
     void PrintTable();
 
+    /**
+     * @brief Builds `compressed_`, the LL(1) table indexed by integer ids and
+     * compressed with row and column equivalence classes.
+     *
+     * Rows are non-terminal ids and columns terminal ids (see `SymbolIndex`).
+     * A cell holds the id of the rule to expand, -1 if it is empty, or
+     * `kConflict` if more than one production was placed on it. Called by
+     * `CreateLL1Table`, and by `DebugTableStats` after rules were edited.
+     */
+    void BuildCompressedTable();
+
+    /**
+     * @brief Returns the rule to expand for a non-terminal and a lookahead.
+     *
+     * @param non_terminal Non-terminal id.
+     * @param terminal Terminal id of the lookahead.
+     * @return Rule id, -1 if there is none, or `kConflict`.
+     */
+    int Predict(unsigned non_terminal, unsigned terminal) const {
+        return compressed_.Lookup(non_terminal, terminal);
+    }
+
+    /**
+     * @brief Prints the size of the dense and the equivalence-class LL(1)
+     * tables.
+     */
+    void DebugTableStats();
+
     /**
      * @brief Calculates the FIRST set for a given production rule in a grammar.
      *
@@ -187,6 +280,16 @@ class LL1Parser {
     /// productions.
     ll1_table ll1_t_;
 
+    /// @brief Integer numbering of the symbols and rules used by
+    /// `compressed_`.
+    SymbolIndex index_;
+
+    /// @brief LL(1) table compressed with equivalence classes.
+    ClassTable compressed_;
+
+    /// @brief Whether rules were edited since `compressed_` was built.
+    bool compressed_stale_ = false;
+
     /// @brief Grammar object associated with this parser.
     Grammar gr_;
 
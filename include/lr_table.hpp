@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "class_table.hpp"
+
+/**
+ * @brief Flat LR parsing tables indexed by integer symbol ids.
+ *
+ * The table is built from the dense representation (one row per state, one
+ * column per terminal or non-terminal, see `SymbolIndex`) and then packed with
+ * row displacement (comb-vector) compression: every row is overlaid on a
+ * single `next` vector at some base offset, and a parallel `check` vector
+ * records which state owns each slot. The most frequent reduction of each
+ * action row is removed from the packed row and becomes its default
+ * reduction, which is returned whenever the check fails, unless the row has
+ * explicit errors.
+ *
+ * The same dense tables are also compressed with row and column equivalence
+ * classes (see `ClassTable`), which keeps every cell and only merges
+ * duplicated states and terminals.
+ *
+ * Actions are encoded in a single `int`:
+ * - `kError` (0): no action.
+ * - `s > 0`: shift and go to state `s - 1`.
+ * - `r < 0`: reduce by rule `-r - 1`.
+ * - `kAccept`: accept the input.
+ */
+struct LRTable {
+    static constexpr int kError  = 0;
+    static constexpr int kAccept = std::numeric_limits<int>::max();
+
+    static constexpr int Shift(unsigned state) {
+        return static_cast<int>(state) + 1;
+    }
+    static constexpr int Reduce(unsigned rule) {
+        return -static_cast<int>(rule) - 1;
+    }
+    static constexpr bool     IsShift(int a) { return a > 0 && a != kAccept; }
+    static constexpr bool     IsReduce(int a) { return a < 0; }
+    static constexpr unsigned Target(int a) { return a - 1; }
+    static constexpr unsigned Rule(int a) { return -a - 1; }
+
+    /**
+     * @brief Counters filled by `Parse`.
+     */
+    struct ParseStats {
+        size_t shifts     = 0;
+        size_t reductions = 0;
+    };
+
+    LRTable() = default;
+
+    /**
+     * @brief Allocates empty dense tables.
+     *
+     * @param n_states Number of states of the automaton.
+     * @param n_terminals Number of terminals, including EOL.
+     * @param n_non_terminals Number of non-terminals.
+     */
+    LRTable(unsigned n_states, unsigned n_terminals, unsigned n_non_terminals);
+
+    /**
+     * @brief Builds the packed tables (and default reductions) and the
+     * equivalence-class tables from the dense ones. Must be called after the
+     * dense tables are filled.
+     */
+    void Compress();
+
+    /**
+     * @brief Changes the number of states of the dense tables. Rows past the
+     * old end are empty, and the packed tables are not changed until
+     * `PatchRows`.
+     *
+     * @param n_states New number of states.
+     */
+    void Resize(unsigned n_states);
+
+    /**
+     * @brief Updates the packed tables after some dense rows changed, without
+     * moving the other rows.
+     *
+     * The slots of the changed rows, and of the rows removed by `Resize`, are
+     * freed, and then every changed row gets its default reduction again and
+     * is placed first fit. The equivalence-class tables only update the
+     * changed rows (see `ClassTable::PatchRows`).
+     *
+     * @param rows Changed rows, all of them below `n_states_`, including the
+     * rows added by `Resize`.
+     */
+    void PatchRows(const std::vector<unsigned>& rows);
+
+    /**
+     * @brief Skips the chain reductions of unit rules `A -> B`.
+     *
+     * A state whose only actions reduce one unit rule `A -> B`, and that has
+     * no gotos, is only entered to pop it again: every goto on `B` to it is
+     * replaced by the goto on `A` from the same state, repeatedly. Such a
+     * state reduces on every lookahead that the goto on `A` accepts, so the
+     * same inputs are accepted with fewer reductions, but the parse no
+     * longer builds the `A -> B` nodes. Must be called before `Compress`.
+     *
+     * @param unit Whether every rule is a unit rule.
+     * @return Number of goto entries changed.
+     */
+    size_t BypassUnitRules(const std::vector<char>& unit);
+
+    /// @brief Dense action lookup.
+    int DenseAction(unsigned state, unsigned terminal) const {
+        return action_[state * n_terminals_ + terminal];
+    }
+
+    /// @brief Dense goto lookup, -1 if there is no transition.
+    int DenseGoto(unsigned state, unsigned non_terminal) const {
+        return goto_[state * n_non_terminals_ + non_terminal];
+    }
+
+    /// @brief Packed action lookup, falls back to the default reduction.
+    int Action(unsigned state, unsigned terminal) const {
+        const size_t i = action_base_[state] + terminal;
+        return action_check_[i] == static_cast<int>(state) ? action_next_[i]
+                                                           : default_[state];
+    }
+
+    /// @brief Packed goto lookup, -1 if there is no transition.
+    int Goto(unsigned state, unsigned non_terminal) const {
+        const size_t i = goto_base_[state] + non_terminal;
+        return goto_check_[i] == static_cast<int>(state) ? goto_next_[i] : -1;
+    }
+
+    /// @brief Equivalence-class action lookup.
+    int ClassAction(unsigned state, unsigned terminal) const {
+        return action_classes_.Lookup(state, terminal);
+    }
+
+    /// @brief Equivalence-class goto lookup, -1 if there is no transition.
+    int ClassGoto(unsigned state, unsigned non_terminal) const {
+        return goto_classes_.Lookup(state, non_terminal);
+    }
+
+    /**
+     * @brief Runs the LR driver over the packed tables.
+     *
+     * @param tokens Terminal ids of the input. The end-of-input marker (id 0)
+     * is appended implicitly if it is not the last token.
+     * @param stats Optional counters of the shifts and reductions performed.
+     * @return `true` if the input is accepted.
+     */
+    bool Parse(std::span<const int> tokens, ParseStats* stats = nullptr) const;
+
+    /// @brief Bytes used by the dense action and goto tables.
+    size_t DenseBytes() const;
+
+    /// @brief Bytes used by the packed tables, defaults and rule metadata.
+    size_t PackedBytes() const;
+
+    /// @brief Bytes used by the equivalence-class tables.
+    size_t ClassBytes() const;
+
+    unsigned n_states_        = 0;
+    unsigned n_terminals_     = 0;
+    unsigned n_non_terminals_ = 0;
+
+    /// @brief Dense action table, `n_states_ * n_terminals_`.
+    std::vector<int> action_;
+    /// @brief Dense goto table, `n_states_ * n_non_terminals_`.
+    std::vector<int> goto_;
+
+    /// @brief Antecedent (non-terminal id) of every rule.
+    std::vector<unsigned> rule_lhs_;
+    /// @brief Number of symbols popped when reducing every rule.
+    std::vector<unsigned> rule_length_;
+
+    std::vector<int> action_base_;
+    std::vector<int> action_next_;
+    std::vector<int> action_check_;
+    /// @brief Default action of every state (a reduction or `kError`).
+    std::vector<int> default_;
+    /// @brief States with explicit error cells (from `%nonassoc`), which
+    /// must not fall back to a default reduction.
+    std::vector<char> no_default_;
+
+    std::vector<int> goto_base_;
+    std::vector<int> goto_next_;
+    std::vector<int> goto_check_;
+
+    /// @brief Action table with merged terminal columns and state rows.
+    ClassTable action_classes_;
+    /// @brief Goto table with merged non-terminal columns and state rows.
+    ClassTable goto_classes_;
+};
@@ -13,30 +13,74 @@
 #include <unordered_map>
 #include <vector>
 
+#include "analysis.hpp"
+#include "codegen.hpp"
+#include "first_follow.hpp"
 #include "grammar.hpp"
+#include "json_writer.hpp"
 #include "ll1_parser.hpp"
 #include "slr1_parser.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 namespace po = boost::program_options;
 
 class Shell {
   public:
+    /// @brief Output format of the commands run by `RunBatch`.
+    enum class Format { Text, Json };
+
     Shell();
 
     void Run();
 
+    /**
+     * @brief Runs commands without prompting, for `--script` and `-c`.
+     *
+     * Blank lines and lines starting with `#` are skipped, and `exit` stops
+     * without asking. With `Format::Text`, the output of every command is
+     * printed as in the interactive shell, without colors if the standard
+     * output is not a terminal. With `Format::Json`, every command prints a
+     * single line with a JSON object: the command, its arguments, whether it
+     * succeeded, and either its error, its result (load, first, follow,
+     * predsymbols, sets, ll1 and slr) or its plain text output.
+     *
+     * @param lines Commands to run, in order.
+     * @param format Output format.
+     * @return 0 if every command succeeded, 1 otherwise.
+     */
+    int RunBatch(const std::vector<std::string>& lines, Format format);
+
   private:
     Grammar    grammar;
     LL1Parser  ll1;
     SLR1Parser slr1;
+    bool       is_ll1  = false;
+    bool       is_slr1 = false;
+    /// @brief Threads used to build the canonical collection of new loads.
+    unsigned threads = 1;
+    /// @brief Whether the SLR(1) tables skip the reductions of unit rules.
+    bool unit_bypass = false;
+    /// @brief FIRST sets of the modules of the loaded grammars, reused by
+    /// the next loads while their files do not change.
+    first_follow::ModuleCache module_cache;
 
-    static std::unordered_map<
-        std::string, std::function<void(const std::vector<std::string>&)>>
+    std::unordered_map<std::string,
+                       std::function<void(const std::vector<std::string>&)>>
                 commands;
     bool        running = true;
+    /// @brief Shell running the interactive prompt, used by the readline
+    /// completion callbacks.
+    static Shell* instance;
     static void SignalHandler(int signum);
 
-    void          ExecuteCommand(const std::string& input);
+    bool   batch  = false;
+    Format format = Format::Text;
+    /// @brief Result of the last command in JSON mode, empty if it has none.
+    std::ostringstream result;
+
+    bool          ExecuteCommand(const std::string& input);
+    bool          RunBatchCommand(const std::string& input);
     void          PrintHistory();
     static char** ShellCompletion(const char* text, int start, int end);
     static char*  CommandGenerator(const char* text, int state);
@@ -45,15 +89,31 @@ class Shell {
     void          CmdHelp();
     void          CmdClear();
     void          CmdLoad(const std::vector<std::string>& args);
+    void          CmdEditRule(const std::vector<std::string>& args, bool add);
+    void          CmdWatch(const std::vector<std::string>& args);
+    void          AnalyzeGrammar();
+    void          Reanalyze(const std::string& filename);
+    void          CmdTransform(const std::vector<std::string>& args);
+    void          CmdPrune(const std::vector<std::string>& args);
     void          CmdGDebug();
     void          CmdFirst(const std::vector<std::string>& args);
     void          CmdFollow(const std::vector<std::string>& args);
     void          CmdPredictionSymbols(const std::vector<std::string>& args);
     void          CmdLL1Table(const std::vector<std::string>& args);
+    void          CmdSLR1Table(const std::vector<std::string>& args);
+    void          CmdSets(const std::vector<std::string>& args);
     void          CmdAllLRItems(const std::vector<std::string>& args);
     void          CmdClosure(const std::vector<std::string>& args);
     void          CmdDelta(const std::vector<std::string>& args);
     void          CmdCanonicalCollection(const std::vector<std::string>& args);
+    void          CmdTableStats(const std::vector<std::string>& args);
+    void          CmdCodegen(const std::vector<std::string>& args);
+    void          CmdStats(const std::vector<std::string>& args);
+    void          CmdAnalyze(const std::vector<std::string>& args);
+    void          CmdThreads(const std::vector<std::string>& args);
+    void          CmdUnitBypass(const std::vector<std::string>& args);
+    void          CmdCounterexamples(const std::vector<std::string>& args);
+    void          CmdTrace(const std::vector<std::string>& args);
     void          PrintSet(const std::unordered_set<std::string>& set);
     size_t LevenshteinDistance(const std::string& w1, const std::string& w2);
 };
\ No newline at end of file
@@ -3,11 +3,16 @@
 #include <map>
 #include <span>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
+#include "first_follow.hpp"
 #include "grammar.hpp"
 #include "lr0_item.hpp"
+#include "lr_table.hpp"
 #include "state.hpp"
+#include "symbol_index.hpp"
 
 class SLR1Parser {
   public:
@@ -55,6 +60,31 @@ class SLR1Parser {
     using action_table =
         std::map<unsigned int, std::map<std::string, SLR1Parser::s_action>>;
 
+    /**
+     * @brief A cell of the action table with more than one action.
+     *
+     * @var state Id of the state.
+     * @var symbol Terminal of the cell.
+     * @var kind `ShiftReduce` if an item shifts (or accepts on) `symbol`,
+     * `ReduceReduce` if only items of different rules reduce on it.
+     * @var items Every item of the state that shifts, accepts or reduces on
+     * `symbol`, sorted by their string form.
+     */
+    struct Conflict {
+        enum class Kind { ShiftReduce, ReduceReduce };
+
+        unsigned int         state;
+        std::string          symbol;
+        Kind                 kind;
+        std::vector<Lr0Item> items;
+    };
+
+    /**
+     * @brief Conflicts of the states that have any, by state id, each list
+     * sorted by symbol.
+     */
+    using conflict_table = std::map<unsigned int, std::vector<Conflict>>;
+
     /**
      * @brief Represents the transition table for the SLR(1) parser.
      *
@@ -73,6 +103,18 @@ class SLR1Parser {
     SLR1Parser() = default;
     SLR1Parser(Grammar gr);
 
+    /**
+     * @brief Constructs an SLR1Parser whose FIRST sets are already known,
+     * such as the ones of a `first_follow::ModuleCache`. Only FOLLOW is
+     * computed, and `MakeParser` keeps both.
+     *
+     * @param gr Grammar object to parse with.
+     * @param first_sets FIRST of every non-terminal of `gr`.
+     */
+    SLR1Parser(Grammar gr,
+               std::unordered_map<std::string, std::unordered_set<std::string>>
+                   first_sets);
+
     /**
      * @brief Retrieves all LR(0) items in the grammar.
      *
@@ -147,6 +189,62 @@ class SLR1Parser {
      */
     bool SolveLRConflicts(const state& st);
 
+    /**
+     * @brief Lists the conflicts of every state.
+     *
+     * @return The conflicts of `conflicts_`, sorted by state and symbol.
+     */
+    std::vector<Conflict> Conflicts() const;
+
+    /**
+     * @brief Counts the conflicts of every state.
+     *
+     * @return The number of conflicts in `conflicts_`.
+     */
+    size_t ConflictCount() const;
+
+    /**
+     * @brief Resolves a shift/reduce cell with the precedences of the
+     * grammar, as yacc does.
+     *
+     * The rule reduces if its precedence is higher than the one of the
+     * terminal, or equal and left associative, and shifts if it is lower or
+     * equal and right associative. Equal non-associative precedences make
+     * the cell an explicit `Empty` action, so that the input is rejected.
+     *
+     * @param symbol Terminal of the cell, whose shift is in `row`.
+     * @param reduce Only item that reduces on `symbol`.
+     * @param row Action row of the state.
+     * @return `false` if the rule or the terminal has no precedence, and the
+     * cell is a conflict.
+     */
+    bool SolveByPrecedence(const std::string& symbol, const Lr0Item& reduce,
+                           action_table::mapped_type& row) const;
+
+    /**
+     * @brief Builds the action row of a state and collects all its conflicts.
+     *
+     * Only `row` is written, so the rows of different states can be built
+     * concurrently. Shift/reduce cells are first resolved with
+     * `SolveByPrecedence`. A conflicting cell keeps the shift (or accept)
+     * action if there is one, and otherwise the reduction by the smallest
+     * rule.
+     *
+     * @param st The state whose row is built.
+     * @param row Action row of the state, filled by symbol.
+     * @param only Terminals of the cells to build, or null for all of them.
+     * @return The conflicts of the built cells, sorted by symbol.
+     */
+    std::vector<Conflict>
+    ActionRow(const state& st, action_table::mapped_type& row,
+              const std::unordered_set<std::string>* only = nullptr);
+
+    /**
+     * @brief Builds the action row of every state, on `threads_` threads,
+     * and stores them in `actions_` and their conflicts in `conflicts_`.
+     */
+    void MakeActions();
+
     /**
      * @brief Calculates the FIRST set for a given production rule in a grammar.
      *
@@ -254,7 +352,8 @@ class SLR1Parser {
      * collection of LR(0) items, generating the action and transition tables,
      * and resolving conflicts (if any). It returns `true` if the grammar is
      * SLR(1) and the tables are successfully constructed, or `false` if a
-     * conflict is detected that cannot be resolved.
+     * conflict is detected that cannot be resolved. Every state is checked,
+     * so `conflicts_` holds all the conflicts of the grammar.
      *
      * @return `true` if the parsing tables are successfully constructed,
      * `false` if the grammar is not SLR(1) or a conflict is encountered.
@@ -265,6 +364,194 @@ class SLR1Parser {
      */
     bool MakeParser();
 
+    /**
+     * @brief Adds a rule to the grammar and updates the parser, with
+     * `EditRules`.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Right-hand side of the rule.
+     * @return `false` if the rule was rejected (see `Grammar::InsertRule`).
+     */
+    bool AddRule(const std::string& antecedent, const production& consequent);
+
+    /**
+     * @brief Removes a rule from the grammar and updates the parser, like
+     * `AddRule`.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Right-hand side of the rule.
+     * @return `false` if the rule was rejected (see `Grammar::RemoveRule`).
+     */
+    bool RemoveRule(const std::string& antecedent,
+                    const production&  consequent);
+
+    /**
+     * @brief Applies rule edits and updates the parser.
+     *
+     * FIRST and FOLLOW are updated with `first_follow::Update` after every
+     * edit, and the automaton and tables are updated once, with `Rebuild`,
+     * for the edits accepted.
+     *
+     * @param edits Edits, in the order `Grammar::EditsTo` gives them.
+     * @return `false` if an edit was rejected. The edits before it are kept.
+     */
+    bool EditRules(const std::vector<RuleEdit>& edits);
+
+    /**
+     * @brief Updates the automaton and tables after some rules changed, with
+     * the grammar, FIRST and FOLLOW already updated.
+     *
+     * States are identified by their kernel, with `state_index_`. Only the
+     * states with an item of an edited antecedent can change: they are closed
+     * again, their successors are computed again, and successor kernels that
+     * no state has become new states. Every other state keeps its items, its
+     * transitions and its id, except the states that are no longer
+     * reachable, which are removed; the states with the highest ids then take
+     * their ids, so that ids stay dense.
+     *
+     * The action rows and conflicts of the changed, new and renumbered
+     * states are built again. The other states that reduce a non-terminal
+     * whose FOLLOW changed only build again their cells on the terminals
+     * that changed. Only those rows (and the ones with shifts or gotos to a
+     * renumbered state) are patched in the flat tables, with
+     * `PatchFlatTable`.
+     *
+     * @param edits Rule edits applied to the grammar.
+     * @param changes Non-terminals whose FOLLOW changed, and the terminals
+     * that changed in them, from `first_follow::Update`.
+     * @return `true` if the grammar is still SLR(1). Otherwise `table_` is
+     * emptied, and the next edit builds it again.
+     */
+    bool Rebuild(std::span<const RuleEdit>    edits,
+                 const first_follow::Changes& changes);
+
+    /**
+     * @brief Builds `state_index_` from `states_`.
+     */
+    void IndexStates();
+
+    /**
+     * @brief Adds a state to `state_index_`.
+     *
+     * @param st State of `states_`, with its items and id.
+     */
+    void Index(const state& st);
+
+    /**
+     * @brief Removes a state from `state_index_`, before its items change or
+     * it is erased.
+     *
+     * @param st State of `states_`, with the items it was indexed with.
+     */
+    void Unindex(const state& st);
+
+    /**
+     * @brief Computes the goto kernels of a set of items.
+     *
+     * @param items Closed set of items of a state.
+     * @return For every symbol after a dot (except EPSILON and EOL), in name
+     * order, the items obtained by moving the dot over it.
+     */
+    std::map<std::string, std::unordered_set<Lr0Item>>
+    Kernels(const std::unordered_set<Lr0Item>& items) const;
+
+    /**
+     * @brief Computes the closed goto kernels of a set of items.
+     *
+     * @param items Closed set of items of a state.
+     * @return The closure of every kernel of `Kernels`.
+     */
+    std::map<std::string, std::unordered_set<Lr0Item>>
+    Successors(const std::unordered_set<Lr0Item>& items);
+
+    /**
+     * @brief Builds the canonical collection from the initial state, one
+     * state at a time.
+     *
+     * States are numbered in breadth-first order, expanding the successors of
+     * every state in symbol name order.
+     */
+    void MakeCollection();
+
+    /**
+     * @brief Builds the canonical collection like `MakeCollection`, but
+     * expands every breadth-first wave of states on `threads_` threads.
+     *
+     * While a wave is expanded, successors are deduplicated in a sharded hash
+     * map. Ids are then assigned in the order of `MakeCollection`, so both
+     * functions produce the same states and transitions.
+     */
+    void MakeCollectionParallel();
+
+    /**
+     * @brief Builds the flat, integer-indexed tables from `actions_` and
+     * `transitions_`.
+     *
+     * Symbols are numbered with `SymbolIndex`, the dense action and goto
+     * tables are filled from the map-based ones, unit rules are bypassed if
+     * `bypass_unit_rules_` is set, and then packed with row displacement
+     * compression (see `LRTable`). Called by `MakeParser` once the tables are
+     * known to be conflict-free.
+     *
+     * @see table_
+     * @see index_
+     */
+    void BuildFlatTable();
+
+    /**
+     * @brief Fills the dense action and goto rows of a state of `table_`
+     * from `actions_` and `transitions_`, clearing them first.
+     *
+     * @param st Id of the state.
+     * @param only Terminals of the only action cells to fill again, keeping
+     * the gotos, or null to fill both rows.
+     */
+    void FillFlatRow(unsigned                               st,
+                     const std::unordered_set<std::string>* only = nullptr);
+
+    /**
+     * @brief Updates the flat tables after `Rebuild` changed some rows.
+     *
+     * The edits are numbered with `SymbolIndex::AddRule` and
+     * `SymbolIndex::RemoveRule`, which move no rule but the last one, whose
+     * rows are added to `rows`. The dense tables are resized to the new
+     * number of states, `rows` and the `terminals` cells of `cells` are
+     * filled again, and both are packed with `LRTable::PatchRows`. The
+     * tables are built again with `BuildFlatTable` if there were none for
+     * `previous` states, if the symbols changed or if unit rules are
+     * bypassed, since a bypass can change the gotos of any state.
+     *
+     * @param edits Rule edits applied to the grammar.
+     * @param rows Ids of the rows to fill again.
+     * @param cells Ids of the rows where only the cells of `terminals`
+     * changed.
+     * @param terminals Terminals of the changed cells of `cells`.
+     * @param previous Number of states before the edit.
+     */
+    void
+    PatchFlatTable(std::span<const RuleEdit>              edits,
+                   std::vector<unsigned>                  rows,
+                   const std::vector<unsigned>&           cells,
+                   const std::unordered_set<std::string>& terminals,
+                   unsigned                               previous);
+
+    /**
+     * @brief Estimates the heap footprint of `actions_` and `transitions_`.
+     *
+     * Every `std::map` node is counted as its value plus the red-black tree
+     * node header, and symbols longer than the small string buffer are counted
+     * with their heap allocation.
+     *
+     * @return Approximate number of bytes used by the map-based tables.
+     */
+    size_t MapTableBytes() const;
+
+    /**
+     * @brief Prints the size of the map-based, dense and packed tables and the
+     * average latency of a single action lookup in each of them.
+     */
+    void DebugTableStats();
+
     void TeachAllItems();
     void TeachClosure(std::unordered_set<Lr0Item>& items);
     void TeachClosureUtil(std::unordered_set<Lr0Item>& items, unsigned int size,
@@ -289,10 +576,65 @@ class SLR1Parser {
     /// actions.
     action_table actions_;
 
+    /// @brief Conflicts found by `MakeParser`, by state.
+    conflict_table conflicts_;
+
     /// @brief The transition table used by the parser to determine state
     /// transitions.
     transition_table transitions_;
 
     /// @brief The set of states in the parser's state machine.
     std::unordered_set<state> states_;
+
+    /**
+     * @brief Indexes of `states_` kept between edits by `Rebuild`, and built
+     * on the first edit. A copy starts empty, since the indexes point into
+     * the `states_` of the original.
+     */
+    struct StateIndex {
+        StateIndex() = default;
+        StateIndex(const StateIndex&) {}
+        StateIndex(StateIndex&&) = default;
+        StateIndex& operator=(const StateIndex&) {
+            return *this = StateIndex();
+        }
+        StateIndex& operator=(StateIndex&&) = default;
+
+        /// @brief Every state by id.
+        std::vector<const state*> by_id;
+        /// @brief States by the hash of their kernel (see `ItemSetHash`),
+        /// except the initial state.
+        std::unordered_multimap<size_t, const state*> by_kernel;
+        /// @brief States with an item of each non-terminal.
+        std::unordered_map<std::string, std::unordered_set<const state*>>
+            by_antecedent;
+        /// @brief States with a complete item of each non-terminal.
+        std::unordered_map<std::string, std::unordered_set<const state*>>
+            reducing;
+    };
+
+    /// @brief Indexes of `states_` used by `Rebuild`.
+    StateIndex state_index_;
+
+    /// @brief Integer numbering of the symbols and rules used by `table_`.
+    SymbolIndex index_;
+
+    /// @brief Flat, compressed action and goto tables.
+    LRTable table_;
+
+    /// @brief Threads used to compute FIRST and FOLLOW (see `first_follow`),
+    /// the canonical collection and the action rows, 1 to do it all
+    /// sequentially.
+    unsigned threads_ = 1;
+
+    /// @brief Whether `BuildFlatTable` skips the chain reductions of unit
+    /// rules (see `LRTable::BypassUnitRules`).
+    bool bypass_unit_rules_ = false;
+
+    /// @brief Goto entries changed by the last unit rule bypass.
+    size_t unit_bypasses_ = 0;
+
+    /// @brief Whether FIRST was given to the constructor, so that
+    /// `MakeParser` does not compute FIRST and FOLLOW again.
+    bool sets_given_ = false;
 };
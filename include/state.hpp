@@ -60,3 +60,17 @@ template <> struct hash<state> {
     }
 };
 } // namespace std
+
+/**
+ * @brief Hash of a set of LR(0) items, the same as `std::hash<state>` of a
+ * state with those items.
+ */
+struct ItemSetHash {
+    size_t operator()(const std::unordered_set<Lr0Item>& items) const {
+        size_t seed = 0;
+        for (const Lr0Item& item : items) {
+            seed ^= std::hash<Lr0Item>()(item);
+        }
+        return seed;
+    }
+};
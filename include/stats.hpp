@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "trace.hpp"
+
+/**
+ * @brief Per-phase instrumentation of `Grammar`, `LL1Parser` and
+ * `SLR1Parser`.
+ *
+ * Every phase is wrapped in a `ScopedTimer`, which adds its wall time and the
+ * bytes allocated during it to the counters of the phase. Phases
+ * also count their iterations: fixed-point rounds for FIRST and FOLLOW,
+ * recursion rounds for closure and states for the canonical collection.
+ * Nested phases (for example, closure inside the canonical collection) are
+ * included in the time of their parent.
+ *
+ * Collection is disabled by default. While disabled, a timer or an iteration
+ * counter costs a single relaxed atomic load.
+ *
+ * Heap allocations are counted by the global `operator new` overloads of
+ * `heap_counter.cpp`, which only plshell, the tests and the benchmarks link.
+ * Without them, or while `heap_enabled` is off, an allocation costs one
+ * relaxed load more and nothing is counted. Every thread counts in one of
+ * `kHeapSlots` slots on cache lines of their own, and a phase adds up all of
+ * them, so it gets the allocations of the `ThreadPool` workers of a parallel
+ * phase, and also of any other thread that runs at the same time, such as
+ * the other grammars of `analyze`.
+ */
+namespace stats {
+
+enum class Phase {
+    Load,
+    Split,
+    First,
+    Follow,
+    LL1Table,
+    Closure,
+    Collection,
+    Conflicts,
+    FlatTable,
+    Count
+};
+
+inline constexpr std::size_t kPhases = static_cast<std::size_t>(Phase::Count);
+
+/**
+ * @brief Accumulated counters of a phase.
+ */
+struct Counters {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> nanoseconds{0};
+    std::atomic<std::uint64_t> iterations{0};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> bytes{0};
+};
+
+inline std::atomic<bool>              enabled{false};
+inline std::array<Counters, kPhases> counters;
+
+/**
+ * @brief Heap counters of the threads that share a slot, alone in their
+ * cache line so that threads in different slots do not contend.
+ */
+struct alignas(64) HeapSlot {
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> bytes{0};
+};
+
+inline constexpr std::size_t kHeapSlots = 16;
+
+/// @brief Whether the `operator new` of `heap_counter.cpp` counts.
+inline std::atomic<bool>                heap_enabled{false};
+inline std::array<HeapSlot, kHeapSlots> heap_slots;
+
+inline bool Enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+inline bool HeapEnabled() {
+    return heap_enabled.load(std::memory_order_relaxed);
+}
+
+/// @brief Allocations counted in every slot.
+inline std::uint64_t HeapAllocations() {
+    std::uint64_t total = 0;
+    for (const HeapSlot& slot : heap_slots) {
+        total += slot.allocations.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/// @brief Bytes allocated in every slot.
+inline std::uint64_t HeapBytes() {
+    std::uint64_t total = 0;
+    for (const HeapSlot& slot : heap_slots) {
+        total += slot.bytes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/// @brief Human readable name of a phase.
+const char* Name(Phase phase);
+
+/// @brief Sets every counter to zero.
+void Reset();
+
+/// @brief Prints the counters of every phase that ran as a table.
+void Print(std::ostream& os);
+
+/// @brief Counters of a phase.
+inline Counters& Get(Phase phase) {
+    return counters[static_cast<std::size_t>(phase)];
+}
+
+/// @brief Adds `n` iterations to a phase if collection is enabled.
+inline void AddIterations(Phase phase, std::uint64_t n = 1) {
+    if (Enabled()) {
+        Get(phase).iterations.fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Adds the wall time and the allocations of its scope to a phase. If
+ * tracing is on, the scope is also recorded as a trace event.
+ */
+class ScopedTimer {
+  public:
+    explicit ScopedTimer(Phase phase)
+        : phase_(phase), active_(Enabled()), trace_(Name(phase)) {
+        if (active_) {
+            allocations_ = HeapAllocations();
+            bytes_       = HeapBytes();
+            start_       = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (!active_) {
+            return;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        Counters&  c       = Get(phase_);
+        c.calls.fetch_add(1, std::memory_order_relaxed);
+        c.nanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count(),
+            std::memory_order_relaxed);
+        c.allocations.fetch_add(HeapAllocations() - allocations_,
+                                std::memory_order_relaxed);
+        c.bytes.fetch_add(HeapBytes() - bytes_, std::memory_order_relaxed);
+    }
+
+    ScopedTimer(const ScopedTimer&)            = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  private:
+    Phase                                 phase_;
+    bool                                  active_;
+    trace::Scope                          trace_;
+    std::uint64_t                         allocations_ = 0;
+    std::uint64_t                         bytes_       = 0;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace stats
@@ -0,0 +1,127 @@
+#pragma once
+#include "grammar.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Dense integer numbering of the symbols and productions of a grammar.
+ *
+ * Terminals are numbered from 0, with the end-of-input marker always taking
+ * id 0. Epsilon is not a symbol and is never numbered. Non-terminals are
+ * numbered from 0 with the axiom first; the remaining ones are sorted by name
+ * so that the numbering is stable across runs.
+ *
+ * Inside a rule body, a terminal is encoded as its terminal id and a
+ * non-terminal `N` as `terminals_.size() + id(N)`, so a single integer is
+ * enough to tell both kinds of symbol apart. Epsilon productions have an empty
+ * body.
+ */
+struct SymbolIndex {
+    /**
+     * @brief A production rule with integer symbols.
+     */
+    struct Rule {
+        /// @brief Non-terminal id of the antecedent.
+        int lhs_;
+        /// @brief Encoded symbols of the consequent, empty for epsilon.
+        std::vector<int> rhs_;
+    };
+
+    SymbolIndex() = default;
+
+    /**
+     * @brief Numbers every symbol and production of the given grammar.
+     *
+     * @param gr The grammar to index.
+     */
+    explicit SymbolIndex(const Grammar& gr);
+
+    /**
+     * @brief Returns the id of a terminal symbol.
+     *
+     * @param s Terminal symbol.
+     * @return The terminal id, or -1 if `s` is not a terminal.
+     */
+    int TerminalId(const std::string& s) const;
+
+    /**
+     * @brief Returns the id of a non-terminal symbol.
+     *
+     * @param s Non-terminal symbol.
+     * @return The non-terminal id, or -1 if `s` is not a non-terminal.
+     */
+    int NonTerminalId(const std::string& s) const;
+
+    /**
+     * @brief Returns the id of a production rule.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Right-hand side of the rule, as stored in the grammar.
+     * @return The rule id, or -1 if the rule is not in the grammar.
+     */
+    int RuleId(const std::string& antecedent,
+               const production&  consequent) const;
+
+    /**
+     * @brief Numbers a rule added to the grammar after the index was built.
+     *
+     * The rule takes the next id, so no other rule is renumbered.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Right-hand side of the rule, as stored in the grammar.
+     * @return The id of the rule, or -1 if it uses a symbol without id, and
+     * the index must be built again.
+     */
+    int AddRule(const std::string& antecedent, const production& consequent);
+
+    /**
+     * @brief Drops a rule removed from the grammar after the index was built.
+     *
+     * The last rule takes the id of the removed one, so no other rule is
+     * renumbered.
+     *
+     * @param antecedent Left-hand side of the rule.
+     * @param consequent Right-hand side of the rule, as stored in the grammar.
+     * @return The id the rule had, or -1 if it is not in the index.
+     */
+    int RemoveRule(const std::string& antecedent,
+                   const production&  consequent);
+
+    /**
+     * @brief Checks whether an encoded body symbol is a terminal.
+     */
+    bool IsTerminal(int symbol) const {
+        return symbol < static_cast<int>(terminals_.size());
+    }
+
+    /**
+     * @brief Returns the name of an encoded body symbol.
+     */
+    const std::string& Name(int symbol) const {
+        return IsTerminal(symbol) ? terminals_[symbol]
+                                  : non_terminals_[symbol - terminals_.size()];
+    }
+
+    /// @brief Terminal names indexed by id. `terminals_[0]` is EOL.
+    std::vector<std::string> terminals_;
+
+    /// @brief Non-terminal names indexed by id. `non_terminals_[0]` is the
+    /// axiom.
+    std::vector<std::string> non_terminals_;
+
+    /// @brief All production rules, grouped by antecedent in id order until
+    /// `AddRule` or `RemoveRule` change them.
+    std::vector<Rule> rules_;
+
+    /// @brief Original (string) consequent of every rule, indexed by rule id.
+    std::vector<production> consequents_;
+
+  private:
+    std::unordered_map<std::string, int> terminal_ids_;
+    std::unordered_map<std::string, int> non_terminal_ids_;
+    /// @brief Rule ids of each non-terminal.
+    std::vector<std::vector<int>> rules_of_;
+    /// @brief Epsilon symbol of the grammar, which has no id.
+    std::string epsilon_;
+};
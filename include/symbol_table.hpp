@@ -62,6 +62,18 @@ struct SymbolTable {
      */
     std::unordered_set<std::string> non_terminals_;
 
+    /**
+     * @brief Name of a symbol of a module outside of it.
+     *
+     * @param module Namespace of the module, empty for the loaded file.
+     * @param identifier Name of the symbol inside the module.
+     * @return `module.identifier`, or `identifier` if `module` is empty.
+     */
+    static std::string Qualify(const std::string& module,
+                               const std::string& identifier) {
+        return module.empty() ? identifier : module + "." + identifier;
+    }
+
     /**
      * @brief Adds a non-terminal symbol to the symbol table.
      *
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Work-stealing thread pool.
+ *
+ * Every worker owns a deque of tasks. Tasks submitted from a worker go to the
+ * back of its own deque, and tasks submitted from any other thread are
+ * distributed round-robin. A worker takes tasks from the back of its own
+ * deque (the most recent, whose data is likely still in cache) and, when it
+ * is empty, steals from the front of the others, so long tasks do not leave
+ * the rest of the workers idle.
+ *
+ * The first exception thrown by a task is rethrown by `Wait`.
+ */
+class ThreadPool {
+  public:
+    /**
+     * @brief Starts the workers.
+     *
+     * @param threads Number of workers, 0 for one per hardware thread.
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    /// @brief Waits for the pending tasks and joins the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// @brief Queues a task. It may be called from a running task.
+    void Submit(std::function<void()> task);
+
+    /**
+     * @brief Blocks until every submitted task, including the ones submitted
+     * by other tasks, has finished.
+     *
+     * @throws The first exception thrown by a task since the last `Wait`.
+     */
+    void Wait();
+
+    /// @brief Number of workers.
+    unsigned Size() const { return static_cast<unsigned>(threads_.size()); }
+
+  private:
+    struct Worker {
+        std::mutex                        mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void Loop(unsigned id);
+
+    /// @brief Pops from the back of the own deque or steals from another.
+    bool TryPop(unsigned id, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread>             threads_;
+    std::mutex                           mutex_;
+    std::condition_variable              work_;
+    std::condition_variable              idle_;
+    /// @brief Tasks waiting in a deque.
+    std::atomic<size_t> queued_{0};
+    /// @brief Tasks submitted and not finished yet.
+    std::atomic<size_t>   pending_{0};
+    std::atomic<unsigned> next_{0};
+    std::exception_ptr    error_;
+    bool                  stop_ = false;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Chrome trace-event export of the analysis and parsing phases.
+ *
+ * While tracing is on, `Scope` objects record nested begin/end events into a
+ * ring buffer that is allocated once by `Start`, so recording an event is an
+ * atomic increment and a store. `Stop` writes the buffer as a JSON trace that
+ * can be opened with `chrome://tracing` or Perfetto. When the buffer is full,
+ * the oldest events are overwritten, and end events whose begin event was
+ * lost are left out of the file.
+ *
+ * Every `stats::ScopedTimer` also records a scope named after its phase, so
+ * the traced phases are the same ones reported by the `stats` command, plus
+ * the waves of the canonical collection and the parses.
+ */
+namespace trace {
+
+/**
+ * @brief A recorded event. Names must be string literals, they are not
+ * copied.
+ */
+struct Event {
+    const char*   name;
+    char          phase; ///< 'B' (begin) or 'E' (end).
+    std::uint32_t tid;
+    std::int64_t  ns;  ///< Nanoseconds since `Start`.
+    std::int64_t  arg; ///< Optional argument, -1 if there is none.
+};
+
+inline std::atomic<bool> enabled{false};
+
+inline bool Enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Starts tracing into a new ring buffer.
+ *
+ * @param path File the trace is written to by `Stop`.
+ * @param capacity Number of events kept in the ring buffer.
+ * @return `false` if tracing was already on.
+ */
+bool Start(const std::string& path, std::size_t capacity = 1 << 20);
+
+/**
+ * @brief Stops tracing and writes the recorded events.
+ *
+ * @return `false` if tracing was off or the file could not be written.
+ */
+bool Stop();
+
+/// @brief Path given to `Start`.
+const std::string& Path();
+
+/// @brief Events recorded since `Start`, including the overwritten ones.
+std::size_t Recorded();
+
+/// @brief Events overwritten because the ring buffer was full.
+std::size_t Dropped();
+
+/// @brief Records an event, tracing must be on.
+void Record(const char* name, char phase, std::int64_t arg = -1);
+
+/**
+ * @brief Records a begin event on construction and the matching end event on
+ * destruction, if tracing was on when it was constructed.
+ */
+class Scope {
+  public:
+    explicit Scope(const char* name, std::int64_t arg = -1)
+        : name_(name), active_(Enabled()) {
+        if (active_) {
+            Record(name_, 'B', arg);
+        }
+    }
+
+    ~Scope() {
+        if (active_) {
+            Record(name_, 'E');
+        }
+    }
+
+    Scope(const Scope&)            = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    const char* name_;
+    bool        active_;
+};
+
+} // namespace trace
@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../../include/codegen.hpp"
+#include "../../include/lr_table.hpp"
+#include "../../include/symbol_index.hpp"
+
+namespace codegen {
+namespace {
+
+/// Turns an arbitrary symbol into a valid C++ identifier fragment.
+std::string Sanitize(const std::string& s) {
+    std::string id;
+    for (char c : s) {
+        id += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    return id;
+}
+
+/// Names of the token enumerators, `TOK_EOL` for the end-of-input marker.
+std::vector<std::string> TokenNames(const SymbolIndex& index) {
+    std::vector<std::string>        names{"TOK_EOL"};
+    std::unordered_set<std::string> used{"TOK_EOL"};
+    for (size_t t = 1; t < index.terminals_.size(); ++t) {
+        std::string name = "TOK_" + Sanitize(index.terminals_[t]);
+        if (!used.insert(name).second) {
+            name += "_" + std::to_string(t);
+            used.insert(name);
+        }
+        names.push_back(name);
+    }
+    return names;
+}
+
+std::string RuleToString(const SymbolIndex& index, unsigned rule) {
+    const SymbolIndex::Rule& r = index.rules_[rule];
+    std::string str = index.non_terminals_[r.lhs_] + " ->";
+    for (int symbol : r.rhs_) {
+        str += " " + index.Name(symbol);
+    }
+    return str;
+}
+
+/// Namespace of the generated code, derived from the output file name.
+std::string NamespaceFor(const std::filesystem::path& out) {
+    std::string ns = Sanitize(out.stem().string());
+    if (ns.empty() || std::isdigit(static_cast<unsigned char>(ns[0]))) {
+        ns = "p_" + ns;
+    }
+    return ns;
+}
+
+/// Writes the runtime header shared by every generated parser.
+bool WriteHeader(const std::filesystem::path& path, const std::string& ns,
+                 const SymbolIndex& index, const std::string& kind) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+    const std::vector<std::string> tokens = TokenNames(index);
+
+    out << "// " << kind << " parser generated by PLShell. Do not edit.\n";
+    out << "#pragma once\n\n";
+    out << "#include <cstddef>\n\n";
+    out << "namespace " << ns << " {\n\n";
+    out << "/// Terminal ids. The input must be a sequence of these values,\n";
+    out << "/// optionally terminated by TOK_EOL.\n";
+    out << "enum Token : int {\n";
+    for (size_t t = 0; t < tokens.size(); ++t) {
+        out << "    " << tokens[t] << " = " << t << ", // "
+            << index.terminals_[t] << "\n";
+    }
+    out << "};\n\n";
+    out << "/// Maximum nesting depth, Parse fails when it is exceeded.\n";
+    out << "constexpr std::size_t kMaxDepth = 4096;\n\n";
+    out << "/// Returns true if the tokens are a sentence of the grammar.\n";
+    out << "bool Parse(const int* tokens, std::size_t n);\n\n";
+    out << "} // namespace " << ns << "\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+bool WriteSLR1Parser(const SLR1Parser& parser, const std::string& out_path) {
+    const LRTable&     table = parser.table_;
+    const SymbolIndex& index = parser.index_;
+    if (table.n_states_ == 0) {
+        return false;
+    }
+
+    const std::filesystem::path cpp_path(out_path);
+    std::filesystem::path       hpp_path(cpp_path);
+    hpp_path.replace_extension(".hpp");
+    const std::string ns = NamespaceFor(cpp_path);
+    if (!WriteHeader(hpp_path, ns, index, "SLR(1)")) {
+        return false;
+    }
+    const std::vector<std::string> tokens = TokenNames(index);
+
+    // Hot states first: the initial state, then by number of incoming edges
+    std::vector<unsigned> in_degree(table.n_states_, 0);
+    for (unsigned s = 0; s < table.n_states_; ++s) {
+        for (unsigned t = 0; t < table.n_terminals_; ++t) {
+            const int a = table.DenseAction(s, t);
+            if (LRTable::IsShift(a)) {
+                ++in_degree[LRTable::Target(a)];
+            }
+        }
+        for (unsigned nt = 0; nt < table.n_non_terminals_; ++nt) {
+            const int g = table.DenseGoto(s, nt);
+            if (g >= 0) {
+                ++in_degree[g];
+            }
+        }
+    }
+    std::vector<unsigned> layout(table.n_states_);
+    std::iota(layout.begin(), layout.end(), 0);
+    std::stable_sort(layout.begin() + 1, layout.end(),
+                     [&](unsigned a, unsigned b) {
+                         return in_degree[a] > in_degree[b];
+                     });
+
+    std::ofstream out(cpp_path);
+    if (!out.is_open()) {
+        return false;
+    }
+    out << "// SLR(1) parser generated by PLShell. Do not edit.\n";
+    out << "#include \"" << hpp_path.filename().string() << "\"\n\n";
+    out << "namespace " << ns << " {\n\n";
+    out << "bool Parse(const int* tokens, std::size_t n) {\n";
+    out << "    unsigned    stack[kMaxDepth];\n";
+    out << "    std::size_t sp  = 0;\n";
+    out << "    std::size_t pos = 0;\n";
+    out << "    int         tok = n > 0 ? tokens[0] : TOK_EOL;\n\n";
+    out << "    goto state_0;\n\n";
+
+    auto emit_action = [&](int a) {
+        if (a == LRTable::kAccept) {
+            out << "        return pos >= n || (pos == n - 1 && tok == "
+                   "TOK_EOL);\n";
+        } else if (LRTable::IsShift(a)) {
+            out << "        if (pos >= n || ++sp == kMaxDepth)\n";
+            out << "            return false;\n";
+            out << "        tok = ++pos < n ? tokens[pos] : TOK_EOL;\n";
+            out << "        goto state_" << LRTable::Target(a) << ";\n";
+        } else if (LRTable::IsReduce(a)) {
+            const unsigned rule = LRTable::Rule(a);
+            out << "        // " << RuleToString(index, rule) << "\n";
+            if (table.rule_length_[rule] > 0) {
+                out << "        sp -= " << table.rule_length_[rule] << ";\n";
+            }
+            out << "        goto goto_" << table.rule_lhs_[rule] << ";\n";
+        } else {
+            out << "        return false;\n";
+        }
+    };
+
+    for (unsigned s : layout) {
+        out << "state_" << s << ":\n";
+        out << "    stack[sp] = " << s << ";\n";
+        out << "    switch (tok) {\n";
+        const int fallback = table.default_[s];
+        // Group the terminals that share the same action under one case list
+        std::vector<bool> done(table.n_terminals_, false);
+        for (unsigned t = 0; t < table.n_terminals_; ++t) {
+            const int a = table.DenseAction(s, t);
+            if (done[t] || a == LRTable::kError || a == fallback) {
+                continue;
+            }
+            for (unsigned u = t; u < table.n_terminals_; ++u) {
+                if (!done[u] && table.DenseAction(s, u) == a) {
+                    out << "    case " << tokens[u] << ":\n";
+                    done[u] = true;
+                }
+            }
+            emit_action(a);
+        }
+        out << "    default:\n";
+        emit_action(fallback);
+        out << "    }\n\n";
+    }
+
+    // Goto dispatchers: one per non-terminal, on the exposed state
+    for (unsigned nt = 0; nt < table.n_non_terminals_; ++nt) {
+        const bool reachable = std::any_of(
+            table.rule_lhs_.begin(), table.rule_lhs_.end(),
+            [&](unsigned lhs) { return lhs == nt && nt != 0; });
+        if (!reachable) {
+            continue;
+        }
+        out << "goto_" << nt << ": // " << index.non_terminals_[nt] << "\n";
+        out << "    switch (stack[sp]) {\n";
+        std::vector<bool> done(table.n_states_, false);
+        for (unsigned s = 0; s < table.n_states_; ++s) {
+            const int g = table.DenseGoto(s, nt);
+            if (done[s] || g < 0) {
+                continue;
+            }
+            for (unsigned u = s; u < table.n_states_; ++u) {
+                if (!done[u] && table.DenseGoto(u, nt) == g) {
+                    out << "    case " << u << ":\n";
+                    done[u] = true;
+                }
+            }
+            out << "        if (++sp == kMaxDepth)\n";
+            out << "            return false;\n";
+            out << "        goto state_" << g << ";\n";
+        }
+        out << "    default:\n";
+        out << "        return false;\n";
+        out << "    }\n\n";
+    }
+    out << "}\n\n";
+    out << "} // namespace " << ns << "\n";
+    return static_cast<bool>(out);
+}
+
+bool WriteLL1Parser(const LL1Parser& parser, const std::string& out_path) {
+    const ClassTable&  table = parser.compressed_;
+    const SymbolIndex& index = parser.index_;
+    if (table.n_rows_ == 0 ||
+        std::find(table.cells_.begin(), table.cells_.end(),
+                  LL1Parser::kConflict) != table.cells_.end()) {
+        return false;
+    }
+
+    const std::filesystem::path cpp_path(out_path);
+    std::filesystem::path       hpp_path(cpp_path);
+    hpp_path.replace_extension(".hpp");
+    const std::string ns = NamespaceFor(cpp_path);
+    if (!WriteHeader(hpp_path, ns, index, "LL(1)")) {
+        return false;
+    }
+    const std::vector<std::string> tokens = TokenNames(index);
+    const unsigned n_terminals            = index.terminals_.size();
+    const unsigned n_non_terminals        = index.non_terminals_.size();
+
+    auto function_name = [&](unsigned nt) {
+        return "parse_" + std::to_string(nt) + "_" +
+               Sanitize(index.non_terminals_[nt]);
+    };
+
+    std::ofstream out(cpp_path);
+    if (!out.is_open()) {
+        return false;
+    }
+    out << "// LL(1) parser generated by PLShell. Do not edit.\n";
+    out << "#include \"" << hpp_path.filename().string() << "\"\n\n";
+    out << "namespace " << ns << " {\n";
+    out << "namespace {\n\n";
+    out << "struct Input {\n";
+    out << "    const int*  tokens;\n";
+    out << "    std::size_t n;\n";
+    out << "    std::size_t pos   = 0;\n";
+    out << "    std::size_t depth = 0;\n\n";
+    out << "    int Peek() const { return pos < n ? tokens[pos] : TOK_EOL; }\n";
+    out << "    bool Expect(int token) {\n";
+    out << "        if (Peek() != token)\n";
+    out << "            return false;\n";
+    out << "        if (pos < n)\n";
+    out << "            ++pos;\n";
+    out << "        return true;\n";
+    out << "    }\n";
+    out << "};\n\n";
+    out << "struct DepthGuard {\n";
+    out << "    explicit DepthGuard(Input& in) : in(in) { ++in.depth; }\n";
+    out << "    ~DepthGuard() { --in.depth; }\n";
+    out << "    Input& in;\n";
+    out << "};\n\n";
+    for (unsigned nt = 0; nt < n_non_terminals; ++nt) {
+        out << "bool " << function_name(nt) << "(Input& in);\n";
+    }
+    out << "\n";
+
+    for (unsigned nt = 0; nt < n_non_terminals; ++nt) {
+        out << "bool " << function_name(nt) << "(Input& in) {\n";
+        out << "    DepthGuard guard(in);\n";
+        out << "    if (in.depth > kMaxDepth)\n";
+        out << "        return false;\n";
+        out << "    switch (in.Peek()) {\n";
+        std::vector<bool> done(n_terminals, false);
+        for (unsigned t = 0; t < n_terminals; ++t) {
+            const int rule = table.Lookup(nt, t);
+            if (done[t] || rule < 0) {
+                continue;
+            }
+            for (unsigned u = t; u < n_terminals; ++u) {
+                if (!done[u] && table.Lookup(nt, u) == rule) {
+                    out << "    case " << tokens[u] << ":\n";
+                    done[u] = true;
+                }
+            }
+            out << "        // " << RuleToString(index, rule) << "\n";
+            for (int symbol : index.rules_[rule].rhs_) {
+                if (index.IsTerminal(symbol)) {
+                    out << "        if (!in.Expect(" << tokens[symbol]
+                        << "))\n";
+                } else {
+                    out << "        if (!" << function_name(symbol - n_terminals)
+                        << "(in))\n";
+                }
+                out << "            return false;\n";
+            }
+            out << "        return true;\n";
+        }
+        out << "    default:\n";
+        out << "        return false;\n";
+        out << "    }\n";
+        out << "}\n\n";
+    }
+    out << "} // namespace\n\n";
+    out << "bool Parse(const int* tokens, std::size_t n) {\n";
+    out << "    Input in{tokens, n};\n";
+    out << "    return " << function_name(0) << "(in) && in.pos >= n;\n";
+    out << "}\n\n";
+    out << "} // namespace " << ns << "\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace codegen
@@ -1,7 +1,70 @@
+#include <fstream>
+
 #include "../include/shell.hpp"
 
-int main() {
+int main(int argc, char* argv[]) {
+    std::string             script;
+    std::string             inline_commands;
+    std::string             format;
+    std::string             analyze_dir;
+    unsigned                jobs = 0;
+    po::options_description desc("Usage: plshell [options]\nOptions");
+    desc.add_options()("help,h", "Show this help message and exit")(
+        "script,s", po::value<std::string>(&script),
+        "Run the commands of a file, one per line, and exit")(
+        "command,c", po::value<std::string>(&inline_commands),
+        "Run commands separated by ';' and exit")(
+        "analyze,a", po::value<std::string>(&analyze_dir),
+        "Analyze every grammar of a directory in parallel and exit")(
+        "jobs,j", po::value<unsigned>(&jobs)->default_value(0),
+        "Threads of --analyze, 0 for one per hardware thread")(
+        "format,f", po::value<std::string>(&format)->default_value("text"),
+        "Output of --script and -c: text, or json for one JSON object per "
+        "command");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << "plshell: " << e.what() << "\n";
+        return 2;
+    }
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+    if (format != "text" && format != "json") {
+        std::cerr << "plshell: unknown format '" << format
+                  << "'. Options are: text, json.\n";
+        return 2;
+    }
+
     Shell shell;
-    shell.Run();
-    return 0;
-}
\ No newline at end of file
+    if (script.empty() && inline_commands.empty() && analyze_dir.empty()) {
+        shell.Run();
+        return 0;
+    }
+    std::vector<std::string> lines;
+    std::string              line;
+    if (!script.empty()) {
+        std::ifstream in(script);
+        if (!in.is_open()) {
+            std::cerr << "plshell: could not open '" << script << "'.\n";
+            return 2;
+        }
+        while (std::getline(in, line)) {
+            lines.push_back(line);
+        }
+    }
+    std::istringstream commands(inline_commands);
+    while (std::getline(commands, line, ';')) {
+        lines.push_back(line);
+    }
+    if (!analyze_dir.empty()) {
+        lines.push_back("analyze " + analyze_dir + " -j " +
+                        std::to_string(jobs));
+    }
+    return shell.RunBatch(lines, format == "json" ? Shell::Format::Json
+                                                  : Shell::Format::Text);
+}
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include "../../include/analysis.hpp"
+#include "../../include/grammar.hpp"
+#include "../../include/ll1_parser.hpp"
+#include "../../include/slr1_parser.hpp"
+#include "../../include/thread_pool.hpp"
+
+namespace analysis {
+
+namespace {
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+} // namespace
+
+GrammarReport AnalyzeGrammar(const std::string& path) {
+    GrammarReport report;
+    report.path = path;
+
+    auto    start = std::chrono::steady_clock::now();
+    Grammar gr;
+    try {
+        if (!gr.ReadFromFile(path)) {
+            report.error = "could not read the grammar";
+            return report;
+        }
+    } catch (const std::exception& e) {
+        report.error = e.what();
+        return report;
+    }
+    report.load_ms       = MillisecondsSince(start);
+    report.non_terminals = gr.st_.non_terminals_.size();
+    report.terminals     = gr.st_.terminals_.size();
+    for (const auto& [nt, productions] : gr.g_) {
+        report.rules += productions.size();
+    }
+
+    start = std::chrono::steady_clock::now();
+    LL1Parser ll1(gr);
+    report.ll1    = ll1.CreateLL1Table();
+    report.ll1_ms = MillisecondsSince(start);
+    for (const auto& [nt, row] : ll1.ll1_t_) {
+        for (const auto& [symbol, prods] : row) {
+            report.ll1_conflicts += prods.size() > 1;
+        }
+    }
+
+    start = std::chrono::steady_clock::now();
+    SLR1Parser slr1(gr);
+    report.slr1           = slr1.MakeParser();
+    report.slr1_ms        = MillisecondsSince(start);
+    report.states         = slr1.states_.size();
+    report.slr1_conflicts = slr1.ConflictCount();
+    return report;
+}
+
+std::vector<GrammarReport> AnalyzeDirectory(const std::string& dir,
+                                            unsigned           threads) {
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    // Every task writes only its own report
+    std::vector<GrammarReport> reports(paths.size());
+    ThreadPool                 pool(threads);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        pool.Submit([&reports, &paths, i] {
+            reports[i] = AnalyzeGrammar(paths[i]);
+        });
+    }
+    pool.Wait();
+    return reports;
+}
+
+} // namespace analysis
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "../../include/class_table.hpp"
+
+ClassTable::ClassTable(const std::vector<int>& dense, unsigned rows,
+                       unsigned cols)
+    : n_rows_(rows), n_cols_(cols), row_map_(rows), col_map_(cols) {
+    // Merge identical columns, keeping the first occurrence as representative
+    std::map<std::vector<int>, unsigned> col_classes;
+    std::vector<unsigned>                representatives;
+    std::vector<int>                     column(rows);
+    for (unsigned c = 0; c < cols; ++c) {
+        for (unsigned r = 0; r < rows; ++r) {
+            column[r] = dense[r * cols + c];
+        }
+        auto [it, inserted] = col_classes.insert({column, col_classes.size()});
+        if (inserted) {
+            representatives.push_back(c);
+        }
+        col_map_[c] = it->second;
+    }
+    n_col_classes_ = col_classes.size();
+
+    // Merge rows that are identical over the column classes
+    std::map<std::vector<int>, unsigned> row_classes;
+    std::vector<int>                     row(n_col_classes_);
+    for (unsigned r = 0; r < rows; ++r) {
+        for (unsigned k = 0; k < n_col_classes_; ++k) {
+            row[k] = dense[r * cols + representatives[k]];
+        }
+        auto [it, inserted] = row_classes.insert({row, row_classes.size()});
+        if (inserted) {
+            cells_.insert(cells_.end(), row.begin(), row.end());
+        }
+        row_map_[r] = it->second;
+    }
+    n_row_classes_ = row_classes.size();
+}
+
+void ClassTable::PatchRows(const std::vector<int>& dense, unsigned rows,
+                           const std::vector<unsigned>& changed) {
+    // The first column of a class stands for the others as long as the
+    // changed rows agree on all of them
+    std::vector<unsigned> representatives(n_col_classes_, n_cols_);
+    for (unsigned c = 0; c < n_cols_; ++c) {
+        unsigned& first = representatives[col_map_[c]];
+        if (first == n_cols_) {
+            first = c;
+            continue;
+        }
+        for (unsigned r : changed) {
+            if (dense[r * n_cols_ + c] != dense[r * n_cols_ + first]) {
+                *this = ClassTable(dense, rows, n_cols_);
+                return;
+            }
+        }
+    }
+
+    constexpr unsigned kNone = std::numeric_limits<unsigned>::max();
+    n_rows_                  = rows;
+    row_map_.resize(rows, kNone);
+    std::vector<unsigned> uses(n_row_classes_);
+    for (unsigned cls : row_map_) {
+        if (cls != kNone) {
+            ++uses[cls];
+        }
+    }
+    std::vector<int> row(n_col_classes_);
+    for (unsigned r : changed) {
+        for (unsigned k = 0; k < n_col_classes_; ++k) {
+            row[k] = dense[r * n_cols_ + representatives[k]];
+        }
+        unsigned& cls = row_map_[r];
+        if (cls != kNone) {
+            auto cells = cells_.begin() + cls * n_col_classes_;
+            if (std::equal(row.begin(), row.end(), cells)) {
+                continue;
+            }
+            if (--uses[cls] == 0) {
+                std::copy(row.begin(), row.end(), cells);
+                ++uses[cls];
+                continue;
+            }
+        }
+        cls = n_row_classes_++;
+        uses.push_back(1);
+        cells_.insert(cells_.end(), row.begin(), row.end());
+    }
+    const auto unused = std::count(uses.begin(), uses.end(), 0u);
+    if (2 * static_cast<unsigned>(unused) > n_row_classes_) {
+        *this = ClassTable(dense, rows, n_cols_);
+    }
+}
+
+size_t ClassTable::Bytes() const {
+    return row_map_.size() * sizeof(unsigned) +
+           col_map_.size() * sizeof(unsigned) + cells_.size() * sizeof(int);
+}
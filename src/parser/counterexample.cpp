@@ -0,0 +1,579 @@
+#include "../../include/counterexample.hpp"
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <utility>
+
+namespace counterexample {
+
+namespace {
+
+/// Forms taken from the queue by one unifying search before it gives up.
+constexpr size_t kMaxForms = 1 << 14;
+
+/// Symbols a form may grow by over the longest of the two initial forms.
+constexpr size_t kMaxGrowth = 12;
+
+/// Nodes a search visits between two looks at the clock.
+constexpr size_t kClockStride = 64;
+
+std::vector<std::string> Join(const Derivation& derivation) {
+    std::vector<std::string> form(derivation.before);
+    form.push_back(kDot);
+    form.insert(form.end(), derivation.after.begin(), derivation.after.end());
+    return form;
+}
+
+Derivation Split(const std::vector<std::string>& form) {
+    auto dot = std::find(form.begin(), form.end(), kDot);
+    return {{form.begin(), dot},
+            {dot == form.end() ? dot : dot + 1, form.end()}};
+}
+
+/// Key of a pair of forms in the set of visited pairs.
+std::string Key(const std::vector<std::string>& x,
+                const std::vector<std::string>& y) {
+    std::string key;
+    for (const std::string& symbol : x) {
+        key += symbol;
+        key += '\x1f';
+    }
+    key += '\x1e';
+    for (const std::string& symbol : y) {
+        key += symbol;
+        key += '\x1f';
+    }
+    return key;
+}
+
+/// Whether an item was added by the closure: dot at the start, or EPSILON.
+bool AtStart(const Lr0Item& item) {
+    return item.dot_ == 0 || (item.consequent_.size() == 1 &&
+                              item.consequent_[0] == item.epsilon_);
+}
+
+} // namespace
+
+std::string Derivation::ToString(const std::string& eol) const {
+    std::string out;
+    auto        add = [&](const std::string& symbol) {
+        if (symbol == eol) {
+            return;
+        }
+        if (!out.empty()) {
+            out += ' ';
+        }
+        out += symbol;
+    };
+    for (const std::string& symbol : before) {
+        add(symbol);
+    }
+    add(kDot);
+    for (const std::string& symbol : after) {
+        add(symbol);
+    }
+    return out;
+}
+
+Finder::Finder(const Grammar& gr, const SetMap& first_sets,
+               std::chrono::milliseconds budget)
+    : gr_(gr), first_(first_sets),
+      deadline_(std::chrono::steady_clock::now() + budget) {
+    // Length of the shortest string of every non-terminal, only updated on
+    // strict improvements so that following the shortest rules always ends,
+    // even if the budget stops it early
+    constexpr size_t kInf = std::numeric_limits<size_t>::max();
+    std::unordered_map<std::string, size_t>            length;
+    std::unordered_map<std::string, const production*> shortest;
+    auto size_of = [&](const production& body) {
+        size_t size = 0;
+        for (const std::string& symbol : body) {
+            if (symbol == gr_.st_.EPSILON_) {
+                continue;
+            }
+            if (!IsNonTerminal(symbol)) {
+                ++size;
+                continue;
+            }
+            auto it = length.find(symbol);
+            if (it == length.end()) {
+                return kInf;
+            }
+            size += it->second;
+        }
+        return size;
+    };
+    for (bool changed = true; changed && !Expired();) {
+        changed = false;
+        for (const auto& [nt, bodies] : gr_.g_) {
+            for (const production& body : bodies) {
+                const size_t size = size_of(body);
+                auto         it   = length.find(nt);
+                if (size != kInf && (it == length.end() || size < it->second)) {
+                    length[nt]   = size;
+                    shortest[nt] = &body;
+                    changed      = true;
+                }
+            }
+        }
+    }
+
+    std::function<const std::vector<std::string>&(const std::string&)> yield =
+        [&](const std::string& nt) -> const std::vector<std::string>& {
+        auto it = yield_.find(nt);
+        if (it != yield_.end()) {
+            return it->second;
+        }
+        std::vector<std::string> out;
+        for (const std::string& symbol : *shortest.at(nt)) {
+            if (IsNonTerminal(symbol)) {
+                const std::vector<std::string>& inner = yield(symbol);
+                out.insert(out.end(), inner.begin(), inner.end());
+            } else if (symbol != gr_.st_.EPSILON_) {
+                out.push_back(symbol);
+            }
+        }
+        return yield_[nt] = std::move(out);
+    };
+    for (const auto& [nt, rule] : shortest) {
+        if (Expired()) {
+            break;
+        }
+        yield(nt);
+    }
+
+    for (const auto& [nt, bodies] : gr_.g_) {
+        std::vector<const production*>& rules = rules_[nt];
+        for (const production& body : bodies) {
+            rules.push_back(&body);
+        }
+        std::stable_sort(rules.begin(), rules.end(),
+                         [&](const production* a, const production* b) {
+                             return size_of(*a) < size_of(*b);
+                         });
+    }
+}
+
+bool Finder::IsNonTerminal(const std::string& symbol) const {
+    return gr_.g_.find(symbol) != gr_.g_.end();
+}
+
+bool Finder::Expired() {
+    if (!expired_ && std::chrono::steady_clock::now() >= deadline_) {
+        expired_ = true;
+    }
+    return expired_;
+}
+
+bool Finder::Starts(const std::vector<std::string>& symbols, size_t from,
+                    const std::string& symbol, bool& nullable) const {
+    bool begins = false;
+    nullable    = true;
+    for (size_t i = from; i < symbols.size(); ++i) {
+        const std::string& s = symbols[i];
+        if (s == gr_.st_.EPSILON_) {
+            continue;
+        }
+        auto first = first_.find(s);
+        if (!IsNonTerminal(s) || first == first_.end()) {
+            nullable = false;
+            return begins || s == symbol;
+        }
+        begins = begins || first->second.contains(symbol);
+        if (!first->second.contains(gr_.st_.EPSILON_)) {
+            nullable = false;
+            return begins;
+        }
+    }
+    return begins;
+}
+
+void Finder::BuildGraph(const SLR1Parser& slr1) {
+    graph_of_ = &slr1;
+    states_.assign(slr1.states_.size(), nullptr);
+    for (const state& st : slr1.states_) {
+        states_[st.id_] = &st;
+    }
+    items_.clear();
+    node_.clear();
+    item_searches_.clear();
+    std::vector<unsigned> state_of;
+    for (const state* st : states_) {
+        for (const Lr0Item& item : st->items_) {
+            node_[&item] = items_.size();
+            items_.push_back(&item);
+            state_of.push_back(st->id_);
+        }
+    }
+
+    const std::string& epsilon = slr1.gr_.st_.EPSILON_;
+    const std::string& eol     = slr1.gr_.st_.EOL_;
+    edges_.assign(items_.size(), {});
+    for (unsigned n = 0; n < items_.size(); ++n) {
+        const Lr0Item& item = *items_[n];
+        if (item.IsComplete()) {
+            continue;
+        }
+        const std::string& next = item.consequent_[item.dot_];
+        const state&       st   = *states_[state_of[n]];
+        // Moving the dot over the next symbol
+        auto row = slr1.transitions_.find(st.id_);
+        if (row != slr1.transitions_.end()) {
+            auto to = row->second.find(next);
+            if (to != row->second.end()) {
+                const auto& items = states_[to->second]->items_;
+                auto        moved = items.find(Lr0Item(
+                    item.antecedent_, item.consequent_, item.dot_ + 1,
+                    epsilon, eol));
+                if (moved != items.end()) {
+                    edges_[n].push_back(node_.at(&*moved));
+                }
+            }
+        }
+        // Expanding the non-terminal after the dot, in the same state
+        auto rules = gr_.g_.find(next);
+        if (rules == gr_.g_.end()) {
+            continue;
+        }
+        for (const production& body : rules->second) {
+            auto expanded = st.items_.find(Lr0Item(next, body, epsilon, eol));
+            if (expanded != st.items_.end()) {
+                edges_[n].push_back(node_.at(&*expanded));
+            }
+        }
+    }
+    const auto& initial = states_[0]->items_;
+    root_               = node_.at(&*initial.find(Lr0Item(
+        gr_.axiom_, gr_.g_.at(gr_.axiom_)[0], 0, epsilon, eol)));
+}
+
+const std::vector<Finder::Visit>&
+Finder::SearchItems(const std::string& symbol) {
+    auto [it, inserted] = item_searches_.try_emplace(symbol);
+    std::vector<Visit>& visits = it->second;
+    if (!inserted) {
+        return visits;
+    }
+    // Nothing follows the axiom
+    visits.assign(2 * items_.size(), {});
+    visits[2 * root_].seen = true;
+    std::deque<unsigned> queue{2 * root_};
+    for (size_t taken = 0; !queue.empty(); ++taken) {
+        if (taken % kClockStride == 0 && Expired()) {
+            break;
+        }
+        const unsigned v = queue.front();
+        queue.pop_front();
+        const Lr0Item& item    = *items_[v / 2];
+        const bool     follows = v % 2;
+        for (unsigned n : edges_[v / 2]) {
+            bool flag = follows;
+            if (AtStart(*items_[n])) {
+                // What follows the expanded non-terminal in `item`
+                bool nullable;
+                flag = Starts(item.consequent_, item.dot_ + 1, symbol,
+                              nullable) ||
+                       (nullable && follows);
+            }
+            const unsigned w = 2 * n + flag;
+            if (!visits[w].seen) {
+                visits[w] = {static_cast<int>(v), -1, visits[v].depth + 1,
+                             true};
+                queue.push_back(w);
+            }
+        }
+    }
+    return visits;
+}
+
+Derivation Finder::ItemForm(const std::vector<Visit>& visits,
+                            unsigned                  node) const {
+    std::vector<unsigned> path;
+    for (int v = node; v >= 0; v = visits[v].parent) {
+        path.push_back(v / 2);
+    }
+    std::reverse(path.begin(), path.end());
+
+    // Moving the dot adds a symbol to the prefix, and expanding a
+    // non-terminal leaves what follows it for after the conflict point
+    Derivation                            form;
+    std::vector<std::vector<std::string>> pending;
+    for (size_t k = 1; k < path.size(); ++k) {
+        const Lr0Item& from = *items_[path[k - 1]];
+        if (AtStart(*items_[path[k]])) {
+            pending.emplace_back(from.consequent_.begin() + from.dot_ + 1,
+                                 from.consequent_.end());
+        } else {
+            form.before.push_back(from.consequent_[from.dot_]);
+        }
+    }
+    const Lr0Item& item = *items_[path.back()];
+    pending.emplace_back(item.consequent_.begin() +
+                             std::min<size_t>(item.dot_,
+                                              item.consequent_.size()),
+                         item.consequent_.end());
+    for (auto rest = pending.rbegin(); rest != pending.rend(); ++rest) {
+        for (const std::string& symbol : *rest) {
+            if (symbol != gr_.st_.EPSILON_) {
+                form.after.push_back(symbol);
+            }
+        }
+    }
+    return form;
+}
+
+Example Finder::Find(const SLR1Parser&             slr1,
+                     const SLR1Parser::Conflict& conflict) {
+    if (graph_of_ != &slr1) {
+        BuildGraph(slr1);
+    }
+    // A shift (or accept) and a reduction, or two reductions
+    const Lr0Item* first  = nullptr;
+    const Lr0Item* second = nullptr;
+    auto reduces = [&](const Lr0Item& item) {
+        return item.IsComplete() && item.antecedent_ != gr_.axiom_;
+    };
+    for (const Lr0Item& item : conflict.items) {
+        const bool shift =
+            conflict.kind == SLR1Parser::Conflict::Kind::ShiftReduce &&
+            !reduces(item);
+        if (!first && (shift || conflict.kind ==
+                                    SLR1Parser::Conflict::Kind::ReduceReduce)) {
+            first = &item;
+        } else if (!second && reduces(item)) {
+            second = &item;
+        }
+    }
+
+    Example example;
+    if (!first || !second) {
+        return example;
+    }
+    const std::vector<Visit>& visits = SearchItems(conflict.symbol);
+    auto form = [&](const Lr0Item& item) {
+        const auto& items = states_[conflict.state]->items_;
+        const unsigned n  = node_.at(&*items.find(item));
+        unsigned       v  = 2 * n + 1;
+        if (!reduces(item)) {
+            // The conflict symbol is after the dot
+            if (!visits[v].seen ||
+                (visits[2 * n].seen && visits[2 * n].depth < visits[v].depth)) {
+                v = 2 * n;
+            }
+        } else if (!visits[v].seen) {
+            // Unless the search stopped before it got there
+            example.follow_only = !expired_;
+            v                   = 2 * n;
+        }
+        return ItemForm(visits, v);
+    };
+    example.first_label  = first->ToString();
+    example.second_label = second->ToString();
+    example.first        = form(*first);
+    example.second       = form(*second);
+    Unify(example);
+    Sentence(example);
+    return example;
+}
+
+const std::vector<Finder::Visit>&
+Finder::SearchContexts(const std::string& symbol) {
+    if (names_.empty()) {
+        for (const auto& [nt, bodies] : gr_.g_) {
+            names_.push_back(nt);
+        }
+        std::sort(names_.begin(), names_.end());
+        for (unsigned i = 0; i < names_.size(); ++i) {
+            index_[names_[i]] = i;
+        }
+        uses_by_lhs_.assign(names_.size(), {});
+        for (unsigned lhs = 0; lhs < names_.size(); ++lhs) {
+            for (const production& body : gr_.g_.at(names_[lhs])) {
+                for (unsigned pos = 0; pos < body.size(); ++pos) {
+                    if (IsNonTerminal(body[pos])) {
+                        uses_by_lhs_[lhs].push_back(uses_.size());
+                        uses_.push_back({&body, pos});
+                    }
+                }
+            }
+        }
+    }
+
+    auto [it, inserted] = context_searches_.try_emplace(symbol);
+    std::vector<Visit>& visits = it->second;
+    if (!inserted) {
+        return visits;
+    }
+    const unsigned root = 2 * index_.at(gr_.axiom_);
+    visits.assign(2 * names_.size(), {});
+    visits[root].seen = true;
+    std::deque<unsigned> queue{root};
+    for (size_t taken = 0; !queue.empty(); ++taken) {
+        if (taken % kClockStride == 0 && Expired()) {
+            break;
+        }
+        const unsigned v = queue.front();
+        queue.pop_front();
+        for (unsigned u : uses_by_lhs_[v / 2]) {
+            const auto& [body, pos] = uses_[u];
+            bool        nullable;
+            const bool  flag =
+                Starts(*body, pos + 1, symbol, nullable) ||
+                (nullable && v % 2);
+            const unsigned w = 2 * index_.at((*body)[pos]) + flag;
+            if (!visits[w].seen) {
+                visits[w] = {static_cast<int>(v), static_cast<int>(u),
+                             visits[v].depth + 1, true};
+                queue.push_back(w);
+            }
+        }
+    }
+    return visits;
+}
+
+Example Finder::Find(const std::string& non_terminal,
+                     const std::string& symbol, const production& first,
+                     const production& second) {
+    Example                   example;
+    const std::vector<Visit>& visits = SearchContexts(symbol);
+    // A rule that cannot begin with the symbol is chosen on FOLLOW, so the
+    // symbol must follow the non-terminal in its context
+    bool       nullable;
+    const bool follow = !Starts(first, 0, symbol, nullable) ||
+                        !Starts(second, 0, symbol, nullable);
+    const unsigned n  = index_.at(non_terminal);
+    unsigned       v  = 2 * n + 1;
+    if (!follow) {
+        if (!visits[v].seen ||
+            (visits[2 * n].seen && visits[2 * n].depth < visits[v].depth)) {
+            v = 2 * n;
+        }
+    } else if (!visits[v].seen) {
+        example.follow_only = !expired_;
+        v                   = 2 * n;
+    }
+
+    // Shortest sentential form with the non-terminal at `pos`
+    std::vector<unsigned> path;
+    for (int w = v; visits[w].parent >= 0; w = visits[w].parent) {
+        path.push_back(visits[w].edge);
+    }
+    std::vector<std::string> context{gr_.axiom_};
+    size_t                   pos = 0;
+    for (auto u = path.rbegin(); u != path.rend(); ++u) {
+        const auto& [body, at] = uses_[*u];
+        context.erase(context.begin() + pos);
+        context.insert(context.begin() + pos, body->begin(), body->end());
+        pos += at;
+    }
+
+    auto form = [&](const production& rule) {
+        Derivation derivation{{context.begin(), context.begin() + pos}, {}};
+        for (const std::string& s : rule) {
+            if (s != gr_.st_.EPSILON_) {
+                derivation.after.push_back(s);
+            }
+        }
+        derivation.after.insert(derivation.after.end(),
+                                context.begin() + pos + 1, context.end());
+        return derivation;
+    };
+    auto label = [&](const production& rule) {
+        std::string text = non_terminal + " ->";
+        for (const std::string& s : rule) {
+            text += " " + s;
+        }
+        return text;
+    };
+    example.first_label  = label(first);
+    example.second_label = label(second);
+    example.first        = form(first);
+    example.second       = form(second);
+    Unify(example);
+    Sentence(example);
+    return example;
+}
+
+void Finder::Unify(Example& example) {
+    if (example.first == example.second) {
+        example.unifying = true;
+        return;
+    }
+    if (Expired()) {
+        example.bounded = true;
+        return;
+    }
+    using Forms = std::pair<std::vector<std::string>, std::vector<std::string>>;
+    std::deque<Forms> queue{{Join(example.first), Join(example.second)}};
+    const size_t      limit =
+        std::max(queue.front().first.size(), queue.front().second.size()) +
+        kMaxGrowth;
+    std::unordered_set<std::string> seen{
+        Key(queue.front().first, queue.front().second)};
+    size_t taken = 0;
+    while (!queue.empty()) {
+        if (++taken > kMaxForms || (taken % kClockStride == 0 && Expired())) {
+            example.bounded = true;
+            return;
+        }
+        const auto [x, y] = std::move(queue.front());
+        queue.pop_front();
+        size_t i = 0;
+        while (i < x.size() && i < y.size() && x[i] == y[i]) {
+            ++i;
+        }
+        if (i == x.size() && i == y.size()) {
+            example.unifying = true;
+            example.first = example.second = Split(x);
+            return;
+        }
+        // The symbols after the first difference wait until it is solved,
+        // but a non-terminal before it may still derive what fixes it
+        for (const std::vector<std::string>* form : {&x, &y}) {
+            for (size_t j = 0; j <= i && j < form->size(); ++j) {
+                if (!IsNonTerminal((*form)[j])) {
+                    continue;
+                }
+                for (const production* body : rules_.at((*form)[j])) {
+                    std::vector<std::string> next(form->begin(),
+                                                  form->begin() + j);
+                    for (const std::string& s : *body) {
+                        if (s != gr_.st_.EPSILON_) {
+                            next.push_back(s);
+                        }
+                    }
+                    next.insert(next.end(), form->begin() + j + 1,
+                                form->end());
+                    if (next.size() > limit) {
+                        example.bounded = true;
+                        continue;
+                    }
+                    Forms forms = form == &x ? Forms{std::move(next), y}
+                                             : Forms{x, std::move(next)};
+                    if (seen.insert(Key(forms.first, forms.second)).second) {
+                        queue.push_back(std::move(forms));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Finder::Sentence(Example& example) const {
+    example.sentence.clear();
+    for (const std::string& symbol : Join(example.first)) {
+        auto yield = yield_.find(symbol);
+        if (yield != yield_.end()) {
+            for (const std::string& terminal : yield->second) {
+                if (terminal != gr_.st_.EOL_) {
+                    example.sentence.push_back(terminal);
+                }
+            }
+        } else if (symbol != gr_.st_.EOL_) {
+            example.sentence.push_back(symbol);
+        }
+    }
+}
+
+} // namespace counterexample
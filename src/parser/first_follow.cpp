@@ -0,0 +1,727 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../../include/first_follow.hpp"
+#include "../../include/graph.hpp"
+#include "../../include/stats.hpp"
+#include "../../include/symbol_index.hpp"
+#include "../../include/thread_pool.hpp"
+
+namespace first_follow {
+
+namespace {
+
+using Bits = std::vector<std::uint64_t>;
+/// @brief For every node, the nodes whose set is included in its own.
+using Graph = std::vector<std::vector<unsigned>>;
+
+constexpr unsigned kNone = std::numeric_limits<unsigned>::max();
+
+void SetBit(Bits& bits, unsigned i) {
+    bits[i / 64] |= std::uint64_t{1} << (i % 64);
+}
+
+bool TestBit(const Bits& bits, unsigned i) {
+    return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+void Or(Bits& to, const Bits& from) {
+    for (size_t i = 0; i < to.size(); ++i) {
+        to[i] |= from[i];
+    }
+}
+
+/**
+ * Nullable non-terminals, counting the end of input as empty: reaching EOL
+ * while computing FIRST adds EPSILON, as in `LL1Parser::First`. Every rule
+ * keeps the number of non-nullable symbols before its first EOL, so each
+ * occurrence is visited once.
+ */
+std::vector<bool> Nullable(const SymbolIndex& index) {
+    const int                          n_terminals = index.terminals_.size();
+    const size_t                       n = index.non_terminals_.size();
+    std::vector<bool>                  nullable(n);
+    std::vector<unsigned>              pending(index.rules_.size());
+    std::vector<std::vector<unsigned>> occurrences(n);
+    std::queue<unsigned>               found;
+
+    auto mark = [&](unsigned nt) {
+        if (!nullable[nt]) {
+            nullable[nt] = true;
+            found.push(nt);
+        }
+    };
+    for (unsigned r = 0; r < index.rules_.size(); ++r) {
+        bool blocked = false;
+        for (int s : index.rules_[r].rhs_) {
+            if (s == 0) {
+                break;
+            }
+            if (s < n_terminals) {
+                blocked = true;
+                break;
+            }
+            ++pending[r];
+            occurrences[s - n_terminals].push_back(r);
+        }
+        if (blocked) {
+            pending[r] = kNone;
+        } else if (pending[r] == 0) {
+            mark(index.rules_[r].lhs_);
+        }
+    }
+    while (!found.empty()) {
+        const unsigned nt = found.front();
+        found.pop();
+        for (unsigned r : occurrences[nt]) {
+            if (pending[r] != kNone && --pending[r] == 0) {
+                mark(index.rules_[r].lhs_);
+            }
+        }
+    }
+    return nullable;
+}
+
+struct Solution {
+    std::vector<unsigned> comp;
+    std::vector<Bits>     sets;
+
+    const Bits& Of(unsigned node) const { return sets[comp[node]]; }
+};
+
+/**
+ * Least solution of set(v) = own(v) ∪ set(u) for every dependency u of v.
+ * Every component gets a single set, computed once all the components it
+ * depends on are; components are solved in waves of equal depth in the
+ * condensation DAG, in parallel.
+ */
+Solution Solve(const Graph& deps, const std::vector<Bits>& own, size_t words,
+               ThreadPool& pool) {
+    Solution solution;
+    unsigned n_comps = 0;
+    solution.comp    = graph::Components(deps, n_comps);
+
+    std::vector<std::vector<unsigned>> members(n_comps);
+    for (unsigned v = 0; v < deps.size(); ++v) {
+        members[solution.comp[v]].push_back(v);
+    }
+    std::vector<unsigned>              level(n_comps, 0);
+    std::vector<std::vector<unsigned>> waves;
+    for (unsigned c = 0; c < n_comps; ++c) {
+        for (unsigned v : members[c]) {
+            for (unsigned u : deps[v]) {
+                const unsigned d = solution.comp[u];
+                if (d != c) {
+                    level[c] = std::max(level[c], level[d] + 1);
+                }
+            }
+        }
+        if (level[c] >= waves.size()) {
+            waves.resize(level[c] + 1);
+        }
+        waves[level[c]].push_back(c);
+    }
+
+    solution.sets.assign(n_comps, Bits(words));
+    for (const std::vector<unsigned>& wave : waves) {
+        const size_t chunk =
+            std::max<size_t>(1, wave.size() / (4 * pool.Size()));
+        for (size_t begin = 0; begin < wave.size(); begin += chunk) {
+            const size_t end = std::min(wave.size(), begin + chunk);
+            pool.Submit([&, begin, end] {
+                for (size_t k = begin; k < end; ++k) {
+                    const unsigned c   = wave[k];
+                    Bits&          set = solution.sets[c];
+                    for (unsigned v : members[c]) {
+                        Or(set, own[v]);
+                        for (unsigned u : deps[v]) {
+                            if (solution.comp[u] != c) {
+                                Or(set, solution.Of(u));
+                            }
+                        }
+                    }
+                }
+            });
+        }
+        pool.Wait();
+    }
+    return solution;
+}
+
+/// @brief FIRST of a sequence of symbols, as `LL1Parser::First`.
+void FirstOf(const Grammar& gr, const SetMap& first,
+             std::span<const std::string>     symbols,
+             std::unordered_set<std::string>& out) {
+    for (const std::string& symbol : symbols) {
+        if (symbol == gr.st_.EPSILON_) {
+            continue;
+        }
+        if (symbol == gr.st_.EOL_) {
+            break;
+        }
+        if (gr.st_.terminals_.contains(symbol)) {
+            out.insert(symbol);
+            return;
+        }
+        auto sets = first.find(symbol);
+        if (sets == first.end()) {
+            return;
+        }
+        bool nullable = false;
+        for (const std::string& s : sets->second) {
+            if (s == gr.st_.EPSILON_) {
+                nullable = true;
+            } else {
+                out.insert(s);
+            }
+        }
+        if (!nullable) {
+            return;
+        }
+    }
+    out.insert(gr.st_.EPSILON_);
+}
+
+} // namespace
+
+Sets Compute(const Grammar& gr, unsigned threads) {
+    const SymbolIndex index(gr);
+    const unsigned    n_terminals = index.terminals_.size();
+    const size_t      n           = index.non_terminals_.size();
+    const size_t      words       = (n_terminals + 63) / 64;
+    ThreadPool        pool(threads);
+
+    std::vector<bool> nullable;
+    Solution          first;
+    {
+        stats::ScopedTimer timer(stats::Phase::First);
+        nullable = Nullable(index);
+        Graph             deps(n);
+        std::vector<Bits> own(n, Bits(words));
+        for (const SymbolIndex::Rule& rule : index.rules_) {
+            for (int s : rule.rhs_) {
+                if (s < static_cast<int>(n_terminals)) {
+                    if (s != 0) {
+                        SetBit(own[rule.lhs_], s);
+                    }
+                    break;
+                }
+                deps[rule.lhs_].push_back(s - n_terminals);
+                if (!nullable[s - n_terminals]) {
+                    break;
+                }
+            }
+        }
+        first = Solve(deps, own, words, pool);
+    }
+
+    Solution follow;
+    {
+        stats::ScopedTimer timer(stats::Phase::Follow);
+        Graph             deps(n);
+        std::vector<Bits> own(n, Bits(words));
+        SetBit(own[0], 0); // EOL follows the axiom
+        // Walk every rule backwards, keeping FIRST of the suffix after the
+        // current symbol and whether it is nullable
+        Bits trail(words);
+        for (const SymbolIndex::Rule& rule : index.rules_) {
+            std::fill(trail.begin(), trail.end(), 0);
+            bool nullable_suffix = true;
+            for (auto it = rule.rhs_.rbegin(); it != rule.rhs_.rend(); ++it) {
+                const int s = *it;
+                if (s == 0) {
+                    // FIRST of anything starting with EOL is EPSILON
+                    std::fill(trail.begin(), trail.end(), 0);
+                    nullable_suffix = true;
+                } else if (s < static_cast<int>(n_terminals)) {
+                    std::fill(trail.begin(), trail.end(), 0);
+                    SetBit(trail, s);
+                    nullable_suffix = false;
+                } else {
+                    const unsigned b = s - n_terminals;
+                    Or(own[b], trail);
+                    if (nullable_suffix) {
+                        deps[b].push_back(rule.lhs_);
+                    }
+                    if (!nullable[b]) {
+                        std::fill(trail.begin(), trail.end(), 0);
+                        nullable_suffix = false;
+                    }
+                    Or(trail, first.Of(b));
+                }
+            }
+        }
+        follow = Solve(deps, own, words, pool);
+    }
+
+    // Convert the bitsets of every non-terminal with productions; the keys
+    // are inserted first so that the sets can be filled in parallel
+    using Output = std::pair<unsigned, std::unordered_set<std::string>*>;
+    Sets                sets;
+    std::vector<Output> first_out;
+    std::vector<Output> follow_out;
+    for (const auto& [nt, productions] : gr.g_) {
+        const unsigned id = index.NonTerminalId(nt);
+        first_out.push_back({id, &sets.first[nt]});
+        follow_out.push_back({id, &sets.follow[nt]});
+    }
+    auto names = [&](const Bits& bits, std::unordered_set<std::string>& out) {
+        for (unsigned t = 0; t < n_terminals; ++t) {
+            if (TestBit(bits, t)) {
+                out.insert(index.terminals_[t]);
+            }
+        }
+    };
+    const size_t chunk =
+        std::max<size_t>(1, first_out.size() / (4 * pool.Size()));
+    for (size_t begin = 0; begin < first_out.size(); begin += chunk) {
+        const size_t end = std::min(first_out.size(), begin + chunk);
+        pool.Submit([&, begin, end] {
+            for (size_t k = begin; k < end; ++k) {
+                const unsigned id = first_out[k].first;
+                names(first.Of(id), *first_out[k].second);
+                if (nullable[id]) {
+                    first_out[k].second->insert(gr.st_.EPSILON_);
+                }
+                names(follow.Of(id), *follow_out[k].second);
+            }
+        });
+    }
+    pool.Wait();
+    return sets;
+}
+
+Changes Update(const Grammar& gr, const std::string& antecedent,
+               const production& consequent, SetMap& first, SetMap& follow) {
+    const std::string& epsilon = gr.st_.EPSILON_;
+    auto               rules   = gr.g_.find(antecedent);
+    const bool         added =
+        rules != gr.g_.end() && std::find(rules->second.begin(),
+                                          rules->second.end(),
+                                          consequent) != rules->second.end();
+    if (rules == gr.g_.end()) {
+        // Its last rule was removed, and nothing uses it
+        first.erase(antecedent);
+        follow.erase(antecedent);
+    } else {
+        first.try_emplace(antecedent);
+        follow.try_emplace(antecedent);
+    }
+
+    // Antecedents of the rules where every non-terminal appears, built only
+    // if some set has to be propagated to them
+    std::unordered_map<std::string, std::unordered_set<std::string>> users;
+    bool                                                             indexed =
+        false;
+    auto users_of =
+        [&](const std::string& nt) -> const std::unordered_set<std::string>& {
+        static const std::unordered_set<std::string> kNone;
+        if (!indexed) {
+            for (const auto& [lhs, productions] : gr.g_) {
+                for (const production& prod : productions) {
+                    for (const std::string& symbol : prod) {
+                        if (gr.g_.contains(symbol)) {
+                            users[symbol].insert(lhs);
+                        }
+                    }
+                }
+            }
+            indexed = true;
+        }
+        auto it = users.find(nt);
+        return it == users.end() ? kNone : it->second;
+    };
+    auto nullable = [&](const std::string& nt) {
+        return first.at(nt).contains(epsilon);
+    };
+    // Adds a terminal to a FOLLOW set. Sets only grow when a rule is added,
+    // so then the terminals added are the ones that changed
+    Changes changes;
+    auto    insert_follow = [&](std::unordered_set<std::string>& set,
+                             const std::string&               s) {
+        if (!set.insert(s).second) {
+            return false;
+        }
+        if (added) {
+            changes.follow_terminals.insert(s);
+        }
+        return true;
+    };
+    // Adds FIRST of every rule of `nt` to its set, and tells if it grew
+    auto grow_first = [&](const std::string& nt) {
+        std::unordered_set<std::string>& set   = first[nt];
+        bool                             grown = false;
+        for (const production& prod : gr.g_.at(nt)) {
+            std::unordered_set<std::string> symbols;
+            FirstOf(gr, first, prod, symbols);
+            for (const std::string& s : symbols) {
+                grown |= set.insert(s).second;
+            }
+        }
+        return grown;
+    };
+    // Adds what a rule of `lhs` puts in the FOLLOW of its symbols (only of
+    // those in `only`, if given), calling `grown` with every set that grew
+    auto contribute = [&](const std::string& lhs, const production& prod,
+                          const std::unordered_set<std::string>* only,
+                          auto&&                                 grown) {
+        for (size_t i = 0; i < prod.size(); ++i) {
+            if (!gr.g_.contains(prod[i]) ||
+                (only && !only->contains(prod[i]))) {
+                continue;
+            }
+            std::unordered_set<std::string> symbols;
+            FirstOf(gr, first,
+                    std::span<const std::string>(prod).subspan(i + 1),
+                    symbols);
+            std::unordered_set<std::string>& set    = follow[prod[i]];
+            bool                             growth = false;
+            for (const std::string& s : symbols) {
+                if (s != epsilon) {
+                    growth |= insert_follow(set, s);
+                }
+            }
+            if (symbols.contains(epsilon) && prod[i] != lhs) {
+                for (const std::string& s : follow[lhs]) {
+                    growth |= insert_follow(set, s);
+                }
+            }
+            if (growth) {
+                grown(prod[i]);
+            }
+        }
+    };
+    // FOLLOW of a non-terminal flows into the ones that end its rules (only
+    // into those in `only`, if given): propagates it from the non-terminals
+    // in `pending` until nothing grows, calling `grown` with every set that
+    // grew, which has to queue it again
+    auto propagate = [&](std::vector<std::string>&              pending,
+                         const std::unordered_set<std::string>* only,
+                         auto&&                                 grown) {
+        while (!pending.empty()) {
+            const std::string nt = std::move(pending.back());
+            pending.pop_back();
+            for (const production& prod : gr.g_.at(nt)) {
+                for (auto it = prod.rbegin(); it != prod.rend(); ++it) {
+                    if (*it == epsilon || *it == gr.st_.EOL_) {
+                        continue;
+                    }
+                    if (!gr.g_.contains(*it)) {
+                        break;
+                    }
+                    if (*it != nt && (!only || only->contains(*it))) {
+                        std::unordered_set<std::string>& set    = follow[*it];
+                        bool                             growth = false;
+                        for (const std::string& s : follow[nt]) {
+                            growth |= insert_follow(set, s);
+                        }
+                        if (growth) {
+                            grown(*it);
+                        }
+                    }
+                    if (!nullable(*it)) {
+                        break;
+                    }
+                }
+            }
+        }
+    };
+
+    if (added) {
+        // The sets only grow: propagate what is new until nothing changes
+        std::vector<std::string> pending{antecedent};
+        while (!pending.empty()) {
+            const std::string nt = std::move(pending.back());
+            pending.pop_back();
+            if (grow_first(nt)) {
+                changes.first.insert(nt);
+                const auto& nt_users = users_of(nt);
+                pending.insert(pending.end(), nt_users.begin(),
+                               nt_users.end());
+            }
+        }
+        auto grown = [&](const std::string& nt) {
+            changes.follow.insert(nt);
+            pending.push_back(nt);
+        };
+        contribute(antecedent, consequent, nullptr, grown);
+        for (const std::string& nt : changes.first) {
+            for (const std::string& user : users_of(nt)) {
+                for (const production& prod : gr.g_.at(user)) {
+                    if (std::find(prod.begin(), prod.end(), nt) != prod.end()) {
+                        contribute(user, prod, nullptr, grown);
+                    }
+                }
+            }
+        }
+        propagate(pending, nullptr, grown);
+        return changes;
+    }
+
+    // A removal can shrink FIRST of the antecedent and of the non-terminals
+    // that can begin with it, using the nullable symbols before the edit
+    std::vector<std::string>        stale_first;
+    std::unordered_set<std::string> seen;
+    if (rules != gr.g_.end()) {
+        stale_first.push_back(antecedent);
+        seen.insert(antecedent);
+    }
+    for (size_t i = 0; i < stale_first.size(); ++i) {
+        const std::string nt = stale_first[i];
+        for (const std::string& user : users_of(nt)) {
+            if (seen.contains(user)) {
+                continue;
+            }
+            for (const production& prod : gr.g_.at(user)) {
+                auto begins = std::find_if(
+                    prod.begin(), prod.end(), [&](const std::string& s) {
+                        return s == nt || gr.st_.terminals_.contains(s) ||
+                               !nullable(s);
+                    });
+                if (begins != prod.end() && *begins == nt) {
+                    seen.insert(user);
+                    stale_first.push_back(user);
+                    break;
+                }
+            }
+        }
+    }
+    SetMap old;
+    for (const std::string& nt : stale_first) {
+        old[nt] = std::move(first[nt]);
+        first[nt].clear();
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const std::string& nt : stale_first) {
+            changed |= grow_first(nt);
+        }
+    }
+    for (const std::string& nt : stale_first) {
+        if (first[nt] != old[nt]) {
+            changes.first.insert(nt);
+        }
+    }
+
+    // FOLLOW of the non-terminals of the removed rule and of the rules where
+    // a FIRST changed, and of the non-terminals that inherit their FOLLOW
+    std::unordered_set<std::string> stale_follow;
+    std::vector<std::string>        pending;
+
+    auto mark = [&](const std::string& nt) {
+        if (gr.g_.contains(nt) && stale_follow.insert(nt).second) {
+            pending.push_back(nt);
+        }
+    };
+    for (const std::string& symbol : consequent) {
+        mark(symbol);
+    }
+    for (const std::string& nt : changes.first) {
+        for (const std::string& user : users_of(nt)) {
+            for (const production& prod : gr.g_.at(user)) {
+                if (std::find(prod.begin(), prod.end(), nt) != prod.end()) {
+                    std::for_each(prod.begin(), prod.end(), mark);
+                }
+            }
+        }
+    }
+    while (!pending.empty()) {
+        const std::string nt = std::move(pending.back());
+        pending.pop_back();
+        for (const production& prod : gr.g_.at(nt)) {
+            for (auto it = prod.rbegin(); it != prod.rend(); ++it) {
+                if (*it == epsilon || *it == gr.st_.EOL_) {
+                    continue;
+                }
+                if (!gr.g_.contains(*it)) {
+                    break;
+                }
+                mark(*it);
+                if (!nullable(*it)) {
+                    break;
+                }
+            }
+        }
+    }
+
+    old.clear();
+    std::unordered_set<std::string> sources;
+    for (const std::string& nt : stale_follow) {
+        old[nt] = std::move(follow[nt]);
+        follow[nt].clear();
+        const auto& nt_users = users_of(nt);
+        sources.insert(nt_users.begin(), nt_users.end());
+    }
+    if (stale_follow.contains(gr.axiom_)) {
+        follow[gr.axiom_].insert(gr.st_.EOL_);
+    }
+    // What the rules give from FIRST does not depend on the stale sets:
+    // add it once, then let FOLLOW flow between the stale ones
+    for (const std::string& lhs : sources) {
+        for (const production& prod : gr.g_.at(lhs)) {
+            contribute(lhs, prod, &stale_follow, [](const std::string&) {});
+        }
+    }
+    pending.assign(stale_follow.begin(), stale_follow.end());
+    propagate(pending, &stale_follow,
+              [&](const std::string& nt) { pending.push_back(nt); });
+    // The sets only shrink
+    for (const std::string& nt : stale_follow) {
+        if (follow[nt] == old[nt]) {
+            continue;
+        }
+        changes.follow.insert(nt);
+        for (const std::string& s : old[nt]) {
+            if (!follow[nt].contains(s)) {
+                changes.follow_terminals.insert(s);
+            }
+        }
+    }
+    return changes;
+}
+
+void SolveFirst(const Grammar& gr, const std::vector<std::string>& targets,
+                SetMap& first) {
+    stats::ScopedTimer timer(stats::Phase::First);
+    const std::string& eps = gr.st_.EPSILON_;
+    const std::string& eol = gr.st_.EOL_;
+    for (const std::string& nt : targets) {
+        first[nt].clear();
+    }
+    // As in ComputeFirstSets, EOL ends a rule like EPSILON does
+    bool changed = true;
+    while (changed) {
+        stats::AddIterations(stats::Phase::First);
+        changed = false;
+        for (const std::string& nt : targets) {
+            std::unordered_set<std::string>& set = first[nt];
+            for (const production& prod : gr.g_.at(nt)) {
+                bool nullable = true;
+                for (const std::string& symbol : prod) {
+                    if (symbol == eps || symbol == eol) {
+                        break;
+                    }
+                    if (!gr.g_.contains(symbol)) {
+                        changed |= set.insert(symbol).second;
+                        nullable = false;
+                        break;
+                    }
+                    auto used = first.find(symbol);
+                    if (used == first.end()) {
+                        nullable = false;
+                        break;
+                    }
+                    for (const std::string& t : used->second) {
+                        if (t != eps) {
+                            changed |= set.insert(t).second;
+                        }
+                    }
+                    if (!used->second.contains(eps)) {
+                        nullable = false;
+                        break;
+                    }
+                }
+                if (nullable) {
+                    changed |= set.insert(eps).second;
+                }
+            }
+        }
+    }
+}
+
+SetMap ModuleCache::First(const Grammar& gr) {
+    analyzed_.clear();
+    SetMap first;
+    if (gr.modules_.empty()) {
+        std::vector<std::string> all;
+        for (const auto& [nt, productions] : gr.g_) {
+            all.push_back(nt);
+        }
+        SolveFirst(gr, all, first);
+        analyzed_.emplace_back();
+        return first;
+    }
+
+    const size_t                            n = gr.modules_.size();
+    std::unordered_map<std::string, size_t> by_name;
+    for (size_t m = 0; m < n; ++m) {
+        by_name[gr.modules_[m].name] = m;
+    }
+    graph::Adjacency imports(n);
+    for (size_t m = 0; m < n; ++m) {
+        for (const std::string& name : gr.modules_[m].imports) {
+            imports[m].push_back(by_name.at(name));
+        }
+    }
+    unsigned                    count = 0;
+    const std::vector<unsigned> comp  = graph::Components(imports, count);
+    std::vector<std::vector<unsigned>> members(count);
+    for (unsigned m = 0; m < n; ++m) {
+        members[comp[m]].push_back(m);
+    }
+    std::vector<std::vector<std::string>> non_terminals(n);
+    for (const auto& [nt, productions] : gr.g_) {
+        non_terminals[gr.ModuleOf(nt)].push_back(nt);
+    }
+    auto combine = [](size_t h, size_t value) {
+        return h ^ (value + 0x9e3779b9 + (h << 6) + (h >> 2));
+    };
+    std::vector<std::string> terminals(gr.st_.terminals_.begin(),
+                                       gr.st_.terminals_.end());
+    std::sort(terminals.begin(), terminals.end());
+    size_t terminals_key = 0;
+    for (const std::string& t : terminals) {
+        terminals_key = combine(terminals_key, std::hash<std::string>{}(t));
+    }
+
+    // Imported units have smaller numbers, so their keys are known first
+    std::vector<size_t> keys(count);
+    for (unsigned c = 0; c < count; ++c) {
+        size_t key = terminals_key;
+        for (unsigned m : members[c]) {
+            key = combine(key, gr.modules_[m].fingerprint);
+            for (unsigned imported : imports[m]) {
+                if (comp[imported] != c) {
+                    key = combine(key, keys[comp[imported]]);
+                }
+            }
+        }
+        keys[c] = key;
+
+        const bool cached =
+            std::all_of(members[c].begin(), members[c].end(), [&](unsigned m) {
+                auto it = entries_.find(gr.modules_[m].path);
+                return it != entries_.end() && it->second.key == key;
+            });
+        if (cached) {
+            for (unsigned m : members[c]) {
+                const SetMap& sets = entries_.at(gr.modules_[m].path).first;
+                first.insert(sets.begin(), sets.end());
+            }
+            continue;
+        }
+        std::vector<std::string> targets;
+        for (unsigned m : members[c]) {
+            targets.insert(targets.end(), non_terminals[m].begin(),
+                           non_terminals[m].end());
+            analyzed_.push_back(gr.modules_[m].name);
+        }
+        SolveFirst(gr, targets, first);
+        for (unsigned m : members[c]) {
+            Entry& entry = entries_[gr.modules_[m].path];
+            entry.key    = key;
+            entry.first.clear();
+            for (const std::string& nt : non_terminals[m]) {
+                entry.first[nt] = first.at(nt);
+            }
+        }
+    }
+    return first;
+}
+
+} // namespace first_follow
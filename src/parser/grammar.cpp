@@ -1,93 +1,708 @@
 #include "../../include/grammar.hpp"
+#include "../../include/stats.hpp"
 #include "../../include/symbol_table.hpp"
 #include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <regex>
+#include <sstream>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
-bool Grammar::ReadFromFile(const std::string& filename) {
+namespace {
+
+/// Characters of the EBNF operators in a rule body, with the `,` between
+/// the arguments of a parameterized rule.
+constexpr std::string_view kEbnfOperators = "()|?*+,";
+
+/**
+ * Turns EBNF bodies into plain productions. Every `?`, `*`, `+` and group
+ * with alternatives becomes a helper non-terminal, and helpers with the same
+ * operator and productions are shared (hash-consing), so `(a b)*` written in
+ * ten rules gives one helper. Inner expressions are desugared first, so
+ * helpers inside helpers are shared too.
+ *
+ * Applications of parameterized rules, `list(E)`, are instantiated the same
+ * way: every distinct rule and argument tuple of a module gives one
+ * non-terminal, whose bodies are the rule's with the arguments in place of
+ * the parameters.
+ */
+class EbnfDesugarer {
+  public:
+    explicit EbnfDesugarer(Grammar& gr) : gr_(gr) {}
+
+    /**
+     * Adds one body of a parameterized rule of a module. Returns `false` if
+     * another body of the rule has other parameters.
+     */
+    bool Define(size_t module, const std::string& name,
+                const std::vector<std::string>& parameters, production body) {
+        auto [it, inserted] =
+            macros_.try_emplace(std::to_string(module) + " " + name);
+        if (inserted) {
+            it->second.parameters = parameters;
+        } else if (it->second.parameters != parameters) {
+            return false;
+        }
+        it->second.bodies.push_back(std::move(body));
+        return true;
+    }
+
+    /**
+     * Desugars the tokens of a body: symbols and one-character operators.
+     * Adds the resulting productions of `antecedent`, or returns `false` if
+     * the body is malformed.
+     */
+    bool Add(const std::string& antecedent, const production& tokens) {
+        // Instantiating a parameterized rule adds its bodies from inside
+        // another body
+        const std::string* lhs   = lhs_;
+        const production*  outer = tokens_;
+        const size_t       pos   = pos_;
+        lhs_                     = &antecedent;
+        pos_                     = 0;
+        tokens_                  = &tokens;
+        std::vector<production> alternatives;
+        const bool ok = Expression(alternatives) && pos_ == tokens.size();
+        if (ok) {
+            for (production& prod : alternatives) {
+                gr_.AddProduction(antecedent, Body(std::move(prod)));
+            }
+        }
+        lhs_    = lhs;
+        tokens_ = outer;
+        pos_    = pos;
+        return ok;
+    }
+
+  private:
+    bool At(const char* op) const {
+        return pos_ < tokens_->size() && (*tokens_)[pos_] == op;
+    }
+
+    /// expression := sequence ('|' sequence)*
+    bool Expression(std::vector<production>& alternatives) {
+        do {
+            production sequence;
+            if (!Sequence(sequence)) {
+                return false;
+            }
+            alternatives.push_back(std::move(sequence));
+        } while (At("|") && ++pos_);
+        return true;
+    }
+
+    /// sequence := (atom ('?' | '*' | '+')*)*
+    bool Sequence(production& sequence) {
+        while (pos_ < tokens_->size() && !At("|") && !At(")") && !At(",")) {
+            std::vector<production> atom;
+            if (At("(")) {
+                ++pos_;
+                if (!Expression(atom) || !At(")")) {
+                    return false;
+                }
+                ++pos_;
+            } else if (At("?") || At("*") || At("+") || At(",")) {
+                return false; // no operand
+            } else if (auto macro = macros_.find(
+                           std::to_string(gr_.ModuleOf(*lhs_)) + " " +
+                           (*tokens_)[pos_]);
+                       macro != macros_.end()) {
+                const std::string& name = (*tokens_)[pos_++];
+                std::string        instance;
+                if (!Application(name, macro->second, instance)) {
+                    return false;
+                }
+                atom.push_back({instance});
+            } else {
+                atom.push_back({(*tokens_)[pos_++]});
+            }
+            while (At("?") || At("*") || At("+")) {
+                atom = {Apply((*tokens_)[pos_++][0], std::move(atom))};
+            }
+            if (atom.size() == 1) {
+                sequence.insert(sequence.end(), atom[0].begin(), atom[0].end());
+            } else {
+                sequence.push_back(Helper('(', atom));
+            }
+        }
+        return true;
+    }
+
+    /// Symbols that replace `atom op`.
+    production Apply(char op, std::vector<production> atom) {
+        if (op == '?') {
+            if (std::find(atom.begin(), atom.end(), production{}) ==
+                atom.end()) {
+                atom.emplace_back();
+            }
+            return {Helper('?', atom)};
+        }
+        const std::string star = Helper('*', atom);
+        if (op == '*') {
+            return {star};
+        }
+        // X+ is X X*, with X inlined when it has a single alternative
+        if (atom.size() == 1) {
+            atom[0].push_back(star);
+            return atom[0];
+        }
+        for (production& prod : atom) {
+            prod.push_back(star);
+        }
+        return {Helper('+', atom)};
+    }
+
+    /// Helper non-terminal for an operator and its operand.
+    std::string Helper(char op, const std::vector<production>& operand) {
+        // Helpers are shared inside a module only, so that the FIRST sets of
+        // a module never depend on a module it does not import
+        std::string key = std::to_string(gr_.ModuleOf(*lhs_)) + op;
+        for (const production& prod : operand) {
+            key += " |";
+            for (const std::string& symbol : prod) {
+                key += " " + symbol;
+            }
+        }
+        auto [it, inserted] = helpers_.try_emplace(key);
+        if (!inserted) {
+            return it->second;
+        }
+        static const std::unordered_map<char, std::string> kNames{
+            {'(', "_group"}, {'?', "_opt"}, {'*', "_star"}, {'+', "_plus"}};
+        std::string name = *lhs_ + kNames.at(op);
+        for (unsigned n = 2; gr_.st_.In(name); ++n) {
+            name = *lhs_ + kNames.at(op) + std::to_string(n);
+        }
+        it->second = name;
+        gr_.st_.PutSymbol(name);
+        Place(name);
+
+        // A* is A_star -> A A_star | EPSILON, right recursive so that it
+        // also suits LL(1)
+        for (production prod : operand) {
+            if (op == '*') {
+                if (prod.empty()) {
+                    continue;
+                }
+                prod.push_back(name);
+            }
+            gr_.AddProduction(name, Body(std::move(prod)));
+        }
+        if (op == '*') {
+            gr_.AddProduction(name, Body({}));
+        }
+        return name;
+    }
+
+    struct Macro {
+        std::vector<std::string> parameters;
+        std::vector<production>  bodies;
+    };
+
+    /// application := macro '(' expression (',' expression)* ')'
+    bool Application(const std::string& name, const Macro& macro,
+                     std::string& instance) {
+        if (!At("(")) {
+            return false; // a parameterized rule is not a symbol
+        }
+        std::vector<std::string> arguments;
+        do {
+            ++pos_;
+            std::vector<production> argument;
+            if (!Expression(argument)) {
+                return false;
+            }
+            if (argument.size() == 1 && argument[0].empty()) {
+                return false;
+            }
+            arguments.push_back(argument.size() == 1 && argument[0].size() == 1
+                                    ? argument[0][0]
+                                    : Helper('(', argument));
+        } while (At(","));
+        if (!At(")") || arguments.size() != macro.parameters.size()) {
+            return false;
+        }
+        ++pos_;
+        return Instantiate(name, macro, arguments, instance);
+    }
+
+    /// Non-terminal of a parameterized rule applied to its arguments.
+    bool Instantiate(const std::string& name, const Macro& macro,
+                     const std::vector<std::string>& arguments,
+                     std::string&                    instance) {
+        const Module& module = gr_.modules_[gr_.ModuleOf(*lhs_)];
+        std::string   key    = module.name + " " + name;
+        std::string   base   = name;
+        for (const std::string& argument : arguments) {
+            key += " " + argument;
+            base += "_" + argument;
+        }
+        auto [it, inserted] = instances_.try_emplace(key);
+        if (!inserted) {
+            instance = it->second;
+            return true;
+        }
+        // Arguments of imported modules are qualified, but the instance
+        // belongs to the module that applies the rule
+        std::replace(base.begin(), base.end(), '.', '_');
+        std::string lhs = SymbolTable::Qualify(module.name, base);
+        for (unsigned n = 2; gr_.st_.In(lhs); ++n) {
+            lhs = SymbolTable::Qualify(module.name, base + std::to_string(n));
+        }
+        it->second = instance = lhs;
+        gr_.st_.PutSymbol(lhs);
+        Place(lhs);
+
+        // The instance is memoized before its bodies are added, so that a
+        // recursive rule such as `list(X) -> X list(X);` refers to itself.
+        // Rules whose arguments grow forever are rejected
+        if (depth_ == kMaxDepth) {
+            return false;
+        }
+        ++depth_;
+        bool ok = true;
+        for (production body : macro.bodies) {
+            for (std::string& symbol : body) {
+                auto parameter = std::find(macro.parameters.begin(),
+                                           macro.parameters.end(), symbol);
+                if (parameter != macro.parameters.end()) {
+                    symbol = arguments[parameter - macro.parameters.begin()];
+                }
+            }
+            if (!(ok = Add(it->second, body))) {
+                break;
+            }
+        }
+        --depth_;
+        return ok;
+    }
+
+    /// Helpers and instances go after the first non-terminal that uses them,
+    /// in the order they are created.
+    void Place(const std::string& name) {
+        auto lhs = std::find(gr_.order.begin(), gr_.order.end(), *lhs_);
+        gr_.order.insert(lhs == gr_.order.end() ? lhs
+                                                : lhs + 1 + placed_[*lhs_]++,
+                         name);
+    }
+
+    /// An empty production is stored as EPSILON.
+    production Body(production prod) {
+        if (prod.empty()) {
+            gr_.st_.terminals_.insert(gr_.st_.EPSILON_);
+            prod.push_back(gr_.st_.EPSILON_);
+        }
+        return prod;
+    }
+
+    /// Nested instantiations allowed before a rule is deemed not to end.
+    static constexpr unsigned kMaxDepth = 64;
+
+    Grammar&                                     gr_;
+    std::unordered_map<std::string, std::string> helpers_;
+    std::unordered_map<std::string, Macro>       macros_;
+    std::unordered_map<std::string, std::string> instances_;
+    std::unordered_map<std::string, size_t>      placed_;
+    const std::string*                           lhs_    = nullptr;
+    const production*                            tokens_ = nullptr;
+    size_t                                       pos_    = 0;
+    unsigned                                     depth_  = 0;
+};
+
+/// A rule of a grammar file, before the symbols of its body are known.
+struct SourceRule {
+    std::string antecedent;
+    /// @brief Parameters of a parameterized rule, empty for the others.
+    std::vector<std::string> parameters;
+    /// @brief Body without spaces.
+    std::string consequent;
+};
+
+/// Contents of a grammar file, before the symbols of its rules are known.
+struct SourceFile {
+    std::vector<std::pair<std::string, std::string>> terminals;
+    std::string                                      axiom;
+    /// @brief Paths of the imported files, relative to this one.
+    std::vector<std::string> imports;
+    /// @brief `%left`, `%right` and `%nonassoc` lines, in file order.
+    std::vector<std::pair<Precedence::Associativity, std::vector<std::string>>>
+                            precedence;
+    std::vector<SourceRule> rules;
+    size_t                  fingerprint = 0;
+};
+
+bool ParseFile(const std::string& filename, SourceFile& source,
+               const std::string& epsilon) {
     std::ifstream file(filename, std::ios::in);
 
     if (!file.is_open()) {
         return false;
     }
 
-    std::unordered_map<std::string, std::vector<std::string>> p_grammar;
-    std::regex                                                rx_terminal{
+    std::regex rx_terminal{
         R"(terminal\s+([a-zA-Z_\'][a-zA-Z_0-9\']*)\s+([^]*);\s*)"};
     std::regex rx_axiom{R"(start\s+with\s+([a-zA-Z_\'][a-zA-Z_0-9\']*);\s*)"};
-    std::regex rx_empty_production{R"(([a-zA-Z_\'][a-zA-Z_0-9\']*)\s*->;\s*)"};
-    std::regex rx_production{"([a-zA-Z_\\'][a-zA-Z_0-9\\']*)\\s*->\\s*([a-zA-Z_"
-                             "\\'][a-zA-Z_0-9\\s$\\']*);"};
+    std::regex rx_import{"import\\s+\"([^\"]+)\";\\s*"};
+    std::regex rx_precedence{
+        R"(%(left|right|nonassoc)((?:\s+[a-zA-Z_\'][a-zA-Z_0-9\']*)+);\s*)"};
+    std::regex rx_empty_production{
+        R"(([a-zA-Z_\'][a-zA-Z_0-9\'.]*)\s*(?:\(([^)]*)\))?\s*->;\s*)"};
+    std::regex rx_production{
+        "([a-zA-Z_\\'][a-zA-Z_0-9\\'.]*)\\s*(?:\\(([^)]*)\\))?\\s*->\\s*"
+        "([a-zA-Z_\\'(|][a-zA-Z_0-9\\s$\\'.()|?*+,]*);"};
+    const std::regex rx_name{"[a-zA-Z_\\'][a-zA-Z_0-9\\']*"};
 
     std::string input;
     std::smatch match;
 
+    // `list(X, sep)` declares a parameterized rule: its name and its
+    // parameters must be plain names
+    auto parameters = [&](SourceRule& rule) {
+        if (!match[2].matched) {
+            return true;
+        }
+        std::string list = match[2];
+        list.erase(std::remove_if(list.begin(), list.end(), ::isspace),
+                   list.end());
+        std::istringstream names(list);
+        std::string        name;
+        while (getline(names, name, ',')) {
+            if (!std::regex_match(name, rx_name)) {
+                return false;
+            }
+            rule.parameters.push_back(name);
+        }
+        return !rule.parameters.empty() &&
+               std::regex_match(rule.antecedent, rx_name) && list.back() != ',';
+    };
+
     if (file.peek() == std::ifstream::traits_type::eof()) {
         return false;
     }
+    const std::string contents{std::istreambuf_iterator<char>(file),
+                               std::istreambuf_iterator<char>()};
+    source.fingerprint = std::hash<std::string>{}(contents);
+    std::istringstream lines(contents);
 
     try {
-        while (getline(file, input) && input != ";") {
-            std::string id;
-            std::string value;
-
+        while (getline(lines, input) && input != ";") {
             if (std::regex_match(input, match, rx_terminal)) {
-                st_.PutSymbol(match[1], match[2]);
+                source.terminals.emplace_back(match[1], match[2]);
             } else if (std::regex_match(input, match, rx_axiom)) {
-                SetAxiom(match[1]);
+                source.axiom = match[1];
+            } else if (std::regex_match(input, match, rx_import)) {
+                source.imports.push_back(match[1]);
+            } else if (std::regex_match(input, match, rx_precedence)) {
+                using Associativity = Precedence::Associativity;
+                const std::string kind = match[1];
+                auto&             line = source.precedence.emplace_back(
+                    kind == "left"    ? Associativity::Left
+                                : kind == "right" ? Associativity::Right
+                                                  : Associativity::NonAssoc,
+                    std::vector<std::string>{});
+                std::istringstream names(match[2].str());
+                for (std::string name; names >> name;) {
+                    line.second.push_back(name);
+                }
             } else {
                 return false;
             }
         }
 
-        while (getline(file, input) && input != ";") {
+        while (getline(lines, input) && input != ";") {
+            SourceRule rule;
             if (std::regex_match(input, match, rx_production)) {
-                std::string s = match[2];
-                s.erase(std::remove_if(s.begin(), s.end(), ::isspace), s.end());
-                p_grammar[match[1]].push_back(s);
-                if (std::find(order.begin(), order.end(), match[1]) ==
-                    order.end()) {
-                    order.push_back(match[1]);
-                }
+                rule.consequent = match[3];
+                rule.consequent.erase(std::remove_if(rule.consequent.begin(),
+                                                     rule.consequent.end(),
+                                                     ::isspace),
+                                      rule.consequent.end());
             } else if (std::regex_match(input, match, rx_empty_production)) {
-                p_grammar[match[1]].push_back(st_.EPSILON_);
-                st_.terminals_.insert(st_.EPSILON_);
-                if (std::find(order.begin(), order.end(), match[1]) ==
-                    order.end()) {
-                    order.push_back(match[1]);
-                }
+                rule.consequent = epsilon;
             } else {
                 return false;
             }
+            rule.antecedent = match[1];
+            if (!parameters(rule)) {
+                return false;
+            }
+            source.rules.push_back(std::move(rule));
         }
     } catch (const std::exception& e) {
-        file.close();
         return false;
     }
+    return true;
+}
+
+} // namespace
 
-    file.close();
+bool Grammar::ReadFromFile(const std::string& filename) {
+    stats::ScopedTimer timer(stats::Phase::Load);
+    namespace fs = std::filesystem;
 
-    // Add non-terminal symbols
-    for (const auto& entry : p_grammar) {
-        st_.PutSymbol(entry.first);
+    // The loaded file, then every module it imports, breadth first. A file
+    // is read once, however many files import it
+    std::vector<SourceFile> sources(1);
+    if (!ParseFile(filename, sources[0], st_.EPSILON_)) {
+        return false;
+    }
+    modules_ = {{"", filename, sources[0].fingerprint, {}}};
+    std::unordered_map<std::string, size_t> by_path{
+        {fs::weakly_canonical(filename).string(), 0}};
+    std::unordered_set<std::string> names;
+    const std::regex                rx_name{"[a-zA-Z_\\'][a-zA-Z_0-9\\']*"};
+    for (size_t m = 0; m < sources.size(); ++m) {
+        const fs::path dir = fs::path(modules_[m].path).parent_path();
+        const std::vector<std::string> imports = sources[m].imports;
+        for (const std::string& import : imports) {
+            const fs::path path = dir / import;
+            auto known = by_path.find(fs::weakly_canonical(path).string());
+            if (known == by_path.end()) {
+                // The file name is the namespace, so it must be a free name
+                const std::string name = path.stem().string();
+                SourceFile        source;
+                if (!std::regex_match(name, rx_name) ||
+                    !names.insert(name).second ||
+                    !ParseFile(path.string(), source, st_.EPSILON_)) {
+                    return false;
+                }
+                known = by_path
+                            .emplace(fs::weakly_canonical(path).string(),
+                                     sources.size())
+                            .first;
+                modules_.push_back({name, path.string(), source.fingerprint,
+                                    {}});
+                sources.push_back(std::move(source));
+            }
+            if (known->second == 0) {
+                return false; // the loaded file is not a module
+            }
+            modules_[m].imports.push_back(modules_[known->second].name);
+        }
     }
 
-    // Add all rules
-    for (const auto& entry : p_grammar) {
-        for (const auto& prod : entry.second) {
-            if (!AddRule(entry.first, prod)) {
+    // Terminals are shared by every file
+    for (const SourceFile& source : sources) {
+        for (const auto& [name, regex] : source.terminals) {
+            auto it = st_.st_.find(name);
+            if (it != st_.st_.end() && it->second.second != regex) {
                 return false;
             }
+            st_.PutSymbol(name, regex);
+        }
+    }
+    if (!sources[0].axiom.empty()) {
+        SetAxiom(sources[0].axiom);
+    }
+    unsigned level = 0;
+    for (const auto& [associativity, names] : sources[0].precedence) {
+        ++level;
+        for (const std::string& name : names) {
+            if (!st_.IsTerminalWthoEol(name) ||
+                !precedence_.insert({name, {level, associativity}}).second) {
+                return false; // not a terminal, or declared twice
+            }
+        }
+    }
+
+    // Add non-terminal symbols, qualified with their module
+    std::unordered_set<std::string> ordered;
+    for (size_t m = 0; m < sources.size(); ++m) {
+        for (const SourceRule& rule : sources[m].rules) {
+            if (rule.consequent == st_.EPSILON_) {
+                st_.terminals_.insert(st_.EPSILON_);
+            }
+            if (!rule.parameters.empty()) {
+                continue; // only its instances are non-terminals
+            }
+            const std::string nt =
+                SymbolTable::Qualify(modules_[m].name, rule.antecedent);
+            st_.PutSymbol(nt);
+            if (ordered.insert(nt).second) {
+                order.push_back(nt);
+            }
+        }
+    }
+
+    // Split every body before EBNF helpers enter the symbol table, so they
+    // never change how a body is split. EBNF bodies keep their operators as
+    // one-character tokens between the split symbols. A module sees the
+    // terminals, its own non-terminals unqualified and the non-terminals of
+    // the modules it imports, directly or not, qualified
+    std::unordered_map<std::string, size_t> by_name;
+    for (size_t m = 1; m < modules_.size(); ++m) {
+        by_name[modules_[m].name] = m;
+    }
+    std::vector<std::string> antecedents;
+    std::vector<production>  bodies;
+    std::vector<char>        is_ebnf;
+    EbnfDesugarer            ebnf(*this);
+    for (size_t m = 0; m < sources.size(); ++m) {
+        Grammar                         view;
+        std::unordered_set<std::string> local;
+        if (m > 0) {
+            std::vector<char>   visible(modules_.size(), 0);
+            std::vector<size_t> pending{m};
+            while (!pending.empty()) {
+                const size_t current = pending.back();
+                pending.pop_back();
+                for (const std::string& name : modules_[current].imports) {
+                    const size_t imported = by_name.at(name);
+                    if (!visible[imported]) {
+                        visible[imported] = 1;
+                        pending.push_back(imported);
+                    }
+                }
+            }
+            for (const auto& [symbol, entry] : st_.st_) {
+                if (entry.first == TERMINAL || visible[ModuleOf(symbol)]) {
+                    view.st_.st_.insert({symbol, entry});
+                }
+            }
+            for (const SourceRule& rule : sources[m].rules) {
+                if (rule.parameters.empty()) {
+                    view.st_.PutSymbol(rule.antecedent);
+                    local.insert(rule.antecedent);
+                }
+            }
+        }
+        Grammar& splitter = m > 0 ? view : *this;
+
+        // Parameterized rules and their parameters are symbols only while
+        // the bodies of the module are split
+        std::vector<std::string> scoped;
+        auto scope = [&](const std::string&        name,
+                         std::vector<std::string>& to) {
+            if (splitter.st_.st_.insert({name, {NO_TERMINAL, ""}}).second) {
+                to.push_back(name);
+            }
+        };
+        for (const SourceRule& rule : sources[m].rules) {
+            if (rule.parameters.empty()) {
+                continue;
+            }
+            if (st_.In(SymbolTable::Qualify(modules_[m].name,
+                                            rule.antecedent)) ||
+                st_.IsTerminal(rule.antecedent)) {
+                return false; // the name of a symbol
+            }
+        }
+        for (const SourceRule& rule : sources[m].rules) {
+            if (!rule.parameters.empty()) {
+                scope(rule.antecedent, scoped);
+            }
+        }
+
+        const std::vector<std::string>* parameters = nullptr;
+        auto split = [&](const std::string& symbols, production& out) {
+            production split{splitter.Split(symbols)};
+            for (std::string& symbol : split) {
+                if (local.contains(symbol) &&
+                    std::find(parameters->begin(), parameters->end(),
+                              symbol) == parameters->end()) {
+                    symbol = SymbolTable::Qualify(modules_[m].name, symbol);
+                }
+            }
+            out.insert(out.end(), split.begin(), split.end());
+            return !split.empty();
+        };
+        for (const SourceRule& rule : sources[m].rules) {
+            const std::string& consequent = rule.consequent;
+            std::vector<std::string> names;
+            for (const std::string& parameter : rule.parameters) {
+                scope(parameter, names);
+            }
+            parameters = &rule.parameters;
+            production tokens;
+            const bool ebnf_body = consequent.find_first_of(kEbnfOperators) !=
+                                   std::string::npos;
+            if (!ebnf_body &&
+                (!split(consequent, tokens) ||
+                 std::find_first_of(tokens.begin(), tokens.end(),
+                                    scoped.begin(),
+                                    scoped.end()) != tokens.end())) {
+                return false; // a parameterized rule without arguments
+            }
+            size_t start = 0;
+            while (ebnf_body && start < consequent.size()) {
+                const size_t end =
+                    consequent.find_first_of(kEbnfOperators, start);
+                if (end != start &&
+                    !split(consequent.substr(start, end - start), tokens)) {
+                    return false;
+                }
+                if (end == std::string::npos) {
+                    break;
+                }
+                tokens.emplace_back(1, consequent[end]);
+                start = end + 1;
+            }
+            for (const std::string& parameter : names) {
+                splitter.st_.st_.erase(parameter);
+            }
+            if (!rule.parameters.empty()) {
+                if (!ebnf.Define(m, rule.antecedent, rule.parameters,
+                                 std::move(tokens))) {
+                    return false;
+                }
+                continue;
+            }
+            antecedents.push_back(
+                SymbolTable::Qualify(modules_[m].name, rule.antecedent));
+            is_ebnf.push_back(ebnf_body);
+            bodies.push_back(std::move(tokens));
+        }
+        for (const std::string& name : scoped) {
+            splitter.st_.st_.erase(name);
+        }
+    }
+
+    // Add all rules, in file order
+    for (size_t i = 0; i < antecedents.size(); ++i) {
+        if (!is_ebnf[i]) {
+            AddProduction(antecedents[i], bodies[i]);
+        } else if (!ebnf.Add(antecedents[i], bodies[i])) {
+            return false;
         }
     }
 
     return true; // Todo salió bien
 }
 
+const Precedence*
+Grammar::RulePrecedence(const production& consequent) const {
+    for (auto symbol = consequent.rbegin(); symbol != consequent.rend();
+         ++symbol) {
+        auto it = precedence_.find(*symbol);
+        if (it != precedence_.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+size_t Grammar::ModuleOf(const std::string& non_terminal) const {
+    const size_t dot = non_terminal.find('.');
+    if (dot == std::string::npos) {
+        return 0;
+    }
+    const std::string_view name(non_terminal.data(), dot);
+    for (size_t m = 1; m < modules_.size(); ++m) {
+        if (modules_[m].name == name) {
+            return m;
+        }
+    }
+    return 0;
+}
+
 std::vector<std::string> Grammar::Split(const std::string& s) {
+    stats::ScopedTimer timer(stats::Phase::Split);
     if (s == st_.EPSILON_) {
         return {st_.EPSILON_};
     }
@@ -174,6 +789,78 @@ void Grammar::Debug() {
     }
 }
 
+void Grammar::Write(std::ostream& out) const {
+    std::vector<std::string> terminals;
+    for (const auto& [symbol, entry] : st_.st_) {
+        if (entry.first == TERMINAL && symbol != st_.EOL_ &&
+            symbol != st_.EPSILON_) {
+            terminals.push_back(symbol);
+        }
+    }
+    std::sort(terminals.begin(), terminals.end());
+    for (const std::string& t : terminals) {
+        out << "terminal " << t << " " << st_.st_.at(t).second << ";\n";
+    }
+    // Precedence lines, lowest first
+    std::map<unsigned, std::pair<Precedence::Associativity,
+                                 std::vector<std::string>>>
+        levels;
+    for (const auto& [terminal, precedence] : precedence_) {
+        auto& line = levels[precedence.level];
+        line.first = precedence.associativity;
+        line.second.push_back(terminal);
+    }
+    for (auto& [level, line] : levels) {
+        using Associativity = Precedence::Associativity;
+        out << (line.first == Associativity::Left    ? "%left"
+                : line.first == Associativity::Right ? "%right"
+                                                     : "%nonassoc");
+        std::sort(line.second.begin(), line.second.end());
+        for (const std::string& terminal : line.second) {
+            out << " " << terminal;
+        }
+        out << ";\n";
+    }
+    out << "start with " << axiom_ << ";\n;\n";
+
+    // Non-terminals missing from `order` go last, in name order
+    std::vector<std::string>              non_terminals(order);
+    const std::unordered_set<std::string> ordered(order.begin(), order.end());
+    std::vector<std::string>              missing;
+    for (const auto& [nt, productions] : g_) {
+        if (!ordered.contains(nt)) {
+            missing.push_back(nt);
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+    non_terminals.insert(non_terminals.end(), missing.begin(), missing.end());
+    for (const std::string& nt : non_terminals) {
+        auto productions = g_.find(nt);
+        if (productions == g_.end()) {
+            continue;
+        }
+        for (const production& prod : productions->second) {
+            out << nt << " ->";
+            for (const std::string& symbol : prod) {
+                if (symbol != st_.EPSILON_) {
+                    out << " " << symbol;
+                }
+            }
+            out << ";\n";
+        }
+    }
+    out << ";\n";
+}
+
+bool Grammar::WriteToFile(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file) {
+        return false;
+    }
+    Write(file);
+    return static_cast<bool>(file);
+}
+
 bool Grammar::HasLeftRecursion(const std::string&              antecedent,
                                const std::vector<std::string>& consequent) {
     return consequent.at(0) == antecedent;
@@ -183,3 +870,134 @@ void Grammar::AddProduction(const std::string&              antecedent,
                             const std::vector<std::string>& consequent) {
     g_[antecedent].push_back(std::move(consequent));
 }
+
+bool Grammar::InsertRule(const std::string& antecedent,
+                         const production&  consequent) {
+    if (antecedent == axiom_ || st_.IsTerminal(antecedent) ||
+        consequent.empty()) {
+        return false;
+    }
+    for (const std::string& symbol : consequent) {
+        if (!st_.In(symbol) || symbol == st_.EOL_ ||
+            (symbol == st_.EPSILON_ && consequent.size() > 1)) {
+            return false;
+        }
+    }
+    auto rules = g_.find(antecedent);
+    if (rules != g_.end() && std::find(rules->second.begin(),
+                                       rules->second.end(),
+                                       consequent) != rules->second.end()) {
+        return false;
+    }
+    if (!st_.In(antecedent)) {
+        st_.PutSymbol(antecedent);
+    }
+    if (std::find(order.begin(), order.end(), antecedent) == order.end()) {
+        order.push_back(antecedent);
+    }
+    if (consequent[0] == st_.EPSILON_) {
+        st_.terminals_.insert(st_.EPSILON_);
+    }
+    g_[antecedent].push_back(consequent);
+    return true;
+}
+
+bool Grammar::RemoveRule(const std::string& antecedent,
+                         const production&  consequent) {
+    auto rules = g_.find(antecedent);
+    if (antecedent == axiom_ || rules == g_.end()) {
+        return false;
+    }
+    auto rule =
+        std::find(rules->second.begin(), rules->second.end(), consequent);
+    if (rule == rules->second.end()) {
+        return false;
+    }
+    if (rules->second.size() > 1) {
+        rules->second.erase(rule);
+        return true;
+    }
+    for (const auto& [nt, productions] : g_) {
+        for (const production& prod : productions) {
+            if (std::find(prod.begin(), prod.end(), antecedent) != prod.end()) {
+                return false;
+            }
+        }
+    }
+    g_.erase(rules);
+    order.erase(std::find(order.begin(), order.end(), antecedent));
+    st_.st_.erase(antecedent);
+    st_.non_terminals_.erase(antecedent);
+    return true;
+}
+
+bool Grammar::Apply(const RuleEdit& edit) {
+    return edit.add ? InsertRule(edit.antecedent, edit.consequent)
+                    : RemoveRule(edit.antecedent, edit.consequent);
+}
+
+bool Grammar::EditsTo(const Grammar& next, std::vector<RuleEdit>& edits) const {
+    edits.clear();
+    if (axiom_ != next.axiom_ || st_.terminals_ != next.st_.terminals_ ||
+        precedence_ != next.precedence_) {
+        return false;
+    }
+    for (const std::string& t : st_.terminals_) {
+        auto mine   = st_.st_.find(t);
+        auto theirs = next.st_.st_.find(t);
+        if ((mine == st_.st_.end()) != (theirs == next.st_.st_.end()) ||
+            (mine != st_.st_.end() && mine->second != theirs->second)) {
+            return false;
+        }
+    }
+    auto axiom_rules      = g_.find(axiom_);
+    auto next_axiom_rules = next.g_.find(axiom_);
+    if (axiom_rules == g_.end() || next_axiom_rules == next.g_.end() ||
+        axiom_rules->second != next_axiom_rules->second) {
+        return false;
+    }
+
+    // Rules of one grammar that the other one does not have, in the order
+    // of their non-terminals
+    auto missing = [](const Grammar& from, const Grammar& in, bool add) {
+        std::vector<RuleEdit> rules;
+        for (const std::string& nt : from.order) {
+            auto productions = from.g_.find(nt);
+            if (productions == from.g_.end()) {
+                continue;
+            }
+            auto other = in.g_.find(nt);
+            for (const production& prod : productions->second) {
+                if (other == in.g_.end() ||
+                    std::find(other->second.begin(), other->second.end(),
+                              prod) == other->second.end()) {
+                    rules.push_back({add, nt, prod});
+                }
+            }
+        }
+        return rules;
+    };
+    std::vector<RuleEdit> added   = missing(next, *this, true);
+    std::vector<RuleEdit> removed = missing(*this, next, false);
+
+    // Apply them on a copy, retrying the rejected ones while some edit is
+    // accepted
+    Grammar current = *this;
+    auto    drain   = [&](std::vector<RuleEdit>& todo) {
+        for (bool progress = true; progress && !todo.empty();) {
+            progress = false;
+            std::vector<RuleEdit> rejected;
+            for (RuleEdit& edit : todo) {
+                if (current.Apply(edit)) {
+                    edits.push_back(std::move(edit));
+                    progress = true;
+                } else {
+                    rejected.push_back(std::move(edit));
+                }
+            }
+            todo = std::move(rejected);
+        }
+        return todo.empty();
+    };
+    return drain(added) && drain(removed);
+}
@@ -0,0 +1,944 @@
+#include "../../include/grammar_factory.hpp"
+#include "../../include/grammar.hpp"
+#include "../../include/graph.hpp"
+#include "../../include/ll1_parser.hpp"
+#include "../../include/slr1_parser.hpp"
+#include "../../include/symbol_index.hpp"
+#include "../../include/symbol_table.hpp"
+#include <algorithm>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+using Rules = std::unordered_map<std::string, std::vector<production>>;
+
+/// Placeholder terminals of the Level 1 items, renamed when they are used
+const std::vector<std::string> kPlaceholders{"a", "b", "c"};
+
+/**
+ * Renames the non-terminal `A` of a Level 1 item to `nt` and its placeholder
+ * terminals to distinct letters of the alphabet.
+ */
+Rules Rename(const Rules& rules, const std::string& nt,
+             const std::vector<std::string>& alphabet, std::mt19937& rng) {
+    std::vector<std::string> letters(alphabet);
+    std::shuffle(letters.begin(), letters.end(), rng);
+    std::unordered_map<std::string, std::string> names{{"A", nt}};
+    for (size_t i = 0; i < kPlaceholders.size(); ++i) {
+        names[kPlaceholders[i]] = letters[i];
+    }
+
+    Rules renamed;
+    for (const auto& [antecedent, productions] : rules) {
+        for (const production& prod : productions) {
+            production copy;
+            for (const std::string& symbol : prod) {
+                auto it = names.find(symbol);
+                copy.push_back(it == names.end() ? symbol : it->second);
+            }
+            renamed[names.at(antecedent)].push_back(copy);
+        }
+    }
+    return renamed;
+}
+
+/**
+ * Builds a grammar from a factory item, with the axiom rule S -> A $. The
+ * non-terminals are kept in alphabet order.
+ */
+Grammar ToGrammar(const GrammarFactory::FactoryItem& item,
+                  const std::vector<std::string>&    alphabet) {
+    Grammar gr;
+    gr.st_    = item.st_;
+    gr.g_     = item.g_;
+    gr.axiom_ = "S";
+    gr.st_.PutSymbol(gr.axiom_);
+    gr.AddProduction(gr.axiom_, {alphabet[0], gr.st_.EOL_});
+    gr.order.push_back(gr.axiom_);
+    for (const std::string& nt : alphabet) {
+        if (gr.g_.contains(nt)) {
+            gr.order.push_back(nt);
+        }
+    }
+    return gr;
+}
+
+/// Hash of a production, to find repeated ones in constant time.
+struct ProductionHash {
+    size_t operator()(const production& prod) const {
+        size_t h = prod.size();
+        for (const std::string& symbol : prod) {
+            h ^= std::hash<std::string>{}(symbol) + 0x9e3779b9 + (h << 6) +
+                 (h >> 2);
+        }
+        return h;
+    }
+};
+
+using ProductionSet = std::unordered_set<production, ProductionHash>;
+
+/// Non-terminals added by a transformation, by the one they come from.
+using NewNonTerminals =
+    std::unordered_map<std::string, std::vector<std::string>>;
+
+/**
+ * The non-terminals of a grammar: the ones in `order`, then the ones missing
+ * from it in name order.
+ */
+std::vector<std::string> NonTerminals(const Grammar& grammar) {
+    std::vector<std::string> non_terminals;
+    std::unordered_set<std::string> seen;
+    for (const std::string& nt : grammar.order) {
+        if (grammar.g_.contains(nt) && seen.insert(nt).second) {
+            non_terminals.push_back(nt);
+        }
+    }
+    const size_t ordered = non_terminals.size();
+    for (const auto& [nt, productions] : grammar.g_) {
+        if (!seen.contains(nt)) {
+            non_terminals.push_back(nt);
+        }
+    }
+    std::sort(non_terminals.begin() + ordered, non_terminals.end());
+    return non_terminals;
+}
+
+/**
+ * Rebuilds `order` with every added non-terminal right after the one it comes
+ * from, in one pass.
+ */
+void PlaceNewNonTerminals(Grammar& grammar, const NewNonTerminals& added) {
+    if (added.empty()) {
+        return;
+    }
+    std::unordered_set<std::string> placed;
+    for (const auto& [base, non_terminals] : added) {
+        placed.insert(non_terminals.begin(), non_terminals.end());
+    }
+    std::vector<std::string> order;
+    for (const std::string& nt : NonTerminals(grammar)) {
+        if (placed.contains(nt)) {
+            continue; // goes after the one it comes from
+        }
+        order.push_back(nt);
+        if (auto it = added.find(nt); it != added.end()) {
+            order.insert(order.end(), it->second.begin(), it->second.end());
+        }
+    }
+    grammar.order = std::move(order);
+}
+
+/**
+ * Productive non-terminals of an indexed grammar. Every rule counts the
+ * non-terminals of its body not yet known to be productive, and a
+ * non-terminal becomes productive when one of its rules reaches zero.
+ */
+std::vector<char> Productive(const SymbolIndex& index) {
+    const size_t n           = index.non_terminals_.size();
+    const int    n_terminals = static_cast<int>(index.terminals_.size());
+    std::vector<char>                  productive(n, 0);
+    std::vector<unsigned>              pending(index.rules_.size(), 0);
+    std::vector<std::vector<unsigned>> occurrences(n);
+    std::vector<int>                   worklist;
+    for (unsigned r = 0; r < index.rules_.size(); ++r) {
+        for (int symbol : index.rules_[r].rhs_) {
+            if (!index.IsTerminal(symbol)) {
+                occurrences[symbol - n_terminals].push_back(r);
+                ++pending[r];
+            }
+        }
+    }
+    for (unsigned r = 0; r < index.rules_.size(); ++r) {
+        const int lhs = index.rules_[r].lhs_;
+        if (pending[r] == 0 && !productive[lhs]) {
+            productive[lhs] = 1;
+            worklist.push_back(lhs);
+        }
+    }
+    while (!worklist.empty()) {
+        const int nt = worklist.back();
+        worklist.pop_back();
+        for (unsigned r : occurrences[nt]) {
+            const int lhs = index.rules_[r].lhs_;
+            if (--pending[r] == 0 && !productive[lhs]) {
+                productive[lhs] = 1;
+                worklist.push_back(lhs);
+            }
+        }
+    }
+    return productive;
+}
+
+/**
+ * Non-terminals reachable from the axiom of an indexed grammar. If `allowed`
+ * is not empty, only the rules whose non-terminals are all allowed are used.
+ */
+std::vector<char> Reachable(const SymbolIndex&       index,
+                            const std::vector<char>& allowed) {
+    const size_t n           = index.non_terminals_.size();
+    const int    n_terminals = static_cast<int>(index.terminals_.size());
+    // Rules are grouped by antecedent, so each one owns a range of them
+    std::vector<unsigned> first(n + 1, 0);
+    for (const SymbolIndex::Rule& rule : index.rules_) {
+        ++first[rule.lhs_ + 1];
+    }
+    for (size_t nt = 0; nt < n; ++nt) {
+        first[nt + 1] += first[nt];
+    }
+    auto usable = [&](const SymbolIndex::Rule& rule) {
+        return allowed.empty() ||
+               std::all_of(rule.rhs_.begin(), rule.rhs_.end(), [&](int s) {
+                   return index.IsTerminal(s) || allowed[s - n_terminals];
+               });
+    };
+
+    std::vector<char> reachable(n, 0);
+    std::vector<int>  worklist{0};
+    reachable[0] = 1;
+    while (!worklist.empty()) {
+        const int nt = worklist.back();
+        worklist.pop_back();
+        for (unsigned r = first[nt]; r < first[nt + 1]; ++r) {
+            if (!usable(index.rules_[r])) {
+                continue;
+            }
+            for (int symbol : index.rules_[r].rhs_) {
+                if (!index.IsTerminal(symbol) &&
+                    !reachable[symbol - n_terminals]) {
+                    reachable[symbol - n_terminals] = 1;
+                    worklist.push_back(symbol - n_terminals);
+                }
+            }
+        }
+    }
+    return reachable;
+}
+
+} // namespace
+
+GrammarFactory::FactoryItem::FactoryItem(
+    const std::unordered_map<std::string, std::vector<production>>& grammar)
+    : g_(grammar) {
+    for (const auto& [nt, productions] : g_) {
+        st_.PutSymbol(nt);
+    }
+    for (const auto& [nt, productions] : g_) {
+        for (const production& prod : productions) {
+            for (const std::string& symbol : prod) {
+                if (symbol == st_.EPSILON_) {
+                    st_.terminals_.insert(st_.EPSILON_);
+                } else if (!g_.contains(symbol)) {
+                    st_.PutSymbol(symbol, symbol);
+                }
+            }
+        }
+    }
+}
+
+bool GrammarFactory::FactoryItem::HasEmptyProduction(
+    const std::string& antecedent) {
+    const auto& productions = g_.at(antecedent);
+    return std::any_of(productions.begin(), productions.end(),
+                       [&](const production& prod) {
+                           return prod[0] == st_.EPSILON_;
+                       });
+}
+
+void GrammarFactory::FactoryItem::Debug() {
+    for (const auto& [nt, productions] : g_) {
+        std::cout << nt << " -> ";
+        for (size_t i = 0; i < productions.size(); ++i) {
+            for (const std::string& symbol : productions[i]) {
+                std::cout << symbol << " ";
+            }
+            if (i < productions.size() - 1) {
+                std::cout << "| ";
+            }
+        }
+        std::cout << "\n";
+    }
+}
+
+void GrammarFactory::Init() {
+    items.clear();
+    // Level 1 items over the non-terminal A and the placeholders a, b and c
+    const std::string eps{"EPSILON"};
+    items.emplace_back(Rules{{"A", {{"a", "A"}, {"b"}}}});
+    items.emplace_back(Rules{{"A", {{"A", "a"}, {"b"}}}});
+    items.emplace_back(Rules{{"A", {{"a", "A", "b"}, {eps}}}});
+    items.emplace_back(Rules{{"A", {{"a", "b", "A"}, {"a"}}}});
+    items.emplace_back(Rules{{"A", {{"a"}, {"b"}}}});
+    items.emplace_back(Rules{{"A", {{"a", "A"}, {eps}}}});
+    items.emplace_back(Rules{{"A", {{"A", "a"}, {eps}}}});
+    items.emplace_back(Rules{{"A", {{"a", "A", "c"}, {"b"}}}});
+    items.emplace_back(Rules{{"A", {{"a", "b"}, {"a", "c"}}}});
+    items.emplace_back(Rules{{"A", {{"b", "A", "a"}, {"c"}}}});
+}
+
+void GrammarFactory::Seed(std::uint32_t seed) {
+    rng_.seed(seed);
+}
+
+Grammar GrammarFactory::Generate(const Params& params) {
+    std::mt19937   rng(params.seed);
+    const unsigned n = std::max(params.non_terminals, 1u);
+    const unsigned t = std::max(params.terminals, 1u);
+
+    Grammar gr;
+    gr.axiom_ = "S";
+    gr.st_.PutSymbol(gr.axiom_);
+    gr.order.push_back(gr.axiom_);
+    std::vector<std::string> non_terminals(n);
+    std::vector<std::string> terminals(t);
+    for (unsigned i = 0; i < n; ++i) {
+        non_terminals[i] = "N" + std::to_string(i);
+        gr.st_.PutSymbol(non_terminals[i]);
+        gr.order.push_back(non_terminals[i]);
+    }
+    for (unsigned i = 0; i < t; ++i) {
+        terminals[i] = "t" + std::to_string(i);
+        gr.st_.PutSymbol(terminals[i], terminals[i]);
+    }
+    gr.AddProduction(gr.axiom_, {non_terminals[0], gr.st_.EOL_});
+
+    std::discrete_distribution<unsigned> length(params.length_weights.begin(),
+                                                params.length_weights.end());
+    std::uniform_int_distribution<unsigned> terminal(0, t - 1);
+    std::bernoulli_distribution is_terminal(params.terminal_ratio);
+    std::bernoulli_distribution is_back(0.5);
+
+    // Random symbol at position `pos` of a rule of non-terminal `i`
+    auto symbol = [&](unsigned i, size_t pos) -> const std::string& {
+        const bool can_forward = i + 1 < n;
+        const bool can_back    = params.recursion_depth > 0 && pos > 0;
+        if (is_terminal(rng) || (!can_forward && !can_back)) {
+            return terminals[terminal(rng)];
+        }
+        if (can_back && (!can_forward || is_back(rng))) {
+            const unsigned lo = i + 1 >= params.recursion_depth
+                                    ? i + 1 - params.recursion_depth
+                                    : 0;
+            return non_terminals[std::uniform_int_distribution<unsigned>(
+                lo, i)(rng)];
+        }
+        return non_terminals[std::uniform_int_distribution<unsigned>(
+            i + 1, n - 1)(rng)];
+    };
+
+    auto random_rule = [&](unsigned i) {
+        production body(length(rng));
+        for (size_t pos = 0; pos < body.size(); ++pos) {
+            body[pos] = symbol(i, pos);
+        }
+        return body;
+    };
+
+    bool     has_epsilon = false;
+    unsigned keys        = 0;
+    auto     add_rule    = [&](unsigned i, production body) {
+        if (params.keyed) {
+            const std::string key = "k" + std::to_string(keys++);
+            gr.st_.PutSymbol(key, key);
+            body.insert(body.begin(), key);
+        } else if (body.empty()) {
+            body.push_back(gr.st_.EPSILON_);
+            has_epsilon = true;
+        }
+        auto& productions = gr.g_[non_terminals[i]];
+        if (std::find(productions.begin(), productions.end(), body) ==
+            productions.end()) {
+            productions.push_back(std::move(body));
+        }
+    };
+
+    // First rule: children in the tree plus forward references only, so
+    // every non-terminal is reachable and productive
+    for (unsigned i = 0; i < n; ++i) {
+        production body;
+        for (unsigned child : {2 * i + 1, 2 * i + 2}) {
+            if (child < n) {
+                body.push_back(non_terminals[child]);
+            }
+        }
+        const size_t len = std::max<size_t>(length(rng), body.size());
+        while (body.size() < len) {
+            if (i + 1 < n && !is_terminal(rng)) {
+                std::uniform_int_distribution<unsigned> forward(i + 1, n - 1);
+                body.push_back(non_terminals[forward(rng)]);
+            } else {
+                body.push_back(terminals[terminal(rng)]);
+            }
+        }
+        std::shuffle(body.begin(), body.end(), rng);
+        if (body.empty()) {
+            body.push_back(terminals[terminal(rng)]);
+        }
+        add_rule(i, std::move(body));
+    }
+
+    std::bernoulli_distribution nullable(params.nullable_ratio);
+    unsigned                    rules = n;
+    for (unsigned i = 0; i < n; ++i) {
+        if (!params.keyed && rules < params.rules && nullable(rng)) {
+            add_rule(i, {});
+            ++rules;
+        }
+    }
+    std::uniform_int_distribution<unsigned> any(0, n - 1);
+    for (; rules < params.rules; ++rules) {
+        const unsigned i = any(rng);
+        add_rule(i, random_rule(i));
+    }
+
+    if (has_epsilon) {
+        gr.st_.terminals_.insert(gr.st_.EPSILON_);
+    }
+    return gr;
+}
+
+Grammar GrammarFactory::PickOne(int level) {
+    switch (level) {
+    case 2:
+        return Lv2();
+    case 3:
+        return Lv3();
+    case 4:
+        return Lv4();
+    case 5:
+        return Lv5();
+    case 6:
+        return Lv6();
+    case 7:
+        return Lv7();
+    default:
+        return Lv1();
+    }
+}
+
+Grammar GrammarFactory::GenLL1Grammar(int level) {
+    while (true) {
+        Grammar gr = PickOne(level);
+        if (HasUnreachableSymbols(gr) || IsInfinite(gr)) {
+            continue;
+        }
+        if (LL1Parser(gr).CreateLL1Table()) {
+            return gr;
+        }
+        // Try to turn it into an LL(1) grammar before picking another one
+        RemoveLeftRecursion(gr);
+        LeftFactorize(gr);
+        if (LL1Parser(gr).CreateLL1Table()) {
+            return gr;
+        }
+    }
+}
+
+Grammar GrammarFactory::GenSLR1Grammar(int level) {
+    while (true) {
+        Grammar gr = PickOne(level);
+        if (HasUnreachableSymbols(gr) || IsInfinite(gr)) {
+            continue;
+        }
+        if (SLR1Parser(gr).MakeParser()) {
+            return gr;
+        }
+    }
+}
+
+void GrammarFactory::SanityChecks(Grammar& gr) {
+    std::cout << "Unreachable symbols: "
+              << (HasUnreachableSymbols(gr) ? "yes" : "no") << "\n";
+    std::cout << "Infinite: " << (IsInfinite(gr) ? "yes" : "no") << "\n";
+    std::cout << "Direct left recursion: "
+              << (HasDirectLeftRecursion(gr) ? "yes" : "no") << "\n";
+}
+
+Grammar GrammarFactory::Lv1() {
+    return ToGrammar(CreateLvItem(1), non_terminal_alphabet_);
+}
+
+Grammar GrammarFactory::Lv2() {
+    return ToGrammar(CreateLv2Item(), non_terminal_alphabet_);
+}
+
+Grammar GrammarFactory::Lv3() {
+    return ToGrammar(CreateLvItem(3), non_terminal_alphabet_);
+}
+
+Grammar GrammarFactory::Lv4() {
+    return ToGrammar(CreateLvItem(4), non_terminal_alphabet_);
+}
+
+Grammar GrammarFactory::Lv5() {
+    return ToGrammar(CreateLvItem(5), non_terminal_alphabet_);
+}
+
+Grammar GrammarFactory::Lv6() {
+    return ToGrammar(CreateLvItem(6), non_terminal_alphabet_);
+}
+
+Grammar GrammarFactory::Lv7() {
+    return ToGrammar(CreateLvItem(7), non_terminal_alphabet_);
+}
+
+GrammarFactory::FactoryItem GrammarFactory::CreateLv2Item() {
+    return CreateLvItem(2);
+}
+
+GrammarFactory::FactoryItem GrammarFactory::CreateLvItem(int level) {
+    if (items.empty()) {
+        Init();
+    }
+    level = std::clamp(level, 1,
+                       static_cast<int>(non_terminal_alphabet_.size()));
+    const std::string& nt = non_terminal_alphabet_[level - 1];
+    std::uniform_int_distribution<size_t> pick(0, items.size() - 1);
+    Rules leaf = Rename(items[pick(rng_)].g_, nt, terminal_alphabet_, rng_);
+    if (level == 1) {
+        return FactoryItem(leaf);
+    }
+
+    // Replace a terminal of the last non-terminal of the previous level with
+    // the new one, so that it is reachable
+    Rules              rules = CreateLvItem(level - 1).g_;
+    const std::string& prev  = non_terminal_alphabet_[level - 2];
+    std::vector<std::pair<size_t, size_t>> terminals;
+    for (size_t p = 0; p < rules[prev].size(); ++p) {
+        for (size_t i = 0; i < rules[prev][p].size(); ++i) {
+            const std::string& symbol = rules[prev][p][i];
+            if (symbol != "EPSILON" && !rules.contains(symbol)) {
+                terminals.emplace_back(p, i);
+            }
+        }
+    }
+    const auto [p, i] = terminals[std::uniform_int_distribution<size_t>(
+        0, terminals.size() - 1)(rng_)];
+    rules[prev][p][i] = nt;
+    rules.merge(leaf);
+    return FactoryItem(rules);
+}
+
+bool GrammarFactory::HasUnreachableSymbols(Grammar& grammar) {
+    const SymbolIndex       index(grammar);
+    const std::vector<char> reachable = Reachable(index, {});
+    for (size_t nt = 0; nt < index.non_terminals_.size(); ++nt) {
+        if (!reachable[nt] && grammar.g_.contains(index.non_terminals_[nt])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GrammarFactory::IsInfinite(Grammar& grammar) {
+    const SymbolIndex       index(grammar);
+    const std::vector<char> productive = Productive(index);
+    for (size_t nt = 0; nt < index.non_terminals_.size(); ++nt) {
+        if (!productive[nt] && grammar.g_.contains(index.non_terminals_[nt])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+GrammarFactory::Pruned GrammarFactory::Prune(Grammar& grammar) {
+    Pruned                  pruned;
+    const SymbolIndex       index(grammar);
+    const std::vector<char> productive = Productive(index);
+    if (!productive[0]) {
+        pruned.empty_language = true;
+        return pruned;
+    }
+    const std::vector<char> reachable = Reachable(index, productive);
+
+    std::unordered_set<std::string> useless;
+    for (size_t nt = 0; nt < index.non_terminals_.size(); ++nt) {
+        const std::string& name = index.non_terminals_[nt];
+        if (!productive[nt]) {
+            useless.insert(name);
+            if (grammar.g_.contains(name)) {
+                pruned.unproductive.push_back(name);
+            }
+        } else if (!reachable[nt]) {
+            useless.insert(name);
+            pruned.unreachable.push_back(name);
+        }
+    }
+    if (useless.empty()) {
+        return pruned;
+    }
+
+    for (auto it = grammar.g_.begin(); it != grammar.g_.end();) {
+        if (useless.contains(it->first)) {
+            pruned.rules += it->second.size();
+            it = grammar.g_.erase(it);
+            continue;
+        }
+        pruned.rules += std::erase_if(it->second, [&](const production& prod) {
+            return std::any_of(prod.begin(), prod.end(),
+                               [&](const std::string& symbol) {
+                                   return useless.contains(symbol);
+                               });
+        });
+        ++it;
+    }
+    std::erase_if(grammar.order, [&](const std::string& nt) {
+        return useless.contains(nt);
+    });
+    for (const std::string& nt : useless) {
+        grammar.st_.st_.erase(nt);
+        grammar.st_.non_terminals_.erase(nt);
+    }
+    return pruned;
+}
+
+bool GrammarFactory::HasDirectLeftRecursion(Grammar& grammar) {
+    for (const auto& [nt, productions] : grammar.g_) {
+        for (const production& prod : productions) {
+            if (prod[0] == nt) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void GrammarFactory::RemoveLeftRecursion(Grammar& grammar) {
+    fresh_.clear();
+    const std::vector<std::string> non_terminals = NonTerminals(grammar);
+    std::unordered_map<std::string, unsigned> id;
+    for (unsigned i = 0; i < non_terminals.size(); ++i) {
+        id[non_terminals[i]] = i;
+    }
+    // A -> B ... is an edge A -> B of the left-corner graph. Only the
+    // non-terminals of a cycle of it are left recursive
+    graph::Adjacency left(non_terminals.size());
+    for (unsigned i = 0; i < non_terminals.size(); ++i) {
+        for (const production& prod : grammar.g_.at(non_terminals[i])) {
+            if (auto it = id.find(prod[0]); it != id.end()) {
+                left[i].push_back(it->second);
+            }
+        }
+    }
+    unsigned                           count = 0;
+    const std::vector<unsigned>        comp  = graph::Components(left, count);
+    std::vector<std::vector<unsigned>> members(count);
+    for (unsigned i = 0; i < non_terminals.size(); ++i) {
+        members[comp[i]].push_back(i);
+    }
+
+    const std::string& eps = grammar.st_.EPSILON_;
+    NewNonTerminals    added;
+    // A -> A a | b  =>  A -> b A'; A' -> a A' | EPSILON
+    auto remove_direct = [&](const std::string& nt) {
+        std::vector<production> recursive;
+        std::vector<production> rest;
+        for (production& prod : grammar.g_.at(nt)) {
+            if (prod[0] == nt) {
+                recursive.emplace_back(prod.begin() + 1, prod.end());
+            } else {
+                rest.push_back(std::move(prod));
+            }
+        }
+        if (recursive.empty()) {
+            grammar.g_[nt] = std::move(rest);
+            return;
+        }
+        const std::string new_nt = GenerateNewNonTerminal(grammar, nt);
+        grammar.st_.PutSymbol(new_nt);
+        grammar.st_.terminals_.insert(eps);
+        added[nt].push_back(new_nt);
+        std::vector<production> productions;
+        for (production& prod : rest) {
+            if (prod[0] == eps) {
+                prod.clear();
+            }
+            prod.push_back(new_nt);
+            productions.push_back(std::move(prod));
+        }
+        if (productions.empty()) {
+            productions.push_back({new_nt});
+        }
+        grammar.g_[nt] = std::move(productions);
+        std::vector<production> tail;
+        for (production& prod : recursive) {
+            if (prod.empty()) {
+                continue; // A -> A
+            }
+            prod.push_back(new_nt);
+            tail.push_back(std::move(prod));
+        }
+        tail.push_back({eps});
+        grammar.g_[new_nt] = std::move(tail);
+    };
+
+    for (const std::vector<unsigned>& component : members) {
+        const unsigned first = component[0];
+        if (component.size() == 1 &&
+            std::find(left[first].begin(), left[first].end(), first) ==
+                left[first].end()) {
+            continue;
+        }
+        // Order the component as in the grammar. A rule of the k-th member
+        // that starts with an earlier member is replaced by that member's
+        // rules, which are already free of left recursion, until every rule
+        // starts with a terminal or a later member
+        std::unordered_map<std::string, size_t> position;
+        for (size_t k = 0; k < component.size(); ++k) {
+            position[non_terminals[component[k]]] = k;
+        }
+        for (size_t k = 0; k < component.size(); ++k) {
+            const std::string&      nt = non_terminals[component[k]];
+            std::vector<production> stack(grammar.g_.at(nt).rbegin(),
+                                          grammar.g_.at(nt).rend());
+            std::vector<production> rules;
+            ProductionSet           seen;
+            while (!stack.empty()) {
+                production prod = std::move(stack.back());
+                stack.pop_back();
+                auto earlier = position.find(prod[0]);
+                if (earlier == position.end() || earlier->second >= k) {
+                    if (seen.insert(prod).second) {
+                        rules.push_back(std::move(prod));
+                    }
+                    continue;
+                }
+                const std::vector<production>& expansions =
+                    grammar.g_.at(prod[0]);
+                for (auto it = expansions.rbegin(); it != expansions.rend();
+                     ++it) {
+                    production expanded;
+                    if ((*it)[0] != eps) {
+                        expanded = *it;
+                    }
+                    expanded.insert(expanded.end(), prod.begin() + 1,
+                                    prod.end());
+                    if (expanded.empty()) {
+                        expanded.push_back(eps);
+                    }
+                    stack.push_back(std::move(expanded));
+                }
+            }
+            grammar.g_[nt] = std::move(rules);
+            remove_direct(nt);
+        }
+    }
+    PlaceNewNonTerminals(grammar, added);
+}
+
+void GrammarFactory::RemoveUnitRules(Grammar& grammar) {
+    const std::vector<std::string> non_terminals = NonTerminals(grammar);
+    std::unordered_map<std::string, unsigned> id;
+    for (unsigned i = 0; i < non_terminals.size(); ++i) {
+        id[non_terminals[i]] = i;
+    }
+    auto unit_target = [&](const production& prod) -> const unsigned* {
+        if (prod.size() != 1) {
+            return nullptr;
+        }
+        auto it = id.find(prod[0]);
+        return it == id.end() ? nullptr : &it->second;
+    };
+    graph::Adjacency unit(non_terminals.size());
+    for (unsigned i = 0; i < non_terminals.size(); ++i) {
+        for (const production& prod : grammar.g_.at(non_terminals[i])) {
+            if (const unsigned* target = unit_target(prod)) {
+                unit[i].push_back(*target);
+            }
+        }
+    }
+
+    // The non-terminals of a cycle of unit rules derive each other, so they
+    // are merged into one: the axiom, or the first one in the grammar
+    unsigned                           count = 0;
+    const std::vector<unsigned>        comp  = graph::Components(unit, count);
+    std::vector<std::vector<unsigned>> members(count);
+    for (unsigned i = 0; i < non_terminals.size(); ++i) {
+        members[comp[i]].push_back(i);
+    }
+    std::vector<unsigned> representative(count);
+    for (unsigned c = 0; c < count; ++c) {
+        representative[c] = members[c][0];
+        for (unsigned i : members[c]) {
+            if (non_terminals[i] == grammar.axiom_) {
+                representative[c] = i;
+            }
+        }
+    }
+    auto rename = [&](production prod) {
+        for (std::string& symbol : prod) {
+            if (auto it = id.find(symbol); it != id.end()) {
+                symbol = non_terminals[representative[comp[it->second]]];
+            }
+        }
+        return prod;
+    };
+
+    // A component takes the other rules of the components it reaches
+    // through unit rules, which have smaller numbers and are done first
+    std::vector<std::vector<production>> rules(count);
+    for (unsigned c = 0; c < count; ++c) {
+        ProductionSet seen;
+        auto          add = [&](const production& prod) {
+            if (seen.insert(prod).second) {
+                rules[c].push_back(prod);
+            }
+        };
+        for (unsigned i : members[c]) {
+            for (const production& prod : grammar.g_.at(non_terminals[i])) {
+                if (const unsigned* target = unit_target(prod)) {
+                    if (comp[*target] != c) {
+                        std::for_each(rules[comp[*target]].begin(),
+                                      rules[comp[*target]].end(), add);
+                    }
+                } else {
+                    add(rename(prod));
+                }
+            }
+        }
+    }
+    std::unordered_map<std::string, std::vector<production>> result;
+    for (unsigned c = 0; c < count; ++c) {
+        result[non_terminals[representative[c]]] = std::move(rules[c]);
+    }
+    grammar.g_ = std::move(result);
+
+    // Remove the non-terminals that were merged or are no longer reachable
+    std::unordered_set<std::string> reachable{grammar.axiom_};
+    std::queue<std::string>         pending;
+    pending.push(grammar.axiom_);
+    while (!pending.empty()) {
+        const std::string nt = pending.front();
+        pending.pop();
+        for (const production& prod : grammar.g_.at(nt)) {
+            for (const std::string& symbol : prod) {
+                if (grammar.g_.contains(symbol) &&
+                    reachable.insert(symbol).second) {
+                    pending.push(symbol);
+                }
+            }
+        }
+    }
+    std::erase_if(grammar.g_, [&](const auto& entry) {
+        return !reachable.contains(entry.first);
+    });
+    std::erase_if(grammar.order, [&](const std::string& nt) {
+        return !reachable.contains(nt);
+    });
+    for (auto it = grammar.st_.non_terminals_.begin();
+         it != grammar.st_.non_terminals_.end();) {
+        if (!reachable.contains(*it)) {
+            grammar.st_.st_.erase(*it);
+            it = grammar.st_.non_terminals_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void GrammarFactory::LeftFactorize(Grammar& grammar) {
+    fresh_.clear();
+    const std::string& eps = grammar.st_.EPSILON_;
+    NewNonTerminals    added;
+
+    // Trie of the productions of a non-terminal. Children keep the order in
+    // which the productions first use them
+    struct Node {
+        std::vector<std::pair<std::string, unsigned>> children;
+        std::unordered_map<std::string, unsigned>     index;
+        bool                                          end = false;
+    };
+    std::vector<Node> trie;
+    for (const std::string& nt : NonTerminals(grammar)) {
+        trie.assign(1, Node{});
+        for (const production& prod : grammar.g_.at(nt)) {
+            unsigned node = 0;
+            for (const std::string& symbol : prod) {
+                auto [it, inserted] =
+                    trie[node].index.try_emplace(symbol, trie.size());
+                if (inserted) {
+                    trie[node].children.emplace_back(symbol, it->second);
+                    trie.emplace_back();
+                }
+                node = it->second;
+            }
+            trie[node].end = true;
+        }
+        if (trie[0].children.size() == grammar.g_.at(nt).size()) {
+            continue; // no two productions share a first symbol
+        }
+
+        // A path of the trie without branches is a common prefix. A branch
+        // below the root becomes a new non-terminal with the suffixes
+        // A -> a x | a y  =>  A -> a A'; A' -> x | y
+        std::vector<std::pair<unsigned, std::string>> pending{{0, nt}};
+        while (!pending.empty()) {
+            const auto [node, lhs] = std::move(pending.back());
+            pending.pop_back();
+            std::vector<production> rules;
+            for (const auto& [symbol, child] : trie[node].children) {
+                production prefix{symbol};
+                unsigned   end = child;
+                while (!trie[end].end && trie[end].children.size() == 1) {
+                    prefix.push_back(trie[end].children[0].first);
+                    end = trie[end].children[0].second;
+                }
+                if (!trie[end].children.empty()) {
+                    const std::string new_nt =
+                        GenerateNewNonTerminal(grammar, nt);
+                    grammar.st_.PutSymbol(new_nt);
+                    added[nt].push_back(new_nt);
+                    prefix.push_back(new_nt);
+                    pending.emplace_back(end, new_nt);
+                }
+                rules.push_back(std::move(prefix));
+            }
+            if (node != 0 && trie[node].end) {
+                grammar.st_.terminals_.insert(eps);
+                rules.push_back({eps});
+            }
+            grammar.g_[lhs] = std::move(rules);
+        }
+    }
+    PlaceNewNonTerminals(grammar, added);
+}
+
+std::vector<std::string> GrammarFactory::LongestCommonPrefix(
+    const std::vector<production>& productions) {
+    if (productions.empty()) {
+        return {};
+    }
+    std::vector<std::string> prefix(productions[0]);
+    for (const production& prod : productions) {
+        size_t i = 0;
+        while (i < prefix.size() && i < prod.size() && prefix[i] == prod[i]) {
+            ++i;
+        }
+        prefix.resize(i);
+    }
+    return prefix;
+}
+
+bool GrammarFactory::StartsWith(const production&               prod,
+                                const std::vector<std::string>& prefix) {
+    return prefix.size() <= prod.size() &&
+           std::equal(prefix.begin(), prefix.end(), prod.begin());
+}
+
+std::string GrammarFactory::GenerateNewNonTerminal(Grammar&           grammar,
+                                                   const std::string& base) {
+    std::string nt = base + "'";
+    if (!grammar.st_.In(nt)) {
+        return nt;
+    }
+    // Numbered names continue where the last one for this base stopped
+    unsigned& next = fresh_.try_emplace(base, 2).first->second;
+    do {
+        nt = base + "'" + std::to_string(next++);
+    } while (grammar.st_.In(nt));
+    return nt;
+}
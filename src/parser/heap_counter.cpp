@@ -0,0 +1,142 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "../../include/stats.hpp"
+
+// The replaceable allocation functions of the program, which count every heap
+// allocation in `stats::heap_slots` while `stats::heap_enabled` is set. They
+// are kept apart from the rest of `stats` so that no caller of `operator new`
+// is compiled with the `free` of these `operator delete` inlined into it, and
+// so that only the programs that report allocations replace them.
+
+namespace {
+
+std::atomic<std::size_t> next_slot{0};
+
+void Count(std::size_t size) {
+    if (!stats::HeapEnabled()) {
+        return;
+    }
+    // Threads take slots in turn, so the workers of a pool rarely share one
+    thread_local const std::size_t slot =
+        next_slot.fetch_add(1, std::memory_order_relaxed) % stats::kHeapSlots;
+    stats::heap_slots[slot].allocations.fetch_add(1,
+                                                  std::memory_order_relaxed);
+    stats::heap_slots[slot].bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void* Allocate(std::size_t size) noexcept {
+    Count(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* Allocate(std::size_t size, std::align_val_t alignment) noexcept {
+    Count(size);
+    // aligned_alloc needs a size that is a non-zero multiple of the alignment
+    const auto align = static_cast<std::size_t>(alignment);
+    return std::aligned_alloc(
+        align, size == 0 ? align : (size + align - 1) / align * align);
+}
+
+} // namespace
+
+// Every form is defined, so that all of them allocate with malloc or
+// aligned_alloc and free with free
+
+void* operator new(std::size_t size) {
+    if (void* p = Allocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = Allocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = Allocate(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* p = Allocate(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+    return Allocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+    return Allocate(size, alignment);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+    std::free(p);
+}
@@ -6,8 +6,10 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "../../include/first_follow.hpp"
 #include "../../include/grammar.hpp"
 #include "../../include/ll1_parser.hpp"
+#include "../../include/stats.hpp"
 #include "../../include/symbol_table.hpp"
 #include "../../include/tabulate.hpp"
 
@@ -16,7 +18,15 @@ LL1Parser::LL1Parser(Grammar gr) : gr_(std::move(gr)) {
     ComputeFollowSets();
 }
 
+LL1Parser::LL1Parser(
+    Grammar                                                          gr,
+    std::unordered_map<std::string, std::unordered_set<std::string>> first_sets)
+    : gr_(std::move(gr)), first_sets_(std::move(first_sets)) {
+    ComputeFollowSets();
+}
+
 bool LL1Parser::CreateLL1Table() {
+    stats::ScopedTimer timer(stats::Phase::LL1Table);
     if (first_sets_.empty() || follow_sets_.empty()) {
         ComputeFirstSets();
         ComputeFollowSets();
@@ -25,24 +35,138 @@ bool LL1Parser::CreateLL1Table() {
     ll1_t_.reserve(nrows);
     bool has_conflict{false};
     for (const auto& rule : gr_.g_) {
-        std::unordered_map<std::string, std::vector<production>> column;
-        for (const production& p : rule.second) {
-            std::unordered_set<std::string> ds =
-                PredictionSymbols(rule.first, p);
-            column.reserve(ds.size());
-            for (const std::string& symbol : ds) {
-                auto& cell = column[symbol];
-                if (!cell.empty()) {
-                    has_conflict = true;
-                }
-                cell.push_back(p);
+        has_conflict |= !BuildRow(rule.first);
+    }
+    BuildCompressedTable();
+    return !has_conflict;
+}
+
+bool LL1Parser::BuildRow(const std::string& non_terminal) {
+    std::unordered_map<std::string, std::vector<production>> column;
+    bool has_conflict{false};
+    for (const production& p : gr_.g_.at(non_terminal)) {
+        std::unordered_set<std::string> ds = PredictionSymbols(non_terminal, p);
+        column.reserve(ds.size());
+        for (const std::string& symbol : ds) {
+            auto& cell = column[symbol];
+            if (!cell.empty()) {
+                has_conflict = true;
             }
+            cell.push_back(p);
         }
-        ll1_t_.insert({rule.first, column});
     }
+    ll1_t_[non_terminal] = std::move(column);
     return !has_conflict;
 }
 
+bool LL1Parser::AddRule(const std::string& antecedent,
+                        const production&  consequent) {
+    return EditRules({{true, antecedent, consequent}});
+}
+
+bool LL1Parser::RemoveRule(const std::string& antecedent,
+                           const production&  consequent) {
+    return EditRules({{false, antecedent, consequent}});
+}
+
+bool LL1Parser::EditRules(const std::vector<RuleEdit>& edits) {
+    std::unordered_set<std::string> stale;
+    std::unordered_set<std::string> first_changed;
+    bool                            accepted = true;
+    for (const RuleEdit& edit : edits) {
+        if (!gr_.Apply(edit)) {
+            accepted = false;
+            break;
+        }
+        const first_follow::Changes changes = first_follow::Update(
+            gr_, edit.antecedent, edit.consequent, first_sets_, follow_sets_);
+        stale.insert(edit.antecedent);
+        stale.insert(changes.follow.begin(), changes.follow.end());
+        first_changed.insert(changes.first.begin(), changes.first.end());
+    }
+    if (!first_changed.empty()) {
+        for (const auto& [nt, productions] : gr_.g_) {
+            for (const production& prod : productions) {
+                if (std::any_of(prod.begin(), prod.end(),
+                                [&](const std::string& symbol) {
+                                    return first_changed.contains(symbol);
+                                })) {
+                    stale.insert(nt);
+                    break;
+                }
+            }
+        }
+    }
+    for (const std::string& nt : stale) {
+        if (gr_.g_.contains(nt)) {
+            BuildRow(nt);
+        } else {
+            ll1_t_.erase(nt);
+        }
+    }
+    // Symbol and rule ids may have moved, so the compressed table is built
+    // again only when it is needed
+    compressed_stale_ = true;
+    return accepted;
+}
+
+bool LL1Parser::IsLL1() const {
+    for (const auto& [nt, row] : ll1_t_) {
+        for (const auto& [symbol, prods] : row) {
+            if (prods.size() > 1) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void LL1Parser::BuildCompressedTable() {
+    index_ = SymbolIndex(gr_);
+    const unsigned   rows = index_.non_terminals_.size();
+    const unsigned   cols = index_.terminals_.size();
+    std::vector<int> dense(static_cast<size_t>(rows) * cols, -1);
+
+    for (const auto& [nt, row] : ll1_t_) {
+        const int r = index_.NonTerminalId(nt);
+        for (const auto& [symbol, prods] : row) {
+            const int c = index_.TerminalId(symbol);
+            if (r < 0 || c < 0 || prods.empty()) {
+                continue;
+            }
+            dense[r * cols + c] =
+                prods.size() > 1 ? kConflict : index_.RuleId(nt, prods[0]);
+        }
+    }
+    compressed_       = ClassTable(dense, rows, cols);
+    compressed_stale_ = false;
+}
+
+void LL1Parser::DebugTableStats() {
+    if (compressed_stale_) {
+        BuildCompressedTable();
+    }
+    const ClassTable& t = compressed_;
+    if (t.n_rows_ == 0) {
+        std::cout << "No LL(1) table was built.\n";
+        return;
+    }
+    const size_t dense_bytes =
+        static_cast<size_t>(t.n_rows_) * t.n_cols_ * sizeof(int);
+
+    tabulate::Table table;
+    table.add_row({"Representation", "Rows", "Columns", "Bytes"});
+    table.add_row({"Dense array", std::to_string(t.n_rows_),
+                   std::to_string(t.n_cols_), std::to_string(dense_bytes)});
+    table.add_row({"Equivalence classes", std::to_string(t.n_row_classes_),
+                   std::to_string(t.n_col_classes_),
+                   std::to_string(t.Bytes())});
+    table.format().font_align(tabulate::FontAlign::center);
+    table.column(0).format().font_color(tabulate::Color::cyan);
+    table.row(0).format().font_color(tabulate::Color::magenta);
+    std::cout << table << std::endl;
+}
+
 void LL1Parser::First(std::span<const std::string>     rule,
                       std::unordered_set<std::string>& result) {
     if (rule.empty() || (rule.size() == 1 && rule[0] == gr_.st_.EPSILON_)) {
@@ -83,6 +207,7 @@ void LL1Parser::First(std::span<const std::string>     rule,
 
 // Least fixed point
 void LL1Parser::ComputeFirstSets() {
+    stats::ScopedTimer timer(stats::Phase::First);
     // Init all FIRST to empty
     for (const auto& [nonTerminal, _] : gr_.g_) {
         first_sets_[nonTerminal] = {};
@@ -90,6 +215,7 @@ void LL1Parser::ComputeFirstSets() {
 
     bool changed;
     do {
+        stats::AddIterations(stats::Phase::First);
         auto old_first_sets = first_sets_; // Copy current state
 
         for (const auto& [nonTerminal, productions] : gr_.g_) {
@@ -114,6 +240,7 @@ void LL1Parser::ComputeFirstSets() {
 }
 
 void LL1Parser::ComputeFollowSets() {
+    stats::ScopedTimer timer(stats::Phase::Follow);
     for (const auto& [nt, _] : gr_.g_) {
         follow_sets_[nt] = {};
     }
@@ -121,6 +248,7 @@ void LL1Parser::ComputeFollowSets() {
 
     bool changed;
     do {
+        stats::AddIterations(stats::Phase::Follow);
         changed = false;
         for (const auto& rule : gr_.g_) {
             const std::string& lhs = rule.first;
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "../../include/lr_table.hpp"
+#include "../../include/trace.hpp"
+
+namespace {
+
+/**
+ * Columns of row `r` whose values are significant, that is, different from
+ * `omit` and from `empty`.
+ */
+std::vector<unsigned> Significant(const std::vector<int>& dense, unsigned r,
+                                  unsigned cols, int omit, int empty) {
+    std::vector<unsigned> cells;
+    for (unsigned c = 0; c < cols; ++c) {
+        const int v = dense[r * cols + c];
+        if (v != omit && v != empty) {
+            cells.push_back(c);
+        }
+    }
+    return cells;
+}
+
+/**
+ * Places the significant `cells` of row `r` at the lowest base where all of
+ * them land on free slots of `check`, growing `next` and `check` if needed.
+ * `first_free` is the lowest slot that may be free, and is advanced.
+ */
+int PlaceRow(const std::vector<int>& dense, unsigned r, unsigned cols,
+             const std::vector<unsigned>& cells, int empty,
+             size_t& first_free, std::vector<int>& next,
+             std::vector<int>& check) {
+    while (first_free < check.size() && check[first_free] != -1) {
+        ++first_free;
+    }
+    size_t b = first_free > cells[0] ? first_free - cells[0] : 0;
+    for (;; ++b) {
+        if (check.size() < b + cols) {
+            check.resize(b + cols, -1);
+            next.resize(b + cols, empty);
+        }
+        const bool fits =
+            std::all_of(cells.begin(), cells.end(),
+                        [&](unsigned c) { return check[b + c] == -1; });
+        if (fits) {
+            break;
+        }
+    }
+    for (unsigned c : cells) {
+        check[b + c] = static_cast<int>(r);
+        next[b + c]  = dense[r * cols + c];
+    }
+    return static_cast<int>(b);
+}
+
+/**
+ * First-fit row displacement. Every row is placed at the lowest base where all
+ * of its significant cells land on free slots of `check`. Denser rows are
+ * placed first since they are the hardest to fit. Values equal to `omit[row]`
+ * are not significant and are left out of the packed row.
+ */
+void PackRows(const std::vector<int>& dense, unsigned rows, unsigned cols,
+              const std::vector<int>& omit, int empty,
+              std::vector<int>& base, std::vector<int>& next,
+              std::vector<int>& check) {
+    std::vector<std::vector<unsigned>> significant(rows);
+    for (unsigned r = 0; r < rows; ++r) {
+        significant[r] = Significant(dense, r, cols, omit[r], empty);
+    }
+
+    std::vector<unsigned> order(rows);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+        return significant[a].size() > significant[b].size();
+    });
+
+    base.assign(rows, 0);
+    check.assign(cols, -1);
+    next.assign(cols, empty);
+    size_t first_free = 0;
+    for (unsigned r : order) {
+        if (!significant[r].empty()) {
+            base[r] = PlaceRow(dense, r, cols, significant[r], empty,
+                               first_free, next, check);
+        }
+    }
+}
+
+/**
+ * Frees the slots of `next` and `check` owned by row `r`.
+ */
+void ReleaseRow(unsigned r, int base, unsigned cols, int empty,
+                std::vector<int>& next, std::vector<int>& check) {
+    for (unsigned c = 0; c < cols; ++c) {
+        const size_t i = base + c;
+        if (i < check.size() && check[i] == static_cast<int>(r)) {
+            check[i] = -1;
+            next[i]  = empty;
+        }
+    }
+}
+
+/**
+ * The most frequent reduction of a row, or `kError` if it has none or has
+ * explicit errors.
+ */
+int DefaultReduction(const LRTable& table, unsigned s) {
+    if (s < table.no_default_.size() && table.no_default_[s]) {
+        return LRTable::kError;
+    }
+    std::unordered_map<int, unsigned> count;
+    unsigned                          best   = 0;
+    int                               action = LRTable::kError;
+    for (unsigned t = 0; t < table.n_terminals_; ++t) {
+        const int a = table.DenseAction(s, t);
+        if (LRTable::IsReduce(a) && ++count[a] > best) {
+            best   = count[a];
+            action = a;
+        }
+    }
+    return action;
+}
+
+template <typename T> size_t VectorBytes(const std::vector<T>& v) {
+    return v.size() * sizeof(T);
+}
+
+} // namespace
+
+LRTable::LRTable(unsigned n_states, unsigned n_terminals,
+                 unsigned n_non_terminals)
+    : n_states_(n_states), n_terminals_(n_terminals),
+      n_non_terminals_(n_non_terminals),
+      action_(static_cast<size_t>(n_states) * n_terminals, kError),
+      goto_(static_cast<size_t>(n_states) * n_non_terminals, -1),
+      no_default_(n_states, 0) {}
+
+void LRTable::Compress() {
+    // Default reductions: the most frequent reduction of every row
+    default_.assign(n_states_, kError);
+    for (unsigned s = 0; s < n_states_; ++s) {
+        default_[s] = DefaultReduction(*this, s);
+    }
+
+    PackRows(action_, n_states_, n_terminals_, default_, kError, action_base_,
+             action_next_, action_check_);
+    const std::vector<int> no_default(n_states_, -1);
+    PackRows(goto_, n_states_, n_non_terminals_, no_default, -1, goto_base_,
+             goto_next_, goto_check_);
+
+    action_classes_ = ClassTable(action_, n_states_, n_terminals_);
+    goto_classes_   = ClassTable(goto_, n_states_, n_non_terminals_);
+}
+
+void LRTable::Resize(unsigned n_states) {
+    n_states_ = n_states;
+    action_.resize(static_cast<size_t>(n_states) * n_terminals_, kError);
+    goto_.resize(static_cast<size_t>(n_states) * n_non_terminals_, -1);
+    no_default_.resize(n_states, 0);
+}
+
+void LRTable::PatchRows(const std::vector<unsigned>& rows) {
+    // Rows past the end and the changed ones leave their slots first
+    const unsigned packed = action_base_.size();
+    for (unsigned r = n_states_; r < packed; ++r) {
+        ReleaseRow(r, action_base_[r], n_terminals_, kError, action_next_,
+                   action_check_);
+        ReleaseRow(r, goto_base_[r], n_non_terminals_, -1, goto_next_,
+                   goto_check_);
+    }
+    for (unsigned r : rows) {
+        if (r < packed) {
+            ReleaseRow(r, action_base_[r], n_terminals_, kError, action_next_,
+                       action_check_);
+            ReleaseRow(r, goto_base_[r], n_non_terminals_, -1, goto_next_,
+                       goto_check_);
+        }
+    }
+    default_.resize(n_states_, kError);
+    action_base_.resize(n_states_, 0);
+    goto_base_.resize(n_states_, 0);
+
+    size_t action_free = 0;
+    size_t goto_free   = 0;
+    for (unsigned r : rows) {
+        default_[r] = DefaultReduction(*this, r);
+        const std::vector<unsigned> actions =
+            Significant(action_, r, n_terminals_, default_[r], kError);
+        action_base_[r] =
+            actions.empty() ? 0
+                            : PlaceRow(action_, r, n_terminals_, actions,
+                                       kError, action_free, action_next_,
+                                       action_check_);
+        const std::vector<unsigned> gotos =
+            Significant(goto_, r, n_non_terminals_, -1, -1);
+        goto_base_[r] = gotos.empty()
+                            ? 0
+                            : PlaceRow(goto_, r, n_non_terminals_, gotos, -1,
+                                       goto_free, goto_next_, goto_check_);
+    }
+
+    action_classes_.PatchRows(action_, n_states_, rows);
+    goto_classes_.PatchRows(goto_, n_states_, rows);
+}
+
+size_t LRTable::BypassUnitRules(const std::vector<char>& unit) {
+    // The unit rule reduced by every action of a state without gotos
+    std::vector<int> only(n_states_, -1);
+    for (unsigned s = 0; s < n_states_; ++s) {
+        int  rule = -1;
+        bool pure = true;
+        for (unsigned t = 0; t < n_terminals_ && pure; ++t) {
+            const int a = DenseAction(s, t);
+            if (a == kError) {
+                continue;
+            }
+            pure = IsReduce(a) && unit[Rule(a)] &&
+                   (rule < 0 || rule == static_cast<int>(Rule(a)));
+            rule = static_cast<int>(Rule(a));
+        }
+        for (unsigned nt = 0; nt < n_non_terminals_ && pure; ++nt) {
+            pure = DenseGoto(s, nt) < 0;
+        }
+        if (pure) {
+            only[s] = rule;
+        }
+    }
+
+    size_t changed = 0;
+    for (unsigned s = 0; s < n_states_; ++s) {
+        for (unsigned nt = 0; nt < n_non_terminals_; ++nt) {
+            int& cell = goto_[s * n_non_terminals_ + nt];
+            int  to   = cell;
+            // A chain is at most as long as the number of states
+            for (unsigned steps = 0;
+                 to >= 0 && only[to] >= 0 && steps < n_states_; ++steps) {
+                const int next = DenseGoto(s, rule_lhs_[only[to]]);
+                if (next < 0) {
+                    break;
+                }
+                to = next;
+            }
+            if (to != cell) {
+                cell = to;
+                ++changed;
+            }
+        }
+    }
+    return changed;
+}
+
+bool LRTable::Parse(std::span<const int> tokens, ParseStats* stats) const {
+    const trace::Scope trace("Parse", tokens.size());
+    // The stack of a parse starts in a local buffer and grows into blocks
+    // released together on return
+    std::byte                           buffer[4096];
+    std::pmr::monotonic_buffer_resource memory(buffer, sizeof buffer);
+    std::pmr::vector<unsigned>          stack(1, 0, &memory);
+    size_t                pos = 0;
+    const size_t          n   = tokens.size();
+
+    while (true) {
+        const int tok = pos < n ? tokens[pos] : 0;
+        const int a   = Action(stack.back(), tok);
+        if (a == kAccept) {
+            return pos >= n || (pos == n - 1 && tok == 0);
+        }
+        if (IsShift(a)) {
+            if (pos >= n) {
+                return false;
+            }
+            stack.push_back(Target(a));
+            ++pos;
+            if (stats) {
+                ++stats->shifts;
+            }
+        } else if (IsReduce(a)) {
+            const unsigned rule = Rule(a);
+            const unsigned len  = rule_length_[rule];
+            if (len >= stack.size()) {
+                return false;
+            }
+            stack.resize(stack.size() - len);
+            const int next = Goto(stack.back(), rule_lhs_[rule]);
+            if (next < 0) {
+                return false;
+            }
+            stack.push_back(static_cast<unsigned>(next));
+            if (stats) {
+                ++stats->reductions;
+            }
+        } else {
+            return false;
+        }
+    }
+}
+
+size_t LRTable::DenseBytes() const {
+    return VectorBytes(action_) + VectorBytes(goto_);
+}
+
+size_t LRTable::PackedBytes() const {
+    return VectorBytes(action_base_) + VectorBytes(action_next_) +
+           VectorBytes(action_check_) + VectorBytes(default_) +
+           VectorBytes(goto_base_) + VectorBytes(goto_next_) +
+           VectorBytes(goto_check_) + VectorBytes(rule_lhs_) +
+           VectorBytes(rule_length_);
+}
+
+size_t LRTable::ClassBytes() const {
+    return action_classes_.Bytes() + goto_classes_.Bytes();
+}
@@ -1,22 +1,62 @@
 #include <algorithm>
+#include <chrono>
+#include <deque>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <queue>
+#include <random>
 #include <stack>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "../../include/arena.hpp"
+#include "../../include/first_follow.hpp"
 #include "../../include/grammar.hpp"
+#include "../../include/lr_table.hpp"
 #include "../../include/slr1_parser.hpp"
+#include "../../include/stats.hpp"
+#include "../../include/symbol_index.hpp"
 #include "../../include/symbol_table.hpp"
 #include "../../include/tabulate.hpp"
+#include "../../include/thread_pool.hpp"
+#include "../../include/trace.hpp"
+
+namespace {
+
+using ItemSet = std::unordered_set<Lr0Item>;
+
+/// Whether an item is in the kernel of the states that have it: its dot was
+/// moved over a symbol, so it is not added by a closure.
+bool IsKernel(const Lr0Item& item) {
+    return item.dot_ > 0 && !(item.consequent_.size() == 1 &&
+                              item.consequent_[0] == item.epsilon_);
+}
+
+} // namespace
 
 SLR1Parser::SLR1Parser(Grammar gr) : gr_(std::move(gr)) {
     ComputeFirstSets();
     ComputeFollowSets();
 }
 
+SLR1Parser::SLR1Parser(
+    Grammar                                                          gr,
+    std::unordered_map<std::string, std::unordered_set<std::string>> first_sets)
+    : gr_(std::move(gr)), first_sets_(std::move(first_sets)),
+      sets_given_(true) {
+    ComputeFollowSets();
+}
+
 std::unordered_set<Lr0Item> SLR1Parser::AllItems() const {
     std::unordered_set<Lr0Item> items;
     for (const auto& rule : gr_.g_) {
@@ -170,125 +210,899 @@ void SLR1Parser::MakeInitialState() {
 }
 
 bool SLR1Parser::SolveLRConflicts(const state& st) {
+    return ActionRow(st, actions_[st.id_]).empty();
+}
+
+std::vector<SLR1Parser::Conflict> SLR1Parser::Conflicts() const {
+    std::vector<Conflict> all;
+    for (const auto& [st, found] : conflicts_) {
+        all.insert(all.end(), found.begin(), found.end());
+    }
+    return all;
+}
+
+size_t SLR1Parser::ConflictCount() const {
+    size_t count = 0;
+    for (const auto& [st, found] : conflicts_) {
+        count += found.size();
+    }
+    return count;
+}
+
+std::vector<SLR1Parser::Conflict>
+SLR1Parser::ActionRow(const state& st, action_table::mapped_type& row,
+                      const std::unordered_set<std::string>* only) {
+    // Items that shift (or accept) and items that reduce on every terminal.
+    // Symbols are views of the items, of follow_sets_ and of only
+    using Items = std::pmr::vector<const Lr0Item*>;
+    std::pmr::map<std::string_view, std::pair<Items, Items>> cells(
+        arena::Current());
+    auto wanted = [&](const std::string& symbol) {
+        return only == nullptr || only->contains(symbol);
+    };
     for (const Lr0Item& item : st.items_) {
-        if (item.IsComplete()) {
+        if (!item.IsComplete()) {
+            // Regla 1: Si hay un terminal después del punto, hacemos SHIFT
+            const std::string& nextToDot = item.consequent_[item.dot_];
+            if (gr_.st_.IsTerminal(nextToDot) && wanted(nextToDot)) {
+                cells[nextToDot].first.push_back(&item);
+            }
+        } else if (item.antecedent_ == gr_.axiom_) {
             // Regla 3: Si el ítem es del axioma, ACCEPT en EOL
-            if (item.antecedent_ == gr_.axiom_) {
-                actions_[st.id_][gr_.st_.EOL_] = {nullptr, Action::Accept};
-            } else {
-                // Regla 2: Si el ítem es completo, REDUCE en FOLLOW(A)
-                std::unordered_set<std::string> follows =
-                    Follow(item.antecedent_);
-                for (const std::string& sym : follows) {
-                    auto it = actions_[st.id_].find(sym);
-                    if (it != actions_[st.id_].end()) {
-                        // Si ya hay un Reduce, comparar las reglas.
-                        // REDUCE/REDUCE si reglas distintas
-                        if (it->second.action == Action::Reduce) {
-                            if (!(it->second.item->antecedent_ ==
-                                      item.antecedent_ &&
-                                  it->second.item->consequent_ ==
-                                      item.consequent_)) {
-                                return false;
-                            }
-                        } else {
-                            return false; // SHIFT/REDUCE
-                        }
-                    }
-                    actions_[st.id_][sym] = {&item, Action::Reduce};
-                }
+            if (wanted(gr_.st_.EOL_)) {
+                cells[gr_.st_.EOL_].first.push_back(&item);
             }
-        } else {
-            // Regla 1: Si hay un terminal después del punto, hacemos SHIFT
-            std::string nextToDot = item.NextToDot();
-            if (gr_.st_.IsTerminal(nextToDot)) {
-                auto it = actions_[st.id_].find(nextToDot);
-                if (it != actions_[st.id_].end()) {
-                    // Si hay una acción previa, hay conflicto si es REDUCE
-                    if (it->second.action == Action::Reduce) {
-                        return false;
-                    }
-                    // Si ya hay un SHIFT en esa celda, no hay conflicto (varios
-                    // SHIFT están permitidos)
+        } else if (auto follow = follow_sets_.find(item.antecedent_);
+                   follow != follow_sets_.end()) {
+            // Regla 2: Si el ítem es completo, REDUCE en FOLLOW(A)
+            for (const std::string& sym : only ? *only : follow->second) {
+                if (only == nullptr || follow->second.contains(sym)) {
+                    cells[sym].second.push_back(&item);
                 }
-                actions_[st.id_][nextToDot] = {nullptr, Action::Shift};
             }
         }
     }
+
+    std::vector<Conflict> conflicts;
+    for (auto& [view, cell] : cells) {
+        const std::string symbol(view);
+        auto& [shifts, reduces] = cell;
+        std::sort(reduces.begin(), reduces.end(),
+                  [](const Lr0Item* a, const Lr0Item* b) {
+                      return std::tie(a->antecedent_, a->consequent_) <
+                             std::tie(b->antecedent_, b->consequent_);
+                  });
+        if (shifts.empty()) {
+            row[symbol] = {reduces.front(), Action::Reduce};
+        } else if (std::any_of(shifts.begin(), shifts.end(),
+                               [](const Lr0Item* item) {
+                                   return item->IsComplete();
+                               })) {
+            row[symbol] = {nullptr, Action::Accept};
+        } else {
+            // Varios SHIFT en la misma celda no son un conflicto
+            row[symbol] = {nullptr, Action::Shift};
+        }
+        if (reduces.empty() || (shifts.empty() && reduces.size() == 1)) {
+            continue;
+        }
+        if (reduces.size() == 1 && row[symbol].action == Action::Shift &&
+            SolveByPrecedence(symbol, *reduces.front(), row)) {
+            continue;
+        }
+        Conflict conflict{st.id_, symbol,
+                          shifts.empty() ? Conflict::Kind::ReduceReduce
+                                         : Conflict::Kind::ShiftReduce,
+                          {}};
+        std::vector<std::pair<std::string, const Lr0Item*>> sorted;
+        for (const Lr0Item* item : shifts) {
+            sorted.emplace_back(item->ToString(), item);
+        }
+        for (const Lr0Item* item : reduces) {
+            sorted.emplace_back(item->ToString(), item);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        for (const auto& [text, item] : sorted) {
+            conflict.items.push_back(*item);
+        }
+        conflicts.push_back(std::move(conflict));
+    }
+    return conflicts;
+}
+
+bool SLR1Parser::SolveByPrecedence(const std::string&         symbol,
+                                   const Lr0Item&             reduce,
+                                   action_table::mapped_type& row) const {
+    using Associativity   = Precedence::Associativity;
+    const Precedence* rule = gr_.RulePrecedence(reduce.consequent_);
+    auto              token = gr_.precedence_.find(symbol);
+    if (rule == nullptr || token == gr_.precedence_.end()) {
+        return false;
+    }
+    if (rule->level > token->second.level ||
+        (rule->level == token->second.level &&
+         token->second.associativity == Associativity::Left)) {
+        row[symbol] = {&reduce, Action::Reduce};
+    } else if (rule->level == token->second.level &&
+               token->second.associativity == Associativity::NonAssoc) {
+        // An explicit error, so that `a op b op c` is rejected
+        row[symbol] = {nullptr, Action::Empty};
+    }
+    // Otherwise the terminal binds tighter, or is right associative: shift
     return true;
 }
 
+void SLR1Parser::MakeActions() {
+    std::vector<const state*> by_id(states_.size());
+    for (const state& st : states_) {
+        by_id[st.id_] = &st;
+    }
+    // Every state gets its own row and conflict list, merged in id order
+    std::vector<action_table::mapped_type> rows(by_id.size());
+    std::vector<std::vector<Conflict>>     found(by_id.size());
+    auto solve = [&](size_t begin, size_t end) {
+        arena::Arena       scratch;
+        const arena::Scope scope(scratch);
+        for (size_t id = begin; id < end; ++id) {
+            found[id] = ActionRow(*by_id[id], rows[id]);
+        }
+    };
+    if (threads_ > 1) {
+        ThreadPool   pool(threads_);
+        const size_t chunk =
+            std::max<size_t>(1, by_id.size() / (4 * pool.Size()));
+        for (size_t begin = 0; begin < by_id.size(); begin += chunk) {
+            const size_t end = std::min(by_id.size(), begin + chunk);
+            pool.Submit([&solve, begin, end] { solve(begin, end); });
+        }
+        pool.Wait();
+    } else {
+        solve(0, by_id.size());
+    }
+
+    actions_.clear();
+    conflicts_.clear();
+    for (unsigned id = 0; id < by_id.size(); ++id) {
+        if (!rows[id].empty()) {
+            actions_.emplace_hint(actions_.end(), id, std::move(rows[id]));
+        }
+        if (!found[id].empty()) {
+            conflicts_.emplace_hint(conflicts_.end(), id, std::move(found[id]));
+        }
+    }
+}
+
 bool SLR1Parser::MakeParser() {
-    ComputeFirstSets();
-    ComputeFollowSets();
+    // Temporaries of the whole analysis, released at once on return
+    arena::Arena       session;
+    const arena::Scope scope(session);
+    if (sets_given_) {
+        // Kept from the constructor
+    } else if (threads_ > 1) {
+        first_follow::Sets sets = first_follow::Compute(gr_, threads_);
+        first_sets_             = std::move(sets.first);
+        follow_sets_            = std::move(sets.follow);
+    } else {
+        ComputeFirstSets();
+        ComputeFollowSets();
+    }
+    std::optional<stats::ScopedTimer> timer(stats::Phase::Collection);
+    state_index_ = StateIndex();
     MakeInitialState();
-    std::queue<unsigned int> pending;
-    pending.push(0);
-    unsigned int current = 0;
-    size_t       i       = 1;
+    if (threads_ > 1) {
+        MakeCollectionParallel();
+    } else {
+        MakeCollection();
+    }
+    stats::AddIterations(stats::Phase::Collection, states_.size());
+    timer.emplace(stats::Phase::Conflicts);
+    MakeActions();
+    timer.reset();
+    if (!conflicts_.empty()) {
+        return false;
+    }
+    BuildFlatTable();
+    return true;
+}
 
-    do {
-        std::unordered_set<std::string> nextSymbols;
-        current = pending.front();
-        pending.pop();
-        auto it = std::find_if(
-            states_.begin(), states_.end(),
-            [current](const state& st) -> bool { return st.id_ == current; });
-        if (it == states_.end()) {
+bool SLR1Parser::AddRule(const std::string& antecedent,
+                         const production&  consequent) {
+    return EditRules({{true, antecedent, consequent}});
+}
+
+bool SLR1Parser::RemoveRule(const std::string& antecedent,
+                            const production&  consequent) {
+    return EditRules({{false, antecedent, consequent}});
+}
+
+bool SLR1Parser::EditRules(const std::vector<RuleEdit>& edits) {
+    first_follow::Changes changes;
+    size_t                applied = 0;
+    for (; applied < edits.size(); ++applied) {
+        const RuleEdit& edit = edits[applied];
+        if (!gr_.Apply(edit)) {
             break;
         }
-        const state& qi = *it;
-        std::for_each(qi.items_.begin(), qi.items_.end(),
-                      [&](const Lr0Item& item) -> void {
-                          std::string next = item.NextToDot();
-                          if (next != gr_.st_.EPSILON_ &&
-                              next != gr_.st_.EOL_) {
-                              nextSymbols.insert(next);
-                          }
-                      });
-        for (const std::string& symbol : nextSymbols) {
-            state newState;
-            newState.id_ = i;
-            for (const auto& item : qi.items_) {
-                if (item.NextToDot() == symbol) {
-                    Lr0Item newItem = item;
-                    newItem.AdvanceDot();
-                    newState.items_.insert(newItem);
+        first_follow::Changes edit_changes = first_follow::Update(
+            gr_, edit.antecedent, edit.consequent, first_sets_, follow_sets_);
+        changes.follow.merge(edit_changes.follow);
+        changes.follow_terminals.merge(edit_changes.follow_terminals);
+    }
+    if (applied > 0) {
+        Rebuild(std::span(edits).first(applied), changes);
+    }
+    return applied == edits.size();
+}
+
+bool SLR1Parser::Rebuild(std::span<const RuleEdit>    edits,
+                         const first_follow::Changes& changes) {
+    arena::Arena       session;
+    const arena::Scope scope(session);
+    const unsigned     previous = states_.size();
+    if (state_index_.by_id.size() != previous) {
+        IndexStates();
+    }
+    std::vector<const state*>& by_id = state_index_.by_id;
+    auto& by_antecedent              = state_index_.by_antecedent;
+
+    // A state with an item of an edited antecedent expands it or moves the
+    // dot over its rules, so its closure or its successors change. The other
+    // states keep their items, and are found again by the hash of their
+    // kernel
+    std::vector<char> stale(previous);
+    for (const RuleEdit& edit : edits) {
+        if (auto states = by_antecedent.find(edit.antecedent);
+            states != by_antecedent.end()) {
+            for (const state* st : states->second) {
+                stale[st->id_] = 1;
+            }
+        }
+    }
+    auto find = [&](const ItemSet& kernel) -> const state* {
+        auto [begin, end] =
+            state_index_.by_kernel.equal_range(ItemSetHash()(kernel));
+        for (auto it = begin; it != end; ++it) {
+            const ItemSet& items = it->second->items_;
+            if (std::all_of(kernel.begin(), kernel.end(),
+                            [&](const Lr0Item& item) {
+                                return items.contains(item);
+                            }) &&
+                std::count_if(items.begin(), items.end(), IsKernel) ==
+                    static_cast<std::ptrdiff_t>(kernel.size())) {
+                return it->second;
+            }
+        }
+        return nullptr;
+    };
+
+    // Walk the automaton from the initial state, following the old
+    // transitions of the states that did not change
+    std::optional<stats::ScopedTimer> timer(stats::Phase::Collection);
+    std::vector<char>                 reached(previous);
+    std::vector<unsigned>             pending{0};
+    size_t                            rebuilt = 0;
+    reached[0] = 1;
+    while (!pending.empty()) {
+        const unsigned current = pending.back();
+        pending.pop_back();
+        if (current < previous && !stale[current]) {
+            auto row = transitions_.find(current);
+            if (row == transitions_.end()) {
+                continue;
+            }
+            for (const auto& [symbol, to] : row->second) {
+                if (!reached[to]) {
+                    reached[to] = 1;
+                    pending.push_back(to);
+                }
+            }
+            continue;
+        }
+        if (current < previous) {
+            Unindex(*by_id[current]);
+            auto    node = states_.extract(states_.find(*by_id[current]));
+            ItemSet kernel;
+            if (current == 0) {
+                kernel.insert({gr_.axiom_, gr_.g_.at(gr_.axiom_)[0],
+                               gr_.st_.EPSILON_, gr_.st_.EOL_});
+            }
+            for (const Lr0Item& item : node.value().items_) {
+                if (IsKernel(item)) {
+                    kernel.insert(item);
                 }
             }
+            Closure(kernel);
+            node.value().items_ = std::move(kernel);
+            states_.insert(std::move(node));
+            Index(*by_id[current]);
+        }
+        ++rebuilt;
+        transitions_.erase(current);
+        for (auto& [symbol, kernel] : Kernels(by_id[current]->items_)) {
+            const state* to = find(kernel);
+            if (to == nullptr) {
+                Closure(kernel);
+                to = &*states_
+                           .insert({std::move(kernel),
+                                    static_cast<unsigned>(by_id.size())})
+                           .first;
+                by_id.push_back(to);
+                Index(*to);
+                stale.push_back(1);
+                reached.push_back(0);
+            }
+            transitions_[current].emplace(symbol, to->id_);
+            if (!reached[to->id_]) {
+                reached[to->id_] = 1;
+                pending.push_back(to->id_);
+            }
+        }
+    }
+    stats::AddIterations(stats::Phase::Collection, rebuilt);
+
+    // The states that are no longer reached leave their ids to the highest
+    // ones
+    std::vector<unsigned> rename(by_id.size());
+    std::iota(rename.begin(), rename.end(), 0);
+    unsigned low  = 0;
+    unsigned high = by_id.size();
+    while (true) {
+        while (low < high && reached[low]) {
+            ++low;
+        }
+        while (high > low && !reached[high - 1]) {
+            --high;
+        }
+        if (low >= high) {
+            break;
+        }
+        rename[--high] = low++;
+    }
+    const unsigned size = std::count(reached.begin(), reached.end(), 1);
+
+    // Every predecessor of a renumbered state has its kernel items with the
+    // dot one symbol back
+    std::vector<char> patched(by_id.size());
+    for (unsigned id = size; id < by_id.size(); ++id) {
+        if (!reached[id]) {
+            continue;
+        }
+        const ItemSet& items = by_id[id]->items_;
+        Lr0Item        item  = *std::find_if(items.begin(), items.end(),
+                                             IsKernel);
+        const std::string& symbol = item.consequent_[--item.dot_];
+        for (const state* from : by_antecedent.at(item.antecedent_)) {
+            if (!reached[from->id_] || !from->items_.contains(item)) {
+                continue;
+            }
+            unsigned& to = transitions_.at(from->id_).at(symbol);
+            if (to == id) {
+                to                  = rename[id];
+                patched[from->id_] = 1;
+            }
+        }
+    }
+    for (unsigned id = 0; id < by_id.size(); ++id) {
+        if (!reached[id]) {
+            Unindex(*by_id[id]);
+            states_.erase(states_.find(*by_id[id]));
+            transitions_.erase(id);
+        } else if (rename[id] != id) {
+            auto node        = states_.extract(states_.find(*by_id[id]));
+            node.value().id_ = rename[id];
+            states_.insert(std::move(node));
+            if (auto row = transitions_.extract(id)) {
+                row.key() = rename[id];
+                transitions_.insert(std::move(row));
+            }
+        }
+    }
+    std::vector<const state*> states(size);
+    std::vector<char>         changed(size);
+    for (unsigned id = 0; id < by_id.size(); ++id) {
+        if (reached[id]) {
+            states[rename[id]]  = by_id[id];
+            changed[rename[id]] = stale[id] || rename[id] != id;
+            patched[rename[id]] = patched[id];
+        }
+    }
+    by_id = std::move(states);
+    // The other states that reduce a non-terminal whose FOLLOW changed only
+    // change on the terminals that entered or left it
+    const std::unordered_set<std::string>& terminals =
+        changes.follow_terminals;
+    std::vector<char> reduces(size);
+    for (const std::string& nt : changes.follow) {
+        if (auto holders = state_index_.reducing.find(nt);
+            holders != state_index_.reducing.end()) {
+            for (const state* st : holders->second) {
+                reduces[st->id_] = 1;
+            }
+        }
+    }
+
+    // Only the rows and conflicts of changed states are built again
+    timer.emplace(stats::Phase::Conflicts);
+    std::vector<unsigned> rows;
+    std::vector<unsigned> cells;
+    actions_.erase(actions_.lower_bound(size), actions_.end());
+    conflicts_.erase(conflicts_.lower_bound(size), conflicts_.end());
+    for (unsigned id = 0; id < size; ++id) {
+        if (changed[id] || patched[id]) {
+            rows.push_back(id);
+        } else if (reduces[id]) {
+            cells.push_back(id);
+        }
+        if (!changed[id] && !reduces[id]) {
+            continue;
+        }
+        auto&                 row = actions_[id];
+        std::vector<Conflict> found;
+        if (changed[id]) {
+            row.clear();
+            found = ActionRow(*by_id[id], row);
+        } else {
+            for (const std::string& t : terminals) {
+                row.erase(t);
+            }
+            found = ActionRow(*by_id[id], row, &terminals);
+            if (auto kept = conflicts_.find(id); kept != conflicts_.end()) {
+                std::copy_if(kept->second.begin(), kept->second.end(),
+                             std::back_inserter(found),
+                             [&](const Conflict& conflict) {
+                                 return !terminals.contains(conflict.symbol);
+                             });
+                std::sort(found.begin(), found.end(),
+                          [](const Conflict& a, const Conflict& b) {
+                              return a.symbol < b.symbol;
+                          });
+            }
+        }
+        if (row.empty()) {
+            actions_.erase(id);
+        }
+        if (found.empty()) {
+            conflicts_.erase(id);
+        } else {
+            conflicts_[id] = std::move(found);
+        }
+    }
+    timer.reset();
+    if (!conflicts_.empty()) {
+        table_ = LRTable();
+        return false;
+    }
+    PatchFlatTable(edits, std::move(rows), cells, terminals, previous);
+    return true;
+}
+
+void SLR1Parser::IndexStates() {
+    state_index_ = StateIndex();
+    state_index_.by_id.resize(states_.size());
+    for (const state& st : states_) {
+        state_index_.by_id[st.id_] = &st;
+        Index(st);
+    }
+}
+
+void SLR1Parser::Index(const state& st) {
+    size_t hash = 0;
+    for (const Lr0Item& item : st.items_) {
+        state_index_.by_antecedent[item.antecedent_].insert(&st);
+        if (item.IsComplete()) {
+            state_index_.reducing[item.antecedent_].insert(&st);
+        }
+        if (IsKernel(item)) {
+            hash ^= std::hash<Lr0Item>()(item);
+        }
+    }
+    if (st.id_ != 0) {
+        state_index_.by_kernel.emplace(hash, &st);
+    }
+}
 
-            Closure(newState.items_);
-            auto result = states_.insert(newState);
-            std::map<std::string, unsigned int> column;
+void SLR1Parser::Unindex(const state& st) {
+    size_t hash = 0;
+    for (const Lr0Item& item : st.items_) {
+        if (auto states = state_index_.by_antecedent.find(item.antecedent_);
+            states != state_index_.by_antecedent.end()) {
+            states->second.erase(&st);
+        }
+        if (auto states = state_index_.reducing.find(item.antecedent_);
+            item.IsComplete() && states != state_index_.reducing.end()) {
+            states->second.erase(&st);
+        }
+        if (IsKernel(item)) {
+            hash ^= std::hash<Lr0Item>()(item);
+        }
+    }
+    if (st.id_ == 0) {
+        return;
+    }
+    auto [begin, end] = state_index_.by_kernel.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+        if (it->second == &st) {
+            state_index_.by_kernel.erase(it);
+            return;
+        }
+    }
+}
 
+std::map<std::string, std::unordered_set<Lr0Item>>
+SLR1Parser::Kernels(const std::unordered_set<Lr0Item>& items) const {
+    std::map<std::string, std::unordered_set<Lr0Item>> kernels;
+    for (const Lr0Item& item : items) {
+        std::string next = item.NextToDot();
+        if (next != gr_.st_.EPSILON_ && next != gr_.st_.EOL_) {
+            Lr0Item advanced = item;
+            advanced.AdvanceDot();
+            kernels[next].insert(std::move(advanced));
+        }
+    }
+    return kernels;
+}
+
+std::map<std::string, std::unordered_set<Lr0Item>>
+SLR1Parser::Successors(const std::unordered_set<Lr0Item>& items) {
+    std::map<std::string, std::unordered_set<Lr0Item>> kernels = Kernels(items);
+    for (auto& [symbol, kernel] : kernels) {
+        Closure(kernel);
+    }
+    return kernels;
+}
+
+void SLR1Parser::MakeCollection() {
+    // states_ is node based, so pointers to its elements remain valid
+    std::pmr::vector<const state*> by_id({&*states_.begin()}, arena::Current());
+    std::queue<unsigned int, std::pmr::deque<unsigned int>> pending(
+        arena::Current());
+    pending.push(0);
+    // The states found while expanding a wave form the next one
+    size_t                      wave_end = 1;
+    std::int64_t                wave     = 0;
+    std::optional<trace::Scope> wave_trace;
+    wave_trace.emplace("Wave", wave);
+
+    while (!pending.empty()) {
+        const unsigned int current = pending.front();
+        pending.pop();
+        if (current >= wave_end) {
+            wave_trace.reset();
+            wave_trace.emplace("Wave", ++wave);
+            wave_end = by_id.size();
+        }
+        for (auto& [symbol, items] : Successors(by_id[current]->items_)) {
+            auto result = states_.insert({std::move(items),
+                                          static_cast<unsigned>(by_id.size())});
             if (result.second) {
-                pending.push(i);
-                if (transitions_.find(current) != transitions_.end()) {
-                    transitions_[current].insert({symbol, i});
-                } else {
-                    std::map<std::string, unsigned int> column;
-                    column.insert({symbol, i});
-                    transitions_.insert({current, column});
+                pending.push(by_id.size());
+                by_id.push_back(&*result.first);
+            }
+            transitions_[current][symbol] = result.first->id_;
+        }
+    }
+}
+
+void SLR1Parser::MakeCollectionParallel() {
+    constexpr size_t   kShards     = 64;
+    constexpr unsigned kUnassigned = std::numeric_limits<unsigned>::max();
+    struct Shard {
+        std::mutex                                         mutex;
+        std::unordered_map<ItemSet, unsigned, ItemSetHash> sets;
+    };
+    using Node = std::pair<const ItemSet, unsigned>;
+
+    // Every distinct item set found so far, with its id once assigned. Nodes
+    // of unordered_map are stable, so they are referenced by pointer
+    std::vector<Shard> shards(kShards);
+    std::vector<Node*> by_id;
+    auto               intern = [&](ItemSet&& items) -> Node* {
+        Shard&          shard = shards[ItemSetHash()(items) % kShards];
+        std::lock_guard lock(shard.mutex);
+        return &*shard.sets.try_emplace(std::move(items), kUnassigned).first;
+    };
+    by_id.push_back(intern(ItemSet(states_.begin()->items_)));
+    by_id[0]->second = 0;
+
+    ThreadPool            pool(threads_);
+    std::vector<unsigned> wave{0};
+    // Successors of every state of the wave, in symbol order
+    std::vector<std::vector<std::pair<std::string, Node*>>> edges;
+    for (std::int64_t n = 0; !wave.empty(); ++n) {
+        trace::Scope wave_trace("Wave", n);
+        edges.assign(wave.size(), {});
+        const size_t chunk = std::max<size_t>(1, wave.size() / (4 * threads_));
+        for (size_t begin = 0; begin < wave.size(); begin += chunk) {
+            const size_t end = std::min(wave.size(), begin + chunk);
+            pool.Submit([&, begin, end] {
+                arena::Arena       scratch;
+                const arena::Scope scope(scratch);
+                for (size_t k = begin; k < end; ++k) {
+                    for (auto& [symbol, items] :
+                         Successors(by_id[wave[k]]->first)) {
+                        edges[k].emplace_back(symbol, intern(std::move(items)));
+                    }
                 }
-                ++i;
-            } else {
-                if (transitions_.find(current) != transitions_.end()) {
-                    transitions_[current].insert({symbol, result.first->id_});
-                } else {
-                    std::map<std::string, unsigned int> column;
-                    column.insert({symbol, result.first->id_});
-                    transitions_.insert({current, column});
+            });
+        }
+        pool.Wait();
+
+        // Number the new states in (parent, symbol) order, as MakeCollection
+        std::vector<unsigned> next;
+        for (size_t k = 0; k < wave.size(); ++k) {
+            for (const auto& [symbol, node] : edges[k]) {
+                if (node->second == kUnassigned) {
+                    node->second = by_id.size();
+                    next.push_back(node->second);
+                    by_id.push_back(node);
                 }
+                transitions_[wave[k]][symbol] = node->second;
             }
         }
-        current++;
-    } while (!pending.empty());
-    for (const state& st : states_) {
-        if (!SolveLRConflicts(st)) {
-            return false;
+        wave = std::move(next);
+    }
+
+    states_.clear();
+    states_.reserve(by_id.size());
+    for (Shard& shard : shards) {
+        while (!shard.sets.empty()) {
+            auto node = shard.sets.extract(shard.sets.begin());
+            states_.insert({std::move(node.key()), node.mapped()});
+        }
+    }
+}
+
+void SLR1Parser::BuildFlatTable() {
+    stats::ScopedTimer timer(stats::Phase::FlatTable);
+    index_ = SymbolIndex(gr_);
+    table_ = LRTable(states_.size(), index_.terminals_.size(),
+                     index_.non_terminals_.size());
+    for (unsigned st = 0; st < states_.size(); ++st) {
+        FillFlatRow(st);
+    }
+
+    std::vector<char> unit;
+    for (const SymbolIndex::Rule& rule : index_.rules_) {
+        table_.rule_lhs_.push_back(rule.lhs_);
+        table_.rule_length_.push_back(rule.rhs_.size());
+        unit.push_back(rule.rhs_.size() == 1 &&
+                       rule.rhs_[0] >= static_cast<int>(table_.n_terminals_));
+    }
+    unit_bypasses_ = bypass_unit_rules_ ? table_.BypassUnitRules(unit) : 0;
+    table_.Compress();
+}
+
+void SLR1Parser::FillFlatRow(unsigned                               st,
+                             const std::unordered_set<std::string>* only) {
+    int* actions = &table_.action_[st * table_.n_terminals_];
+    int* gotos   = &table_.goto_[st * table_.n_non_terminals_];
+    auto row     = actions_.find(st);
+    auto fill    = [&](const std::string& symbol, const s_action& action) {
+        const int t = index_.TerminalId(symbol);
+        if (t < 0) {
+            return;
+        }
+        switch (action.action) {
+        case Action::Shift:
+            actions[t] = LRTable::Shift(transitions_.at(st).at(symbol));
+            break;
+        case Action::Reduce:
+            actions[t] = LRTable::Reduce(index_.RuleId(
+                action.item->antecedent_, action.item->consequent_));
+            break;
+        case Action::Accept:
+            actions[t] = LRTable::kAccept;
+            break;
+        case Action::Empty:
+            table_.no_default_[st] = 1;
+            break;
+        default:
+            break;
+        }
+    };
+    table_.no_default_[st] = 0;
+
+    if (only != nullptr) {
+        // Only these action cells changed, and none of the gotos
+        for (const std::string& symbol : *only) {
+            if (const int t = index_.TerminalId(symbol); t >= 0) {
+                actions[t] = LRTable::kError;
+            }
+        }
+        if (row == actions_.end()) {
+            return;
+        }
+        for (const std::string& symbol : *only) {
+            if (auto cell = row->second.find(symbol);
+                cell != row->second.end()) {
+                fill(symbol, cell->second);
+            }
+        }
+        table_.no_default_[st] = std::any_of(
+            row->second.begin(), row->second.end(), [](const auto& cell) {
+                return cell.second.action == Action::Empty;
+            });
+        return;
+    }
+
+    std::fill(actions, actions + table_.n_terminals_, LRTable::kError);
+    std::fill(gotos, gotos + table_.n_non_terminals_, -1);
+    if (row != actions_.end()) {
+        for (const auto& [symbol, action] : row->second) {
+            fill(symbol, action);
+        }
+    }
+    if (auto edges = transitions_.find(st); edges != transitions_.end()) {
+        for (const auto& [symbol, to] : edges->second) {
+            const int nt = index_.NonTerminalId(symbol);
+            if (nt >= 0) {
+                gotos[nt] = to;
+            }
         }
     }
-    return true;
+}
+
+void SLR1Parser::PatchFlatTable(
+    std::span<const RuleEdit> edits, std::vector<unsigned> rows,
+    const std::vector<unsigned>&           cells,
+    const std::unordered_set<std::string>& terminals, unsigned previous) {
+    if (bypass_unit_rules_ || table_.n_states_ != previous) {
+        BuildFlatTable();
+        return;
+    }
+    std::optional<stats::ScopedTimer> timer(stats::Phase::FlatTable);
+    // Only the last rule moves, to the id of a removed one. A non-terminal
+    // that is added or removed changes the goto columns
+    std::vector<int> moved;
+    for (const RuleEdit& edit : edits) {
+        if (edit.add ? index_.AddRule(edit.antecedent, edit.consequent) < 0
+                     : !gr_.g_.contains(edit.antecedent)) {
+            timer.reset();
+            BuildFlatTable();
+            return;
+        }
+        if (!edit.add) {
+            moved.push_back(
+                index_.RemoveRule(edit.antecedent, edit.consequent));
+        }
+    }
+    for (int r : moved) {
+        if (r < 0 || r >= static_cast<int>(index_.rules_.size())) {
+            continue;
+        }
+        const std::string& antecedent =
+            index_.non_terminals_[index_.rules_[r].lhs_];
+        auto holders = state_index_.reducing.find(antecedent);
+        if (holders == state_index_.reducing.end()) {
+            continue;
+        }
+        for (const state* st : holders->second) {
+            if (std::any_of(st->items_.begin(), st->items_.end(),
+                            [&](const Lr0Item& item) {
+                                return item.IsComplete() &&
+                                       item.antecedent_ == antecedent &&
+                                       item.consequent_ ==
+                                           index_.consequents_[r];
+                            })) {
+                rows.push_back(st->id_);
+            }
+        }
+    }
+    table_.rule_lhs_.clear();
+    table_.rule_length_.clear();
+    for (const SymbolIndex::Rule& rule : index_.rules_) {
+        table_.rule_lhs_.push_back(rule.lhs_);
+        table_.rule_length_.push_back(rule.rhs_.size());
+    }
+
+    table_.Resize(states_.size());
+    for (unsigned st : rows) {
+        FillFlatRow(st);
+    }
+    for (unsigned st : cells) {
+        FillFlatRow(st, &terminals);
+    }
+    rows.insert(rows.end(), cells.begin(), cells.end());
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    table_.PatchRows(rows);
+}
+
+size_t SLR1Parser::MapTableBytes() const {
+    // libstdc++ red-black tree node header: color + parent, left and right
+    constexpr size_t kNodeHeader = 4 * sizeof(void*);
+    constexpr size_t kSmallString = 15;
+
+    auto string_heap = [](const std::string& s) -> size_t {
+        return s.size() > kSmallString ? s.capacity() + 1 : 0;
+    };
+
+    size_t bytes = 0;
+    for (const auto& [st, row] : actions_) {
+        bytes += kNodeHeader + sizeof(*actions_.begin());
+        for (const auto& cell : row) {
+            bytes += kNodeHeader + sizeof(cell) + string_heap(cell.first);
+        }
+    }
+    for (const auto& [st, row] : transitions_) {
+        bytes += kNodeHeader + sizeof(*transitions_.begin());
+        for (const auto& cell : row) {
+            bytes += kNodeHeader + sizeof(cell) + string_heap(cell.first);
+        }
+    }
+    return bytes;
+}
+
+void SLR1Parser::DebugTableStats() {
+    if (table_.n_states_ == 0) {
+        std::cout << "No SLR(1) table was built.\n";
+        return;
+    }
+    constexpr size_t kLookups = 1 << 20;
+
+    std::mt19937                               rng(42);
+    std::vector<std::pair<unsigned, unsigned>> queries(kLookups);
+    for (auto& [st, t] : queries) {
+        st = rng() % table_.n_states_;
+        t  = rng() % table_.n_terminals_;
+    }
+
+    // Average nanoseconds per lookup of f(state, terminal)
+    auto measure = [&](auto&& f) {
+        long       sink  = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& [st, t] : queries) {
+            sink += f(st, t);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        volatile long keep = sink;
+        (void) keep;
+        return std::chrono::duration<double, std::nano>(end - start).count() /
+               kLookups;
+    };
+
+    const double map_ns = measure([&](unsigned st, unsigned t) {
+        const auto row = actions_.find(st);
+        if (row == actions_.end()) {
+            return 0;
+        }
+        const auto cell = row->second.find(index_.terminals_[t]);
+        return cell == row->second.end() ? 0
+                                         : static_cast<int>(cell->second.action);
+    });
+    const double dense_ns = measure([&](unsigned st, unsigned t) {
+        return table_.DenseAction(st, t);
+    });
+    const double packed_ns = measure(
+        [&](unsigned st, unsigned t) { return table_.Action(st, t); });
+    const double class_ns = measure(
+        [&](unsigned st, unsigned t) { return table_.ClassAction(st, t); });
+
+    size_t defaults = std::count_if(table_.default_.begin(),
+                                    table_.default_.end(),
+                                    [](int a) { return LRTable::IsReduce(a); });
+
+    tabulate::Table table;
+    table.add_row({"Representation", "Bytes", "ns/lookup"});
+    table.add_row({"std::map of std::map", std::to_string(MapTableBytes()),
+                   std::to_string(map_ns)});
+    table.add_row({"Dense arrays", std::to_string(table_.DenseBytes()),
+                   std::to_string(dense_ns)});
+    table.add_row({"Row displacement", std::to_string(table_.PackedBytes()),
+                   std::to_string(packed_ns)});
+    table.add_row({"Equivalence classes", std::to_string(table_.ClassBytes()),
+                   std::to_string(class_ns)});
+    table.format().font_align(tabulate::FontAlign::center);
+    table.column(0).format().font_color(tabulate::Color::cyan);
+    table.row(0).format().font_color(tabulate::Color::magenta);
+    std::cout << "States: " << table_.n_states_
+              << ", terminals: " << table_.n_terminals_
+              << ", non-terminals: " << table_.n_non_terminals_
+              << ", default reductions: " << defaults << "\n";
+    std::cout << "Action classes: " << table_.action_classes_.n_row_classes_
+              << " rows x " << table_.action_classes_.n_col_classes_
+              << " terminals\n";
+    std::cout << table << std::endl;
 }
 
 void SLR1Parser::TeachAllItems() {
@@ -342,6 +1156,7 @@ void SLR1Parser::TeachAllItems() {
 }
 
 void SLR1Parser::Closure(std::unordered_set<Lr0Item>& items) {
+    stats::ScopedTimer timer(stats::Phase::Closure);
     std::unordered_set<std::string> visited;
     ClosureUtil(items, items.size(), visited);
 }
@@ -349,7 +1164,8 @@ void SLR1Parser::Closure(std::unordered_set<Lr0Item>& items) {
 void SLR1Parser::ClosureUtil(std::unordered_set<Lr0Item>&     items,
                              unsigned int                     size,
                              std::unordered_set<std::string>& visited) {
-    std::unordered_set<Lr0Item> newItems;
+    stats::AddIterations(stats::Phase::Closure);
+    std::pmr::unordered_set<Lr0Item> newItems(arena::Current());
 
     for (const auto& item : items) {
         std::string next = item.NextToDot();
@@ -655,6 +1471,7 @@ void SLR1Parser::First(std::span<const std::string>     rule,
 
 // Least fixed point
 void SLR1Parser::ComputeFirstSets() {
+    stats::ScopedTimer timer(stats::Phase::First);
     // Init all FIRST to empty
     for (const auto& [nonTerminal, _] : gr_.g_) {
         first_sets_[nonTerminal] = {};
@@ -662,6 +1479,7 @@ void SLR1Parser::ComputeFirstSets() {
 
     bool changed;
     do {
+        stats::AddIterations(stats::Phase::First);
         auto old_first_sets = first_sets_; // Copy current state
 
         for (const auto& [nonTerminal, productions] : gr_.g_) {
@@ -686,6 +1504,7 @@ void SLR1Parser::ComputeFirstSets() {
 }
 
 void SLR1Parser::ComputeFollowSets() {
+    stats::ScopedTimer timer(stats::Phase::Follow);
     for (const auto& [nt, _] : gr_.g_) {
         follow_sets_[nt] = {};
     }
@@ -693,6 +1512,7 @@ void SLR1Parser::ComputeFollowSets() {
 
     bool changed;
     do {
+        stats::AddIterations(stats::Phase::Follow);
         changed = false;
         for (const auto& rule : gr_.g_) {
             const std::string& lhs = rule.first;
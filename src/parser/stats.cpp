@@ -0,0 +1,67 @@
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "../../include/stats.hpp"
+#include "../../include/tabulate.hpp"
+
+namespace stats {
+
+const char* Name(Phase phase) {
+    switch (phase) {
+    case Phase::Load:
+        return "Load";
+    case Phase::Split:
+        return "Split";
+    case Phase::First:
+        return "FIRST";
+    case Phase::Follow:
+        return "FOLLOW";
+    case Phase::LL1Table:
+        return "LL(1) table";
+    case Phase::Closure:
+        return "Closure";
+    case Phase::Collection:
+        return "Canonical collection";
+    case Phase::Conflicts:
+        return "Conflict resolution";
+    case Phase::FlatTable:
+        return "Flat tables";
+    default:
+        return "?";
+    }
+}
+
+void Reset() {
+    for (Counters& c : counters) {
+        c.calls       = 0;
+        c.nanoseconds = 0;
+        c.iterations  = 0;
+        c.allocations = 0;
+        c.bytes       = 0;
+    }
+}
+
+void Print(std::ostream& os) {
+    tabulate::Table table;
+    table.add_row(
+        {"Phase", "Calls", "Time (ms)", "Iterations", "Allocations", "Bytes"});
+    for (std::size_t i = 0; i < kPhases; ++i) {
+        const Counters& c = counters[i];
+        if (c.calls == 0) {
+            continue;
+        }
+        std::ostringstream ms;
+        ms << std::fixed << std::setprecision(3) << c.nanoseconds / 1e6;
+        table.add_row({Name(static_cast<Phase>(i)), std::to_string(c.calls),
+                       ms.str(), std::to_string(c.iterations),
+                       std::to_string(c.allocations),
+                       std::to_string(c.bytes)});
+    }
+    table.format().font_align(tabulate::FontAlign::center);
+    table.column(0).format().font_color(tabulate::Color::cyan);
+    table.row(0).format().font_color(tabulate::Color::magenta);
+    os << table << std::endl;
+}
+
+} // namespace stats
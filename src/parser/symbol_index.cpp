@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../include/grammar.hpp"
+#include "../../include/symbol_index.hpp"
+
+SymbolIndex::SymbolIndex(const Grammar& gr) {
+    const SymbolTable& st = gr.st_;
+
+    terminals_.push_back(st.EOL_);
+    std::vector<std::string> sorted_terminals;
+    for (const std::string& t : st.terminals_) {
+        if (t != st.EOL_ && t != st.EPSILON_) {
+            sorted_terminals.push_back(t);
+        }
+    }
+    std::sort(sorted_terminals.begin(), sorted_terminals.end());
+    terminals_.insert(terminals_.end(), sorted_terminals.begin(),
+                      sorted_terminals.end());
+    for (size_t i = 0; i < terminals_.size(); ++i) {
+        terminal_ids_[terminals_[i]] = static_cast<int>(i);
+    }
+
+    // Every symbol that is not a terminal is a non-terminal, even if it has no
+    // productions of its own
+    std::vector<std::string> sorted_non_terminals;
+    auto add_non_terminal = [&](const std::string& s) {
+        if (s != gr.axiom_ && s != st.EPSILON_ && !terminal_ids_.contains(s) &&
+            non_terminal_ids_.insert({s, 0}).second) {
+            sorted_non_terminals.push_back(s);
+        }
+    };
+    for (const auto& [nt, productions] : gr.g_) {
+        add_non_terminal(nt);
+        for (const production& prod : productions) {
+            for (const std::string& symbol : prod) {
+                add_non_terminal(symbol);
+            }
+        }
+    }
+    std::sort(sorted_non_terminals.begin(), sorted_non_terminals.end());
+    non_terminals_.push_back(gr.axiom_);
+    non_terminals_.insert(non_terminals_.end(), sorted_non_terminals.begin(),
+                          sorted_non_terminals.end());
+    non_terminal_ids_.clear();
+    for (size_t i = 0; i < non_terminals_.size(); ++i) {
+        non_terminal_ids_[non_terminals_[i]] = static_cast<int>(i);
+    }
+
+    epsilon_ = st.EPSILON_;
+    rules_of_.resize(non_terminals_.size());
+    for (size_t nt = 0; nt < non_terminals_.size(); ++nt) {
+        const auto it = gr.g_.find(non_terminals_[nt]);
+        if (it == gr.g_.end()) {
+            continue;
+        }
+        for (const production& prod : it->second) {
+            AddRule(non_terminals_[nt], prod);
+        }
+    }
+}
+
+int SymbolIndex::AddRule(const std::string& antecedent,
+                         const production&  consequent) {
+    const int nt = NonTerminalId(antecedent);
+    if (nt < 0) {
+        return -1;
+    }
+    const int n_terminals = static_cast<int>(terminals_.size());
+    Rule      rule{nt, {}};
+    for (const std::string& symbol : consequent) {
+        if (symbol == epsilon_) {
+            continue;
+        }
+        const int t  = TerminalId(symbol);
+        const int id = t >= 0 ? t : NonTerminalId(symbol);
+        if (id < 0) {
+            return -1;
+        }
+        rule.rhs_.push_back(t >= 0 ? t : n_terminals + id);
+    }
+    const int id = static_cast<int>(rules_.size());
+    rules_.push_back(std::move(rule));
+    consequents_.push_back(consequent);
+    rules_of_[nt].push_back(id);
+    return id;
+}
+
+int SymbolIndex::RemoveRule(const std::string& antecedent,
+                            const production&  consequent) {
+    const int id = RuleId(antecedent, consequent);
+    if (id < 0) {
+        return -1;
+    }
+    std::erase(rules_of_[rules_[id].lhs_], id);
+    const int last = static_cast<int>(rules_.size()) - 1;
+    if (id != last) {
+        std::replace(rules_of_[rules_[last].lhs_].begin(),
+                     rules_of_[rules_[last].lhs_].end(), last, id);
+        rules_[id]       = std::move(rules_[last]);
+        consequents_[id] = std::move(consequents_[last]);
+    }
+    rules_.pop_back();
+    consequents_.pop_back();
+    return id;
+}
+
+int SymbolIndex::TerminalId(const std::string& s) const {
+    const auto it = terminal_ids_.find(s);
+    return it == terminal_ids_.end() ? -1 : it->second;
+}
+
+int SymbolIndex::NonTerminalId(const std::string& s) const {
+    const auto it = non_terminal_ids_.find(s);
+    return it == non_terminal_ids_.end() ? -1 : it->second;
+}
+
+int SymbolIndex::RuleId(const std::string& antecedent,
+                        const production&  consequent) const {
+    const int nt = NonTerminalId(antecedent);
+    if (nt < 0) {
+        return -1;
+    }
+    for (int r : rules_of_[nt]) {
+        if (consequents_[r] == consequent) {
+            return r;
+        }
+    }
+    return -1;
+}
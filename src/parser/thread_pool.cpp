@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <utility>
+
+#include "../../include/thread_pool.hpp"
+
+namespace {
+
+/// @brief Pool and index of the worker running on this thread, if any.
+thread_local const ThreadPool* current_pool   = nullptr;
+thread_local unsigned          current_worker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    threads_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i] { Loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [this] { return pending_ == 0; });
+        stop_ = true;
+    }
+    work_.notify_all();
+    for (std::thread& t : threads_) {
+        t.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    const unsigned id = current_pool == this
+                            ? current_worker
+                            : next_.fetch_add(1) % workers_.size();
+    ++pending_;
+    {
+        std::lock_guard lock(workers_[id]->mutex);
+        workers_[id]->tasks.push_back(std::move(task));
+    }
+    {
+        // Under the lock, so that a worker cannot miss the notification
+        // between checking `queued_` and going to sleep
+        std::lock_guard lock(mutex_);
+        ++queued_;
+    }
+    work_.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return pending_ == 0; });
+    if (error_) {
+        std::exception_ptr error = std::exchange(error_, nullptr);
+        std::rethrow_exception(error);
+    }
+}
+
+bool ThreadPool::TryPop(unsigned id, std::function<void()>& task) {
+    {
+        Worker&         own = *workers_[id];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --queued_;
+            return true;
+        }
+    }
+    const size_t n = workers_.size();
+    for (size_t k = 1; k < n; ++k) {
+        Worker&         victim = *workers_[(id + k) % n];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued_;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::Loop(unsigned id) {
+    current_pool   = this;
+    current_worker = id;
+    while (true) {
+        std::function<void()> task;
+        if (TryPop(id, task)) {
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+            if (pending_.fetch_sub(1) == 1) {
+                std::lock_guard lock(mutex_);
+                idle_.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock lock(mutex_);
+        work_.wait(lock, [this] { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../../include/trace.hpp"
+
+namespace {
+
+std::unique_ptr<trace::Event[]>       buffer;
+std::size_t                           capacity = 0;
+std::atomic<std::uint64_t>            next{0};
+std::atomic<std::uint32_t>            next_tid{1};
+std::chrono::steady_clock::time_point origin;
+std::string                           path;
+
+std::uint32_t ThreadId() {
+    thread_local const std::uint32_t tid = next_tid.fetch_add(1);
+    return tid;
+}
+
+} // namespace
+
+namespace trace {
+
+bool Start(const std::string& file, std::size_t events) {
+    if (Enabled()) {
+        return false;
+    }
+    buffer   = std::make_unique<Event[]>(events);
+    capacity = events;
+    path     = file;
+    next     = 0;
+    origin   = std::chrono::steady_clock::now();
+    enabled  = true;
+    return true;
+}
+
+bool Stop() {
+    if (!Enabled()) {
+        return false;
+    }
+    enabled = false;
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        buffer.reset();
+        return false;
+    }
+    const std::uint64_t end   = next.load();
+    const std::uint64_t begin = end > capacity ? end - capacity : 0;
+    // Open scopes per thread, to leave out the ends of overwritten begins
+    std::unordered_map<std::uint32_t, unsigned> depth;
+    bool                                        first = true;
+    out << "{\"traceEvents\":[\n";
+    for (std::uint64_t i = begin; i < end; ++i) {
+        const Event& e = buffer[i % capacity];
+        if (e.phase == 'E') {
+            if (depth[e.tid] == 0) {
+                continue;
+            }
+            --depth[e.tid];
+        } else {
+            ++depth[e.tid];
+        }
+        out << (first ? "" : ",\n") << "{\"name\":\"" << e.name
+            << "\",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":" << e.tid
+            << ",\"ts\":" << e.ns / 1000 << "." << e.ns % 1000 / 100
+            << e.ns % 100 / 10 << e.ns % 10;
+        if (e.arg >= 0) {
+            out << ",\"args\":{\"n\":" << e.arg << "}";
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    buffer.reset();
+    return static_cast<bool>(out);
+}
+
+const std::string& Path() {
+    return path;
+}
+
+std::size_t Recorded() {
+    return next.load();
+}
+
+std::size_t Dropped() {
+    const std::uint64_t n = next.load();
+    return n > capacity ? n - capacity : 0;
+}
+
+void Record(const char* name, char phase, std::int64_t arg) {
+    using std::chrono::nanoseconds;
+    const std::uint64_t i  = next.fetch_add(1, std::memory_order_relaxed);
+    const std::int64_t  ns = std::chrono::duration_cast<nanoseconds>(
+                                std::chrono::steady_clock::now() - origin)
+                                .count();
+    buffer[i % capacity] = {name, phase, ThreadId(), ns, arg};
+}
+
+} // namespace trace
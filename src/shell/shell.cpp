@@ -1,4 +1,18 @@
 #include "../../include/shell.hpp"
+#include "../../include/counterexample.hpp"
+#include "../../include/grammar_factory.hpp"
+#include "../../include/tabulate.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <thread>
+#include <unistd.h>
 #include <unordered_set>
 
 #define RED "\033[31m"
@@ -9,14 +23,225 @@
 #define CYAN "\033[36m"
 #define RESET "\033[0m"
 
-std::unordered_map<std::string,
-                   std::function<void(const std::vector<std::string>&)>>
-    Shell::commands;
+Shell* Shell::instance = nullptr;
+
+namespace {
+
+/// @brief Removes the ANSI escape sequences (colors) of a text.
+std::string StripAnsi(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\033' && i + 1 < text.size() && text[i + 1] == '[') {
+            i += 2;
+            while (i < text.size() && !std::isalpha(text[i])) {
+                ++i;
+            }
+            continue;
+        }
+        out += text[i];
+    }
+    return out;
+}
+
+/// @brief Error of a command output, without the `pl-shell: ` prefix.
+std::string ErrorMessage(const std::string& text) {
+    const std::string prefix = "pl-shell: ";
+    size_t            begin  = text.find(prefix);
+    begin = begin == std::string::npos ? 0 : begin + prefix.size();
+    std::string message = text.substr(begin, text.find('\n', begin) - begin);
+    while (!message.empty() && std::isspace(message.back())) {
+        message.pop_back();
+    }
+    return message;
+}
+
+std::vector<std::string> Sorted(const std::unordered_set<std::string>& set) {
+    std::vector<std::string> sorted(set.begin(), set.end());
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+const char* ConflictKind(SLR1Parser::Conflict::Kind kind) {
+    return kind == SLR1Parser::Conflict::Kind::ShiftReduce ? "shift/reduce"
+                                                           : "reduce/reduce";
+}
+
+/// @brief Lists the cells of the LL(1) table with more than one production.
+void PrintLL1Conflicts(const LL1Parser& ll1) {
+    std::map<std::string, std::map<std::string, std::vector<production>>>
+        table;
+    for (const auto& [nt, row] : ll1.ll1_t_) {
+        for (const auto& [symbol, prods] : row) {
+            if (prods.size() > 1) {
+                table[nt][symbol] = prods;
+            }
+        }
+    }
+    std::cout << YELLOW << "The grammar is not LL(1), conflicts:\n" << RESET;
+    for (const auto& [nt, row] : table) {
+        for (const auto& [symbol, prods] : row) {
+            std::cout << "  " << nt << ", " << symbol << ":";
+            for (size_t i = 0; i < prods.size(); ++i) {
+                std::cout << (i == 0 ? " " : " | ") << nt << " ->";
+                for (const std::string& s : prods[i]) {
+                    std::cout << " " << s;
+                }
+            }
+            std::cout << "\n";
+        }
+    }
+}
+
+/// @brief Lists the conflicts of the SLR(1) table with their items.
+void PrintSLR1Conflicts(const SLR1Parser& slr1) {
+    std::cout << YELLOW << "The grammar is not SLR(1), "
+              << slr1.ConflictCount() << " conflicts:\n"
+              << RESET;
+    for (const SLR1Parser::Conflict& c : slr1.Conflicts()) {
+        std::cout << "  State " << c.state << ", " << c.symbol << ": "
+                  << ConflictKind(c.kind) << "\n";
+        for (const Lr0Item& item : c.items) {
+            std::cout << "    " << item.ToString() << "\n";
+        }
+    }
+}
+
+/// @brief Prints the forms and the example sentence of a counterexample.
+void PrintCounterexample(const counterexample::Example& example,
+                         const std::string&             eol) {
+    if (example.unifying) {
+        std::cout << "    " << YELLOW << "Ambiguity: " << RESET
+                  << example.first.ToString(eol) << "\n";
+        std::cout << "      " << example.first_label << "\n";
+        std::cout << "      " << example.second_label << "\n";
+    } else {
+        std::cout << "    " << example.first_label << ": "
+                  << example.first.ToString(eol) << "\n";
+        std::cout << "    " << example.second_label << ": "
+                  << example.second.ToString(eol) << "\n";
+    }
+    std::cout << "    Example:";
+    for (const std::string& terminal : example.sentence) {
+        std::cout << " " << terminal;
+    }
+    std::cout << "\n";
+    if (example.follow_only) {
+        std::cout << "    The symbol is in FOLLOW of the reduced non "
+                     "terminal, but cannot follow it here.\n";
+    } else if (!example.unifying && example.bounded) {
+        std::cout << "    No unifying example was found before the search "
+                     "stopped.\n";
+    }
+}
+
+/// @brief Writes a counterexample as the members of a JSON object.
+void WriteCounterexample(JsonWriter&                     json,
+                         const counterexample::Example& example,
+                         const std::string&             eol) {
+    json.Key("unifying").Value(example.unifying);
+    json.Key("bounded").Value(example.bounded);
+    json.Key("follow_only").Value(example.follow_only);
+    json.Key("first").BeginObject();
+    json.Key("label").Value(example.first_label);
+    json.Key("form").Value(example.first.ToString(eol));
+    json.EndObject();
+    json.Key("second").BeginObject();
+    json.Key("label").Value(example.second_label);
+    json.Key("form").Value(example.second.ToString(eol));
+    json.EndObject();
+    json.Key("sentence").Strings(example.sentence);
+}
+
+/// @brief Set when `watch` is interrupted with Ctrl-C.
+volatile std::sig_atomic_t interrupted = 0;
+
+void StopWatching(int) { interrupted = 1; }
+
+/**
+ * @brief Waits until a file of a directory watched with inotify is saved.
+ *
+ * Editors often save a file in several writes, or write a copy and rename
+ * it, so the events that follow the first one within a few milliseconds are
+ * part of the same save.
+ *
+ * @param fd Inotify descriptor watching the directory of the file.
+ * @param name Name of the file in its directory.
+ * @param stdin_stops Whether a line on the standard input stops waiting.
+ * @return `false` if waiting was stopped with Ctrl-C or the standard input.
+ */
+bool WaitForSave(int fd, const std::string& name, bool stdin_stops) {
+    pollfd fds[2] = {{fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+    bool   saved  = false;
+    while (!interrupted) {
+        const int ready = poll(fds, stdin_stops ? 2 : 1, saved ? 20 : -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (ready == 0) {
+            return true;
+        }
+        if (stdin_stops && fds[1].revents != 0) {
+            // Consume the line byte by byte, as readline reads the prompt
+            char c = 0;
+            while (read(STDIN_FILENO, &c, 1) == 1 && c != '\n') {
+            }
+            return false;
+        }
+        alignas(inotify_event) char buffer[4096];
+        const ssize_t               size = read(fd, buffer, sizeof(buffer));
+        for (ssize_t i = 0; i < size;) {
+            const auto* event = reinterpret_cast<inotify_event*>(buffer + i);
+            if (event->len > 0 && name == event->name) {
+                saved = true;
+            }
+            i += sizeof(inotify_event) + event->len;
+        }
+    }
+    return false;
+}
+
+/// @brief Restores `std::cout` and `std::cerr` when it goes out of scope.
+class Capture {
+  public:
+    Capture(std::ostream& out, std::ostream& err)
+        : cout_(std::cout.rdbuf(out.rdbuf())),
+          cerr_(std::cerr.rdbuf(err.rdbuf())) {}
+
+    ~Capture() {
+        std::cout.rdbuf(cout_);
+        std::cerr.rdbuf(cerr_);
+    }
+
+  private:
+    std::streambuf* cout_;
+    std::streambuf* cerr_;
+};
+
+} // namespace
 
 Shell::Shell() {
     commands["load"] = [this](const std::vector<std::string>& args) {
         CmdLoad(args);
     };
+    commands["addrule"] = [this](const std::vector<std::string>& args) {
+        CmdEditRule(args, true);
+    };
+    commands["delrule"] = [this](const std::vector<std::string>& args) {
+        CmdEditRule(args, false);
+    };
+    commands["watch"] = [this](const std::vector<std::string>& args) {
+        CmdWatch(args);
+    };
+    commands["transform"] = [this](const std::vector<std::string>& args) {
+        CmdTransform(args);
+    };
+    commands["prune"] = [this](const std::vector<std::string>& args) {
+        CmdPrune(args);
+    };
     commands["gdebug"] = [this](const std::vector<std::string>& args) {
         CmdGDebug();
     };
@@ -32,6 +257,12 @@ Shell::Shell() {
     commands["ll1"] = [this](const std::vector<std::string>& args) {
         CmdLL1Table(args);
     };
+    commands["slr"] = [this](const std::vector<std::string>& args) {
+        CmdSLR1Table(args);
+    };
+    commands["sets"] = [this](const std::vector<std::string>& args) {
+        CmdSets(args);
+    };
     commands["allitems"] = [this](const std::vector<std::string>& args) {
         CmdAllLRItems(args);
     };
@@ -44,6 +275,31 @@ Shell::Shell() {
     commands["collection"] = [this](const std::vector<std::string>& args) {
         CmdCanonicalCollection(args);
     };
+    commands["codegen"] = [this](const std::vector<std::string>& args) {
+        CmdCodegen(args);
+    };
+    commands["tablestats"] = [this](const std::vector<std::string>& args) {
+        CmdTableStats(args);
+    };
+    commands["stats"] = [this](const std::vector<std::string>& args) {
+        CmdStats(args);
+    };
+    commands["analyze"] = [this](const std::vector<std::string>& args) {
+        CmdAnalyze(args);
+    };
+    commands["threads"] = [this](const std::vector<std::string>& args) {
+        CmdThreads(args);
+    };
+    commands["unitbypass"] = [this](const std::vector<std::string>& args) {
+        CmdUnitBypass(args);
+    };
+    commands["counterexamples"] =
+        [this](const std::vector<std::string>& args) {
+            CmdCounterexamples(args);
+        };
+    commands["trace"] = [this](const std::vector<std::string>& args) {
+        CmdTrace(args);
+    };
     commands["exit"] = [this](const std::vector<std::string>& args) {
         CmdExit();
     };
@@ -56,12 +312,12 @@ Shell::Shell() {
     commands["clear"] = [this](const std::vector<std::string>& args) {
         CmdClear();
     };
-
-    std::signal(SIGINT, Shell::SignalHandler);
-    std::signal(SIGTSTP, Shell::SignalHandler);
 }
 
 void Shell::Run() {
+    instance = this;
+    std::signal(SIGINT, Shell::SignalHandler);
+    std::signal(SIGTSTP, Shell::SignalHandler);
 
     std::cout << GREEN << "========================================\n";
     std::cout << " Welcome to " << BLUE << "PLShell" << GREEN << "!\n";
@@ -86,10 +342,13 @@ void Shell::Run() {
             ExecuteCommand(command);
         }
     }
+    if (trace::Enabled()) {
+        trace::Stop();
+    }
     std::cout << "Bye!\n";
 }
 
-void Shell::ExecuteCommand(const std::string& input) {
+bool Shell::ExecuteCommand(const std::string& input) {
     std::istringstream       iss(input);
     std::vector<std::string> tokens;
     std::string              token;
@@ -97,16 +356,93 @@ void Shell::ExecuteCommand(const std::string& input) {
     while (iss >> token)
         tokens.push_back(token);
     if (tokens.empty())
-        return;
+        return true;
 
     auto cmd = commands.find(tokens[0]);
     if (cmd == commands.end()) {
         std::cout << RED << "Command not recognized.\n" << RESET;
         SuggestCommand(tokens[0]);
-        return;
+        return false;
     }
     tokens.erase(tokens.begin());
     cmd->second(tokens);
+    return true;
+}
+
+int Shell::RunBatch(const std::vector<std::string>& lines, Format fmt) {
+    batch  = true;
+    format = fmt;
+    bool failed = false;
+    for (const std::string& line : lines) {
+        const size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') {
+            continue;
+        }
+        failed |= !RunBatchCommand(line.substr(begin));
+        if (!running) {
+            break;
+        }
+    }
+    if (trace::Enabled()) {
+        trace::Stop();
+    }
+    return failed ? 1 : 0;
+}
+
+bool Shell::RunBatchCommand(const std::string& input) {
+    std::ostringstream out;
+    std::ostringstream err;
+    std::string        exception;
+    bool               known = true;
+    result.str("");
+    {
+        Capture capture(out, err);
+        try {
+            known = ExecuteCommand(input);
+        } catch (const std::exception& e) {
+            exception = e.what();
+        }
+    }
+
+    // Commands report errors with a "pl-shell: " message, on either stream
+    const std::string output = StripAnsi(out.str());
+    const std::string errors = StripAnsi(err.str());
+    const bool        ok     = known && exception.empty() && errors.empty() &&
+                    output.find("pl-shell: ") == std::string::npos;
+
+    if (format == Format::Text) {
+        const bool colors = isatty(STDOUT_FILENO);
+        std::cout << (colors ? out.str() : output) << std::flush;
+        std::cerr << (colors ? err.str() : errors);
+        if (!exception.empty()) {
+            std::cerr << "pl-shell: " << exception << "\n";
+        }
+        return ok;
+    }
+
+    std::istringstream       iss(input);
+    std::vector<std::string> tokens{std::istream_iterator<std::string>(iss),
+                                    std::istream_iterator<std::string>()};
+    JsonWriter               json(std::cout);
+    json.BeginObject();
+    json.Key("command").Value(tokens[0]);
+    json.Key("args").Strings(
+        std::vector<std::string>(tokens.begin() + 1, tokens.end()));
+    json.Key("ok").Value(ok);
+    if (!known) {
+        json.Key("error").Value("command not recognized");
+    } else if (!exception.empty()) {
+        json.Key("error").Value(exception);
+    } else if (!ok) {
+        json.Key("error").Value(ErrorMessage(errors.empty() ? output : errors));
+    } else if (!result.str().empty()) {
+        json.Key("result").Raw(result.str());
+    } else if (!output.empty()) {
+        json.Key("output").Value(output);
+    }
+    json.EndObject();
+    std::cout << std::endl;
+    return ok;
 }
 
 void Shell::PrintHistory() {
@@ -128,11 +464,11 @@ char* Shell::CommandGenerator(const char* text, int state) {
     const char*                                                         name;
 
     if (!state) {
-        it  = Shell::commands.begin();
+        it  = instance->commands.begin();
         len = strlen(text);
     }
 
-    while (it != Shell::commands.end()) {
+    while (it != instance->commands.end()) {
         name = it->first.c_str();
         ++it;
 
@@ -156,7 +492,7 @@ void Shell::SuggestCommand(const std::string& input) {
     size_t      min_distance = std::numeric_limits<size_t>::max();
     bool        has_prefix   = false;
 
-    for (const auto& cmd : Shell::commands) {
+    for (const auto& cmd : commands) {
         if (cmd.first.find(input) == 0) {
             closest_match = cmd.first;
             has_prefix    = true;
@@ -184,6 +520,10 @@ void Shell::SignalHandler(int signum) {
 }
 
 void Shell::CmdExit() {
+    if (batch) {
+        running = false;
+        return;
+    }
     std::cout << "Are you sure you want to exit? (y/n): ";
     char response;
     std::cin >> response;
@@ -195,15 +535,44 @@ void Shell::CmdExit() {
 void Shell::CmdHelp() {
     std::cout << "Available commands:\n";
     std::cout << "  load         - Load a file\n";
+    std::cout << "  addrule      - Add a rule to the loaded grammar "
+                 "(addrule A -> symbols)\n";
+    std::cout << "  delrule      - Remove a rule from the loaded grammar "
+                 "(delrule A -> symbols)\n";
+    std::cout << "  watch        - Analyze a grammar again every time its "
+                 "file is saved (watch <file> [-n N])\n";
+    std::cout << "  transform    - Remove left recursion or unit rules, or "
+                 "left factorize (transform leftrec|unit|factor|all "
+                 "[-o file])\n";
+    std::cout << "  prune        - Remove unproductive and unreachable non "
+                 "terminals and their rules\n";
     std::cout << "  gdebug       - Enable/disable debug mode\n";
     std::cout << "  first        - Compute FIRST set\n";
     std::cout << "  follow       - Compute FOLLOW set\n";
     std::cout << "  predsymbols  - List predictive symbols\n";
     std::cout << "  ll1          - Generate LL(1) parsing table\n";
+    std::cout << "  slr          - Show SLR(1) parsing table\n";
+    std::cout << "  sets         - Show FIRST and FOLLOW of every non "
+                 "terminal\n";
     std::cout << "  allitems     - List all LR(0) items\n";
     std::cout << "  closure      - Compute closure of a set of items\n";
     std::cout << "  delta        - Compute delta function of a set of items "
                  "with one symbol\n";
+    std::cout << "  codegen      - Generate a standalone C++ parser\n";
+    std::cout << "  tablestats   - Compare size and lookup latency of the "
+                 "parse tables\n";
+    std::cout << "  stats        - Show time and memory per analysis phase "
+                 "(stats on|off|reset)\n";
+    std::cout << "  analyze      - Analyze every grammar of a directory in "
+                 "parallel (analyze <dir> [-j N])\n";
+    std::cout << "  threads      - Threads used to build the SLR(1) automaton "
+                 "(threads [n])\n";
+    std::cout << "  unitbypass   - Skip unit rule reductions in the SLR(1) "
+                 "tables (unitbypass on|off)\n";
+    std::cout << "  counterexamples - Show an example sentence of every "
+                 "LL(1) and SLR(1) conflict\n";
+    std::cout << "  trace        - Record phases to a Chrome trace file "
+                 "(trace on <file>|off)\n";
     std::cout << "  exit         - Exit the shell\n";
     std::cout << "  history      - Show command history\n";
     std::cout << "  help         - Show this help message\n";
@@ -228,11 +597,413 @@ void Shell::CmdLoad(const std::vector<std::string>& args) {
                   << RESET;
         return;
     }
-    std::cout << GREEN << "Grammar loaded successfully.\n";
-    ll1  = LL1Parser(grammar);
-    slr1 = SLR1Parser(grammar);
-    ll1.CreateLL1Table();
-    slr1.MakeParser();
+    AnalyzeGrammar();
+    if (format == Format::Json) {
+        std::vector<std::string> terminals;
+        for (const std::string& t : grammar.st_.terminals_) {
+            if (t != grammar.st_.EPSILON_) {
+                terminals.push_back(t);
+            }
+        }
+        std::sort(terminals.begin(), terminals.end());
+        JsonWriter json(result);
+        json.BeginObject();
+        json.Key("file").Value(filename);
+        json.Key("axiom").Value(grammar.axiom_);
+        json.Key("non_terminals").Strings(Sorted(grammar.st_.non_terminals_));
+        json.Key("terminals").Strings(terminals);
+        json.Key("ll1").Value(is_ll1);
+        json.Key("slr1").Value(is_slr1);
+        if (grammar.modules_.size() > 1) {
+            std::vector<std::string> modules;
+            for (size_t m = 1; m < grammar.modules_.size(); ++m) {
+                modules.push_back(grammar.modules_[m].name);
+            }
+            json.Key("modules").Strings(modules);
+            json.Key("analyzed").Strings(module_cache.analyzed_);
+        }
+        json.EndObject();
+        return;
+    }
+    std::cout << GREEN << "Grammar loaded successfully.\n" << RESET;
+    if (grammar.modules_.size() > 1) {
+        std::cout << "Modules: " << grammar.modules_.size() - 1
+                  << " imported, FIRST sets of "
+                  << grammar.modules_.size() - module_cache.analyzed_.size()
+                  << " of " << grammar.modules_.size()
+                  << " files reused from the last load.\n";
+    }
+}
+
+void Shell::AnalyzeGrammar() {
+    if (grammar.modules_.size() > 1) {
+        first_follow::SetMap first = module_cache.First(grammar);
+        ll1                        = LL1Parser(grammar, first);
+        slr1                       = SLR1Parser(grammar, std::move(first));
+    } else {
+        ll1  = LL1Parser(grammar);
+        slr1 = SLR1Parser(grammar);
+    }
+    slr1.threads_           = threads;
+    slr1.bypass_unit_rules_ = unit_bypass;
+    is_ll1                  = ll1.CreateLL1Table();
+    is_slr1       = slr1.MakeParser();
+}
+
+void Shell::CmdEditRule(const std::vector<std::string>& args, bool add) {
+    const char* name = add ? "addrule" : "delrule";
+    if (args.size() < 2 || args[1] != "->") {
+        std::cerr << RED << "pl-shell: usage: " << name << " A -> symbols\n"
+                  << RESET;
+        return;
+    }
+    if (grammar.g_.empty()) {
+        std::cerr << RED
+                  << "pl-shell: no grammar was loaded. Load one with load "
+                     "<filename>.\n"
+                  << RESET;
+        return;
+    }
+    // Symbols are split as in grammar files, an empty body is epsilon
+    std::string body;
+    for (size_t i = 2; i < args.size(); ++i) {
+        body += args[i];
+    }
+    const production consequent =
+        body.empty() ? production{grammar.st_.EPSILON_} : grammar.Split(body);
+    if (consequent.empty()) {
+        std::cerr << RED << "pl-shell: " << name
+                  << ": the rule has an undeclared symbol.\n"
+                  << RESET;
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (add ? !grammar.InsertRule(args[0], consequent)
+            : !grammar.RemoveRule(args[0], consequent)) {
+        std::cerr << RED << "pl-shell: " << name
+                  << (add ? ": the rule already exists, or its antecedent is "
+                            "a terminal or the axiom.\n"
+                          : ": the rule does not exist, or it is the axiom "
+                            "rule or the last rule of a used non terminal.\n")
+                  << RESET;
+        return;
+    }
+    if (add) {
+        ll1.AddRule(args[0], consequent);
+        slr1.AddRule(args[0], consequent);
+    } else {
+        ll1.RemoveRule(args[0], consequent);
+        slr1.RemoveRule(args[0], consequent);
+    }
+    is_ll1  = ll1.IsLL1();
+    is_slr1 = slr1.conflicts_.empty();
+    const double ms =
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+
+    if (format == Format::Json) {
+        JsonWriter json(result);
+        json.BeginObject();
+        json.Key("antecedent").Value(args[0]);
+        json.Key("consequent").Strings(consequent);
+        json.Key("ll1").Value(is_ll1);
+        json.Key("slr1").Value(is_slr1);
+        json.EndObject();
+        return;
+    }
+    std::ostringstream time;
+    time << std::fixed << std::setprecision(3) << ms;
+    std::cout << GREEN "✔ " << RESET << (add ? "Rule added" : "Rule removed")
+              << " in " << time.str() << " ms. LL(1): "
+              << (is_ll1 ? "yes" : "no")
+              << ", SLR(1): " << (is_slr1 ? "yes" : "no") << ".\n";
+}
+
+void Shell::CmdWatch(const std::vector<std::string>& args) {
+    std::string             filename;
+    unsigned                saves = 0;
+    po::options_description desc("Options");
+    desc.add_options()("help,h", "Show help message and exit")(
+        "file", po::value<std::string>(&filename)->required(),
+        "Grammar file to watch")(
+        "saves,n", po::value<unsigned>(&saves)->default_value(0),
+        "Stop after this many saves, 0 to watch until Enter or Ctrl-C");
+    po::positional_options_description pos;
+    pos.add("file", 1);
+    try {
+        po::variables_map vm;
+        po::store(
+            po::command_line_parser(args).options(desc).positional(pos).run(),
+            vm);
+        if (vm.count("help")) {
+            std::cout << "Usage: watch [options] <file>\n";
+            std::cout << "Load a grammar and analyze it again every time its "
+                         "file is saved.\n";
+            std::cout << desc << "\n";
+            return;
+        }
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << RED << "pl-shell: " << e.what() << "\n" << RESET;
+        return;
+    }
+
+    CmdLoad({filename});
+    if (grammar.g_.empty()) {
+        return;
+    }
+    if (!is_ll1) {
+        PrintLL1Conflicts(ll1);
+    }
+    if (!is_slr1) {
+        PrintSLR1Conflicts(slr1);
+    }
+
+    // The directory is watched, so that saves that replace the file are seen
+    const std::filesystem::path path(filename);
+    const std::string           dir =
+        path.has_parent_path() ? path.parent_path().string() : ".";
+    const int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 ||
+        inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << RED << "pl-shell: cannot watch " << filename << ": "
+                  << std::strerror(errno) << "\n"
+                  << RESET;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    std::cout << "Watching " << filename
+              << (batch ? "" : ", press Enter or Ctrl-C to stop") << ".\n"
+              << std::flush;
+
+    interrupted   = 0;
+    auto previous = std::signal(SIGINT, StopWatching);
+    for (unsigned n = 0; saves == 0 || n < saves; ++n) {
+        if (!WaitForSave(fd, path.filename().string(), !batch)) {
+            break;
+        }
+        Reanalyze(filename);
+        std::cout << std::flush;
+    }
+    std::signal(SIGINT, previous);
+    close(fd);
+}
+
+void Shell::Reanalyze(const std::string& filename) {
+    const auto start = std::chrono::steady_clock::now();
+    Grammar    next;
+    if (!next.ReadFromFile(filename)) {
+        std::cerr << RED << "pl-shell: " << filename
+                  << " has errors, the last grammar is kept.\n"
+                  << RESET;
+        return;
+    }
+    // Only the rules that changed are applied to the loaded grammar and
+    // parsers, unless the terminals or the axiom changed
+    std::vector<RuleEdit> edits;
+    const bool            incremental = grammar.EditsTo(next, edits);
+    if (incremental && edits.empty()) {
+        std::cout << filename << " was saved without rule changes.\n";
+        return;
+    }
+    if (incremental) {
+        for (const RuleEdit& edit : edits) {
+            grammar.Apply(edit);
+        }
+        ll1.EditRules(edits);
+        slr1.EditRules(edits);
+        is_ll1  = ll1.IsLL1();
+        is_slr1 = slr1.conflicts_.empty();
+    } else {
+        grammar = std::move(next);
+        AnalyzeGrammar();
+    }
+    const double ms =
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+
+    std::ostringstream time;
+    time << std::fixed << std::setprecision(3) << ms;
+    std::cout << GREEN "✔ " << RESET << filename << ": ";
+    if (incremental) {
+        const auto added = std::count_if(
+            edits.begin(), edits.end(),
+            [](const RuleEdit& edit) { return edit.add; });
+        std::cout << "rules added: " << added
+                  << ", removed: " << edits.size() - added;
+    } else {
+        std::cout << "terminals or axiom changed, loaded again";
+    }
+    std::cout << " in " << time.str()
+              << " ms. LL(1): " << (is_ll1 ? "yes" : "no")
+              << ", SLR(1): " << (is_slr1 ? "yes" : "no") << ".\n";
+    if (!is_ll1) {
+        PrintLL1Conflicts(ll1);
+    }
+    if (!is_slr1) {
+        PrintSLR1Conflicts(slr1);
+    }
+}
+
+void Shell::CmdTransform(const std::vector<std::string>& args) {
+    std::string             kind;
+    std::string             output;
+    po::options_description desc("Options");
+    desc.add_options()("help,h", "Show help message and exit")(
+        "kind", po::value<std::string>(&kind)->required(),
+        "leftrec, unit, factor or all (the three, in that order)")(
+        "output,o", po::value<std::string>(&output),
+        "Write the grammar to this file instead of the screen");
+    po::positional_options_description pos;
+    pos.add("kind", 1);
+    try {
+        po::variables_map vm;
+        po::store(
+            po::command_line_parser(args).options(desc).positional(pos).run(),
+            vm);
+        if (vm.count("help")) {
+            std::cout << "Usage: transform [options] <kind>\n";
+            std::cout << "Transform the loaded grammar, analyze it again and "
+                         "write it in the grammar file format.\n";
+            std::cout << desc << "\n";
+            return;
+        }
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << RED << "pl-shell: " << e.what() << "\n" << RESET;
+        return;
+    }
+    if (kind != "leftrec" && kind != "unit" && kind != "factor" &&
+        kind != "all") {
+        std::cerr << RED
+                  << "pl-shell: transform expects leftrec, unit, factor or "
+                     "all.\n"
+                  << RESET;
+        return;
+    }
+    if (grammar.g_.empty()) {
+        std::cerr << RED
+                  << "pl-shell: no grammar was loaded. Load one with load "
+                     "<filename>.\n"
+                  << RESET;
+        return;
+    }
+
+    const auto     start = std::chrono::steady_clock::now();
+    GrammarFactory factory;
+    if (kind == "leftrec" || kind == "all") {
+        factory.RemoveLeftRecursion(grammar);
+    }
+    if (kind == "unit" || kind == "all") {
+        factory.RemoveUnitRules(grammar);
+    }
+    if (kind == "factor" || kind == "all") {
+        factory.LeftFactorize(grammar);
+    }
+    const double ms =
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    AnalyzeGrammar();
+
+    size_t rules = 0;
+    for (const auto& [nt, productions] : grammar.g_) {
+        rules += productions.size();
+    }
+    std::ostringstream text;
+    grammar.Write(text);
+    if (!output.empty() && !grammar.WriteToFile(output)) {
+        std::cerr << RED << "pl-shell: cannot write " << output << ".\n"
+                  << RESET;
+        return;
+    }
+    if (format == Format::Json) {
+        JsonWriter json(result);
+        json.BeginObject();
+        json.Key("rules").Value(rules);
+        json.Key("non_terminals").Value(grammar.g_.size());
+        json.Key("ll1").Value(is_ll1);
+        json.Key("slr1").Value(is_slr1);
+        json.Key("grammar").Value(text.str());
+        json.EndObject();
+        return;
+    }
+    std::ostringstream time;
+    time << std::fixed << std::setprecision(3) << ms;
+    std::cout << GREEN "✔ " << RESET << "Transformed in " << time.str()
+              << " ms: " << rules << " rules, " << grammar.g_.size()
+              << " non terminals. LL(1): " << (is_ll1 ? "yes" : "no")
+              << ", SLR(1): " << (is_slr1 ? "yes" : "no") << ".\n";
+    if (output.empty()) {
+        std::cout << text.str();
+    } else {
+        std::cout << "Grammar written to " << output << ".\n";
+    }
+}
+
+void Shell::CmdPrune(const std::vector<std::string>& args) {
+    if (!args.empty()) {
+        std::cerr << RED << "pl-shell: prune takes no arguments.\n" << RESET;
+        return;
+    }
+    if (grammar.g_.empty()) {
+        std::cerr << RED
+                  << "pl-shell: no grammar was loaded. Load one with load "
+                     "<filename>.\n"
+                  << RESET;
+        return;
+    }
+    const auto                   start  = std::chrono::steady_clock::now();
+    const GrammarFactory::Pruned pruned = GrammarFactory().Prune(grammar);
+    if (pruned.empty_language) {
+        std::cerr << RED << "pl-shell: prune: the axiom " << grammar.axiom_
+                  << " derives no terminal string, the grammar is kept.\n"
+                  << RESET;
+        return;
+    }
+    const double ms =
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    if (pruned.rules > 0) {
+        AnalyzeGrammar();
+    }
+
+    if (format == Format::Json) {
+        JsonWriter json(result);
+        json.BeginObject();
+        json.Key("unproductive").Strings(pruned.unproductive);
+        json.Key("unreachable").Strings(pruned.unreachable);
+        json.Key("rules").Value(pruned.rules);
+        json.Key("ll1").Value(is_ll1);
+        json.Key("slr1").Value(is_slr1);
+        json.EndObject();
+        return;
+    }
+    std::ostringstream time;
+    time << std::fixed << std::setprecision(3) << ms;
+    std::cout << GREEN "✔ " << RESET << "Pruned in " << time.str()
+              << " ms: " << pruned.unproductive.size() << " unproductive and "
+              << pruned.unreachable.size() << " unreachable non terminals, "
+              << pruned.rules << " rules. LL(1): " << (is_ll1 ? "yes" : "no")
+              << ", SLR(1): " << (is_slr1 ? "yes" : "no") << ".\n";
+    auto print = [](const char* title, const std::vector<std::string>& nts) {
+        if (nts.empty()) {
+            return;
+        }
+        std::cout << title << ":";
+        for (const std::string& nt : nts) {
+            std::cout << " " << nt;
+        }
+        std::cout << "\n";
+    };
+    print("Unproductive", pruned.unproductive);
+    print("Unreachable", pruned.unreachable);
 }
 
 void Shell::CmdGDebug() {
@@ -289,10 +1060,18 @@ void Shell::CmdFirst(const std::vector<std::string>& args) {
             ll1.TeachFirst(splitted);
             return;
         } else {
-            std::unordered_set<std::string> result;
-            ll1.First(splitted, result);
+            std::unordered_set<std::string> first;
+            ll1.First(splitted, first);
+            if (format == Format::Json) {
+                JsonWriter json(result);
+                json.BeginObject();
+                json.Key("symbols").Strings(splitted);
+                json.Key("first").Strings(Sorted(first));
+                json.EndObject();
+                return;
+            }
             std::cout << GREEN "✔ " << RESET << "FIRST(" << arg << ") = ";
-            PrintSet(result);
+            PrintSet(first);
             std::cout << "\n";
         }
     } catch (const std::exception& e) {
@@ -336,9 +1115,17 @@ void Shell::CmdFollow(const std::vector<std::string>& args) {
             ll1.TeachFollow(arg);
             return;
         } else {
-            std::unordered_set<std::string> result{ll1.Follow(arg)};
+            std::unordered_set<std::string> follow{ll1.Follow(arg)};
+            if (format == Format::Json) {
+                JsonWriter json(result);
+                json.BeginObject();
+                json.Key("non_terminal").Value(arg);
+                json.Key("follow").Strings(Sorted(follow));
+                json.EndObject();
+                return;
+            }
             std::cout << GREEN "✔ " << RESET << "FOLLOW(" << arg << ") = ";
-            PrintSet(result);
+            PrintSet(follow);
             std::cout << "\n";
         }
     } catch (const std::exception& e) {
@@ -389,11 +1176,20 @@ void Shell::CmdPredictionSymbols(const std::vector<std::string>& args) {
                 std::cerr << RED << "pl-shell: rule does not exist.\n" << RESET;
                 return;
             }
-            std::unordered_set<std::string> result{
+            std::unordered_set<std::string> symbols{
                 ll1.PredictionSymbols(ant, splitted)};
+            if (format == Format::Json) {
+                JsonWriter json(result);
+                json.BeginObject();
+                json.Key("antecedent").Value(ant);
+                json.Key("consequent").Strings(splitted);
+                json.Key("prediction_symbols").Strings(Sorted(symbols));
+                json.EndObject();
+                return;
+            }
             std::cout << GREEN "✔ " << RESET << "PS(" << ant << " -> " << conseq
                       << ") = ";
-            PrintSet(result);
+            PrintSet(symbols);
             std::cout << "\n";
         }
     } catch (const std::exception& e) {
@@ -431,12 +1227,200 @@ void Shell::CmdLL1Table(const std::vector<std::string>& args) {
     }
     if (verbose_mode) {
         ll1.TeachLL1Table();
+    } else if (format == Format::Json) {
+        // Rows and columns in name order, cells with more than one
+        // production are also listed as conflicts
+        std::map<std::string, std::map<std::string, std::vector<production>>>
+            table;
+        for (const auto& [nt, row] : ll1.ll1_t_) {
+            table[nt].insert(row.begin(), row.end());
+        }
+        JsonWriter json(result);
+        json.BeginObject();
+        json.Key("ll1").Value(is_ll1);
+        json.Key("table").BeginObject();
+        for (const auto& [nt, row] : table) {
+            json.Key(nt).BeginObject();
+            for (const auto& [symbol, prods] : row) {
+                json.Key(symbol).BeginArray();
+                for (const production& prod : prods) {
+                    json.Strings(prod);
+                }
+                json.EndArray();
+            }
+            json.EndObject();
+        }
+        json.EndObject();
+        json.Key("conflicts").BeginArray();
+        for (const auto& [nt, row] : table) {
+            for (const auto& [symbol, prods] : row) {
+                if (prods.size() < 2) {
+                    continue;
+                }
+                json.BeginObject();
+                json.Key("non_terminal").Value(nt);
+                json.Key("terminal").Value(symbol);
+                json.Key("productions").BeginArray();
+                for (const production& prod : prods) {
+                    json.Strings(prod);
+                }
+                json.EndArray();
+                json.EndObject();
+            }
+        }
+        json.EndArray();
+        json.EndObject();
     } else {
         std::cout << "LL(1) Table:\n";
         ll1.PrintTable();
     }
 }
 
+void Shell::CmdSLR1Table(const std::vector<std::string>& args) {
+    if (!args.empty()) {
+        std::cerr << RED << "pl-shell: slr does not accept arguments.\n"
+                  << RESET;
+        return;
+    }
+    if (grammar.g_.empty()) {
+        std::cerr << RED
+                  << "pl-shell: no grammar was loaded. Load one with load "
+                     "<filename>.\n"
+                  << RESET;
+        return;
+    }
+    if (format == Format::Text) {
+        std::cout << "SLR(1) Table:\n";
+        slr1.DebugActions();
+        if (!is_slr1) {
+            PrintSLR1Conflicts(slr1);
+        }
+        return;
+    }
+
+    // Rules are numbered as in the generated parsers: grouped by antecedent,
+    // in the order of SymbolIndex
+    const SymbolIndex index(slr1.gr_);
+    JsonWriter        json(result);
+    json.BeginObject();
+    json.Key("slr1").Value(is_slr1);
+    json.Key("rules").BeginArray();
+    for (size_t r = 0; r < index.rules_.size(); ++r) {
+        json.BeginObject();
+        json.Key("antecedent").Value(
+            index.non_terminals_[index.rules_[r].lhs_]);
+        json.Key("consequent").Strings(index.consequents_[r]);
+        json.EndObject();
+    }
+    json.EndArray();
+    json.Key("states").BeginArray();
+    for (unsigned st = 0; st < slr1.states_.size(); ++st) {
+        const auto actions     = slr1.actions_.find(st);
+        const auto transitions = slr1.transitions_.find(st);
+        json.BeginObject();
+        json.Key("action").BeginObject();
+        if (actions != slr1.actions_.end()) {
+            for (const auto& [symbol, action] : actions->second) {
+                json.Key(symbol);
+                switch (action.action) {
+                case SLR1Parser::Action::Accept:
+                    json.Value("accept");
+                    break;
+                case SLR1Parser::Action::Reduce:
+                    json.Value(
+                        "r" + std::to_string(index.RuleId(
+                                  action.item->antecedent_,
+                                  action.item->consequent_)));
+                    break;
+                case SLR1Parser::Action::Shift:
+                    json.Value("s" +
+                               std::to_string(transitions->second.at(symbol)));
+                    break;
+                default:
+                    json.Value("");
+                }
+            }
+        }
+        json.EndObject();
+        json.Key("goto").BeginObject();
+        if (transitions != slr1.transitions_.end()) {
+            for (const auto& [symbol, target] : transitions->second) {
+                if (!slr1.gr_.st_.IsTerminal(symbol)) {
+                    json.Key(symbol).Value(target);
+                }
+            }
+        }
+        json.EndObject();
+        json.EndObject();
+    }
+    json.EndArray();
+    json.Key("conflicts").BeginArray();
+    for (const SLR1Parser::Conflict& c : slr1.Conflicts()) {
+        json.BeginObject();
+        json.Key("state").Value(c.state);
+        json.Key("symbol").Value(c.symbol);
+        json.Key("kind").Value(ConflictKind(c.kind));
+        json.Key("items").BeginArray();
+        for (const Lr0Item& item : c.items) {
+            json.Value(item.ToString());
+        }
+        json.EndArray();
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+}
+
+void Shell::CmdSets(const std::vector<std::string>& args) {
+    if (!args.empty()) {
+        std::cerr << RED << "pl-shell: sets does not accept arguments.\n"
+                  << RESET;
+        return;
+    }
+    if (grammar.g_.empty()) {
+        std::cerr << RED
+                  << "pl-shell: no grammar was loaded. Load one with load "
+                     "<filename>.\n"
+                  << RESET;
+        return;
+    }
+    const std::vector<std::string> non_terminals{
+        Sorted(grammar.st_.non_terminals_)};
+    if (format == Format::Json) {
+        JsonWriter json(result);
+        json.BeginObject();
+        json.Key("first").BeginObject();
+        for (const std::string& nt : non_terminals) {
+            json.Key(nt).Strings(Sorted(ll1.first_sets_[nt]));
+        }
+        json.EndObject();
+        json.Key("follow").BeginObject();
+        for (const std::string& nt : non_terminals) {
+            json.Key(nt).Strings(Sorted(ll1.follow_sets_[nt]));
+        }
+        json.EndObject();
+        json.EndObject();
+        return;
+    }
+    tabulate::Table table;
+    table.add_row({"Non terminal", "FIRST", "FOLLOW"});
+    for (const std::string& nt : non_terminals) {
+        std::string first;
+        std::string follow;
+        for (const std::string& s : Sorted(ll1.first_sets_[nt])) {
+            first += s + " ";
+        }
+        for (const std::string& s : Sorted(ll1.follow_sets_[nt])) {
+            follow += s + " ";
+        }
+        table.add_row({nt, first, follow});
+    }
+    table.format().font_align(tabulate::FontAlign::center);
+    table.column(0).format().font_color(tabulate::Color::cyan);
+    table.row(0).format().font_color(tabulate::Color::magenta);
+    std::cout << table << std::endl;
+}
+
 void Shell::CmdAllLRItems(const std::vector<std::string>& args) {
     if (args.size() > 1) {
         std::cerr << RED << "pl-shell: only 1 argument at most can be given.\n"
@@ -680,6 +1664,69 @@ void Shell::CmdCanonicalCollection(const std::vector<std::string>& args) {
     }
 }
 
+void Shell::CmdTableStats(const std::vector<std::string>& args) {
+    if (!args.empty()) {
+        std::cerr << RED << "pl-shell: tablestats does not accept arguments.\n"
+                  << RESET;
+        return;
+    }
+    if (grammar.g_.empty()) {
+        std::cerr << RED
+                  << "pl-shell: no grammar was loaded. Load one with load "
+                     "<filename>.\n"
+                  << RESET;
+        return;
+    }
+    std::cout << "LL(1) table:\n";
+    ll1.DebugTableStats();
+    std::cout << "SLR(1) tables:\n";
+    slr1.DebugTableStats();
+}
+
+void Shell::CmdCodegen(const std::vector<std::string>& args) {
+    if (args.size() != 2) {
+        std::cerr << RED << "pl-shell: usage: codegen <slr|ll1> <out.cpp>\n"
+                  << RESET;
+        return;
+    }
+    if (grammar.g_.empty()) {
+        std::cerr << RED
+                  << "pl-shell: no grammar was loaded. Load one with load "
+                     "<filename>.\n"
+                  << RESET;
+        return;
+    }
+    const std::string& kind = args[0];
+    const std::string& out  = args[1];
+    if (kind == "slr") {
+        if (slr1.table_.n_states_ == 0) {
+            std::cerr << RED << "pl-shell: grammar is not SLR(1).\n" << RESET;
+            return;
+        }
+        if (!codegen::WriteSLR1Parser(slr1, out)) {
+            std::cerr << RED << "pl-shell: could not write " << out << ".\n"
+                      << RESET;
+            return;
+        }
+    } else if (kind == "ll1") {
+        if (!ll1.CreateLL1Table()) {
+            std::cerr << RED << "pl-shell: grammar is not LL(1).\n" << RESET;
+            return;
+        }
+        if (!codegen::WriteLL1Parser(ll1, out)) {
+            std::cerr << RED << "pl-shell: could not write " << out << ".\n"
+                      << RESET;
+            return;
+        }
+    } else {
+        std::cerr << RED << "pl-shell: unknown parser kind '" << kind
+                  << "'. Options are: slr, ll1.\n"
+                  << RESET;
+        return;
+    }
+    std::cout << GREEN "✔ " << RESET << "Parser written to " << out << "\n";
+}
+
 void Shell::PrintSet(const std::unordered_set<std::string>& set) {
     std::cout << "{ ";
     for (const std::string& str : set) {
@@ -714,4 +1761,375 @@ size_t Shell::LevenshteinDistance(const std::string& w1,
         }
     }
     return dp[size_w1][size_w2];
-}
\ No newline at end of file
+}
+void Shell::CmdStats(const std::vector<std::string>& args) {
+    if (args.size() > 1) {
+        std::cerr << RED << "pl-shell: usage: stats [on|off|reset]\n" << RESET;
+        return;
+    }
+    if (args.size() == 1) {
+        if (args[0] == "on") {
+            stats::enabled      = true;
+            stats::heap_enabled = true;
+            std::cout << GREEN "✔ " << RESET
+                      << "Phase statistics enabled. Load a grammar to collect "
+                         "them.\n";
+        } else if (args[0] == "off") {
+            stats::enabled      = false;
+            stats::heap_enabled = false;
+            std::cout << GREEN "✔ " << RESET
+                      << "Phase statistics disabled.\n";
+        } else if (args[0] == "reset") {
+            stats::Reset();
+            std::cout << GREEN "✔ " << RESET
+                      << "Phase statistics reset.\n";
+        } else {
+            std::cerr << RED << "pl-shell: unknown option '" << args[0]
+                      << "'. Options are: on, off, reset.\n"
+                      << RESET;
+        }
+        return;
+    }
+
+    const bool collected = std::any_of(
+        stats::counters.begin(), stats::counters.end(),
+        [](const stats::Counters& c) { return c.calls > 0; });
+    if (!collected) {
+        std::cout << "No statistics were collected"
+                  << (stats::Enabled() ? ".\n"
+                                       : ". Enable them with 'stats on'.\n");
+        return;
+    }
+    stats::Print(std::cout);
+    std::cout << "Iterations are fixed-point rounds for FIRST and FOLLOW, "
+                 "rounds for closure and states for the canonical "
+                 "collection. Nested phases are included in the time of "
+                 "their parent.\n";
+}
+
+void Shell::CmdTrace(const std::vector<std::string>& args) {
+    if (args.size() == 2 && args[0] == "on") {
+        if (!trace::Start(args[1])) {
+            std::cerr << RED << "pl-shell: already tracing to '"
+                      << trace::Path() << "'.\n"
+                      << RESET;
+            return;
+        }
+        std::cout << GREEN "✔ " << RESET << "Tracing to '" << args[1]
+                  << "'. Run 'trace off' to write it.\n";
+    } else if (args.size() == 1 && args[0] == "off") {
+        if (!trace::Enabled()) {
+            std::cerr << RED << "pl-shell: tracing is not on.\n" << RESET;
+            return;
+        }
+        const size_t recorded = trace::Recorded();
+        const size_t dropped  = trace::Dropped();
+        if (!trace::Stop()) {
+            std::cerr << RED << "pl-shell: could not write '"
+                      << trace::Path() << "'.\n"
+                      << RESET;
+            return;
+        }
+        std::cout << GREEN "✔ " << RESET << "Trace written to '"
+                  << trace::Path() << "' (" << recorded - dropped
+                  << " events";
+        if (dropped > 0) {
+            std::cout << ", " << dropped << " oldest events dropped";
+        }
+        std::cout << "). Open it with chrome://tracing or Perfetto.\n";
+    } else {
+        std::cerr << RED << "pl-shell: usage: trace on <file> | trace off\n"
+                  << RESET;
+    }
+}
+
+void Shell::CmdAnalyze(const std::vector<std::string>& args) {
+    std::string             dir;
+    unsigned                jobs = 0;
+    po::options_description desc("Options");
+    desc.add_options()("help,h", "Show help message and exit")(
+        "dir", po::value<std::string>(&dir)->required(),
+        "Directory with the grammar files (*.txt)")(
+        "jobs,j", po::value<unsigned>(&jobs)->default_value(0),
+        "Number of threads, 0 for one per hardware thread");
+    po::positional_options_description pos;
+    pos.add("dir", 1);
+
+    std::vector<analysis::GrammarReport> reports;
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        po::variables_map vm;
+        po::store(
+            po::command_line_parser(args).options(desc).positional(pos).run(),
+            vm);
+        if (vm.count("help")) {
+            std::cout << "Usage: analyze [options] <dir>\n";
+            std::cout << "Check every grammar of a directory for LL(1) and "
+                         "SLR(1) on a thread pool.\n";
+            std::cout << desc << "\n";
+            return;
+        }
+        po::notify(vm);
+        if (!std::filesystem::is_directory(dir)) {
+            std::cerr << RED << "pl-shell: '" << dir
+                      << "' is not a directory.\n"
+                      << RESET;
+            return;
+        }
+        reports = analysis::AnalyzeDirectory(dir, jobs);
+    } catch (const std::exception& e) {
+        std::cerr << RED << "pl-shell: " << e.what() << "\n" << RESET;
+        return;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    const unsigned threads =
+        jobs ? jobs : std::max(1u, std::thread::hardware_concurrency());
+    size_t n_ll1 = 0, n_slr1 = 0, n_errors = 0;
+    for (const analysis::GrammarReport& r : reports) {
+        n_ll1 += r.ll1;
+        n_slr1 += r.slr1;
+        n_errors += !r.error.empty();
+    }
+
+    if (format == Format::Json) {
+        JsonWriter json(result);
+        json.BeginObject();
+        json.Key("directory").Value(dir);
+        json.Key("threads").Value(threads);
+        json.Key("wall_ms").Value(ms);
+        json.Key("grammars").BeginArray();
+        for (const analysis::GrammarReport& r : reports) {
+            json.BeginObject();
+            json.Key("path").Value(r.path);
+            if (!r.error.empty()) {
+                json.Key("error").Value(r.error);
+                json.EndObject();
+                continue;
+            }
+            json.Key("non_terminals").Value(r.non_terminals);
+            json.Key("terminals").Value(r.terminals);
+            json.Key("rules").Value(r.rules);
+            json.Key("ll1").Value(r.ll1);
+            json.Key("ll1_conflicts").Value(r.ll1_conflicts);
+            json.Key("slr1").Value(r.slr1);
+            json.Key("states").Value(r.states);
+            json.Key("slr1_conflicts").Value(r.slr1_conflicts);
+            json.Key("load_ms").Value(r.load_ms);
+            json.Key("ll1_ms").Value(r.ll1_ms);
+            json.Key("slr1_ms").Value(r.slr1_ms);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.Key("summary").BeginObject();
+        json.Key("grammars").Value(reports.size());
+        json.Key("ll1").Value(n_ll1);
+        json.Key("slr1").Value(n_slr1);
+        json.Key("errors").Value(n_errors);
+        json.EndObject();
+        json.EndObject();
+        return;
+    }
+
+    tabulate::Table table;
+    table.add_row({"Grammar", "Rules", "LL(1)", "LL(1) conflicts", "SLR(1)",
+                   "States", "SLR(1) conflicts", "Time (ms)"});
+    for (const analysis::GrammarReport& r : reports) {
+        const std::string name =
+            std::filesystem::path(r.path).filename().string();
+        if (!r.error.empty()) {
+            table.add_row({name, "-", "-", "-", "-", "-", "-", "-"});
+            continue;
+        }
+        std::ostringstream time;
+        time << std::fixed << std::setprecision(3)
+             << r.load_ms + r.ll1_ms + r.slr1_ms;
+        table.add_row({name, std::to_string(r.rules), r.ll1 ? "yes" : "no",
+                       std::to_string(r.ll1_conflicts), r.slr1 ? "yes" : "no",
+                       std::to_string(r.states),
+                       std::to_string(r.slr1_conflicts), time.str()});
+    }
+    table.format().font_align(tabulate::FontAlign::center);
+    table.column(0).format().font_color(tabulate::Color::cyan);
+    table.row(0).format().font_color(tabulate::Color::magenta);
+    std::cout << table << std::endl;
+    for (const analysis::GrammarReport& r : reports) {
+        if (!r.error.empty()) {
+            std::cout << YELLOW << r.path << ": " << r.error << "\n" << RESET;
+        }
+    }
+    std::ostringstream wall;
+    wall << std::fixed << std::setprecision(3) << ms;
+    std::cout << GREEN "✔ " << RESET << reports.size()
+              << " grammars analyzed in " << wall.str() << " ms on " << threads
+              << " threads: " << n_ll1 << " LL(1), " << n_slr1 << " SLR(1), "
+              << n_errors << " could not be loaded.\n";
+}
+
+void Shell::CmdUnitBypass(const std::vector<std::string>& args) {
+    if (args.size() != 1 || (args[0] != "on" && args[0] != "off")) {
+        std::cerr << RED << "pl-shell: usage: unitbypass on|off\n" << RESET;
+        return;
+    }
+    unit_bypass             = args[0] == "on";
+    slr1.bypass_unit_rules_ = unit_bypass;
+    if (!unit_bypass) {
+        if (is_slr1) {
+            slr1.BuildFlatTable();
+        }
+        std::cout << GREEN "✔ " << RESET
+                  << "Unit rules are reduced by the SLR(1) tables.\n";
+        return;
+    }
+    std::cout << GREEN "✔ " << RESET
+              << "The SLR(1) tables skip the reductions of unit rules. Parses "
+                 "no longer have their nodes.\n";
+    if (is_slr1) {
+        slr1.BuildFlatTable();
+        std::cout << slr1.unit_bypasses_
+                  << " goto entries of the loaded grammar skip a unit "
+                     "rule.\n";
+    }
+}
+
+void Shell::CmdCounterexamples(const std::vector<std::string>& args) {
+    unsigned                budget = 2000;
+    po::options_description desc("Options");
+    desc.add_options()("help,h", "Show help message and exit")(
+        "budget,b", po::value<unsigned>(&budget)->default_value(2000),
+        "Milliseconds for the searches of unifying examples");
+    try {
+        po::variables_map vm;
+        po::store(po::command_line_parser(args).options(desc).run(), vm);
+        if (vm.count("help")) {
+            std::cout << "Usage: counterexamples [options]\n";
+            std::cout << "Show an example sentence of every LL(1) and SLR(1) "
+                         "conflict, and whether it is ambiguous.\n";
+            std::cout << desc << "\n";
+            return;
+        }
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << RED << "pl-shell: " << e.what() << "\n" << RESET;
+        return;
+    }
+    if (grammar.g_.empty()) {
+        std::cerr << RED
+                  << "pl-shell: no grammar was loaded. Load one with load "
+                     "<filename>.\n"
+                  << RESET;
+        return;
+    }
+
+    // Both parsers share the budget: the SLR(1) searches get what the LL(1)
+    // ones left
+    using Clock          = std::chrono::steady_clock;
+    const auto start     = Clock::now();
+    const auto budget_ms = std::chrono::milliseconds(budget);
+    std::map<std::pair<std::string, std::string>, counterexample::Example>
+        ll1_examples;
+    if (!is_ll1) {
+        counterexample::Finder finder(ll1.gr_, ll1.first_sets_, budget_ms);
+        for (const auto& [nt, row] : ll1.ll1_t_) {
+            for (const auto& [symbol, prods] : row) {
+                if (prods.size() > 1) {
+                    ll1_examples[{nt, symbol}] =
+                        finder.Find(nt, symbol, prods[0], prods[1]);
+                }
+            }
+        }
+    }
+    const std::vector<SLR1Parser::Conflict> conflicts = slr1.Conflicts();
+    std::vector<counterexample::Example>    slr1_examples;
+    if (!is_slr1) {
+        const auto left = std::max(
+            budget_ms - std::chrono::duration_cast<std::chrono::milliseconds>(
+                            Clock::now() - start),
+            std::chrono::milliseconds(0));
+        counterexample::Finder finder(slr1.gr_, slr1.first_sets_, left);
+        for (const SLR1Parser::Conflict& c : conflicts) {
+            slr1_examples.push_back(finder.Find(slr1, c));
+        }
+    }
+
+    const std::string& eol = grammar.st_.EOL_;
+    if (format == Format::Json) {
+        JsonWriter json(result);
+        json.BeginObject();
+        json.Key("ll1").BeginArray();
+        for (const auto& [cell, example] : ll1_examples) {
+            json.BeginObject();
+            json.Key("non_terminal").Value(cell.first);
+            json.Key("symbol").Value(cell.second);
+            WriteCounterexample(json, example, eol);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.Key("slr1").BeginArray();
+        for (size_t i = 0; i < slr1_examples.size(); ++i) {
+            const SLR1Parser::Conflict& c = conflicts[i];
+            json.BeginObject();
+            json.Key("state").Value(c.state);
+            json.Key("symbol").Value(c.symbol);
+            json.Key("kind").Value(ConflictKind(c.kind));
+            WriteCounterexample(json, slr1_examples[i], eol);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.EndObject();
+        return;
+    }
+
+    if (is_ll1 && is_slr1) {
+        std::cout << GREEN "✔ " << RESET
+                  << "The grammar is LL(1) and SLR(1), there are no "
+                     "conflicts.\n";
+        return;
+    }
+    if (!ll1_examples.empty()) {
+        std::cout << YELLOW << "LL(1) conflicts:\n" << RESET;
+    }
+    for (const auto& [cell, example] : ll1_examples) {
+        std::cout << "  " << cell.first << ", " << cell.second << ":\n";
+        PrintCounterexample(example, eol);
+    }
+    if (!slr1_examples.empty()) {
+        std::cout << YELLOW << "SLR(1) conflicts:\n" << RESET;
+    }
+    for (size_t i = 0; i < slr1_examples.size(); ++i) {
+        const SLR1Parser::Conflict& c = conflicts[i];
+        std::cout << "  State " << c.state << ", " << c.symbol << ": "
+                  << ConflictKind(c.kind) << "\n";
+        PrintCounterexample(slr1_examples[i], eol);
+    }
+}
+
+void Shell::CmdThreads(const std::vector<std::string>& args) {
+    if (args.size() > 1) {
+        std::cerr << RED << "pl-shell: usage: threads [n]\n" << RESET;
+        return;
+    }
+    if (args.empty()) {
+        std::cout << "The canonical collection is built on " << threads
+                  << (threads == 1 ? " thread.\n" : " threads.\n");
+        return;
+    }
+    unsigned n = 0;
+    try {
+        size_t end = 0;
+        n          = std::stoul(args[0], &end);
+        if (end != args[0].size()) {
+            throw std::invalid_argument(args[0]);
+        }
+    } catch (const std::exception&) {
+        std::cerr << RED << "pl-shell: '" << args[0]
+                  << "' is not a number of threads.\n"
+                  << RESET;
+        return;
+    }
+    threads = n ? n : std::max(1u, std::thread::hardware_concurrency());
+    std::cout << GREEN "✔ " << RESET
+              << "The canonical collection of the next loads will be built on "
+              << threads << (threads == 1 ? " thread.\n" : " threads.\n");
+}
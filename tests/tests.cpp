@@ -1,6 +1,24 @@
+#include "../include/arena.hpp"
+#include "../include/counterexample.hpp"
+#include "../include/ct_grammar.hpp"
+#include "../include/first_follow.hpp"
 #include "../include/grammar.hpp"
+#include "../include/grammar_factory.hpp"
+#include "../include/json_writer.hpp"
 #include "../include/ll1_parser.hpp"
+#include "../include/slr1_parser.hpp"
+#include "../include/stats.hpp"
+#include "../include/thread_pool.hpp"
+#include "../include/trace.hpp"
 #include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
 #include <gtest/gtest.h>
 
 void SortProductions(Grammar& grammar) {
@@ -749,6 +767,1393 @@ TEST(LL1__Test, AllFollowSets2) {
     EXPECT_EQ(result, expected);
 }
 
+Grammar ExpressionGrammar() {
+    Grammar g;
+    g.st_.PutSymbol("S");
+    g.st_.PutSymbol("E");
+    g.st_.PutSymbol("T");
+    g.st_.PutSymbol("plus", "+");
+    g.st_.PutSymbol("ap", "(");
+    g.st_.PutSymbol("cp", ")");
+    g.st_.PutSymbol("n", "n");
+
+    g.axiom_ = "S";
+
+    g.AddProduction("S", {"E", g.st_.EOL_});
+    g.AddProduction("E", {"E", "plus", "T"});
+    g.AddProduction("E", {"T"});
+    g.AddProduction("T", {"ap", "E", "cp"});
+    g.AddProduction("T", {"n"});
+    return g;
+}
+
+std::vector<int> Tokens(const SymbolIndex&             index,
+                        const std::vector<std::string>& input) {
+    std::vector<int> tokens;
+    for (const std::string& t : input) {
+        tokens.push_back(index.TerminalId(t));
+    }
+    return tokens;
+}
+
+TEST(SLR1__Test, PackedTableMatchesDenseTable) {
+    SLR1Parser slr1(ExpressionGrammar());
+    ASSERT_TRUE(slr1.MakeParser());
+
+    const LRTable& table = slr1.table_;
+    for (unsigned st = 0; st < table.n_states_; ++st) {
+        for (unsigned t = 0; t < table.n_terminals_; ++t) {
+            const int dense = table.DenseAction(st, t);
+            if (dense != LRTable::kError) {
+                EXPECT_EQ(table.Action(st, t), dense);
+            }
+        }
+        for (unsigned nt = 0; nt < table.n_non_terminals_; ++nt) {
+            EXPECT_EQ(table.Goto(st, nt), table.DenseGoto(st, nt));
+        }
+    }
+    EXPECT_LE(table.PackedBytes(), table.DenseBytes() + 64);
+}
+
+TEST(SLR1__Test, FlatTableParse) {
+    SLR1Parser slr1(ExpressionGrammar());
+    ASSERT_TRUE(slr1.MakeParser());
+
+    const SymbolIndex& index = slr1.index_;
+    EXPECT_TRUE(slr1.table_.Parse(Tokens(index, {"n"})));
+    EXPECT_TRUE(slr1.table_.Parse(
+        Tokens(index, {"n", "plus", "ap", "n", "plus", "n", "cp"})));
+    EXPECT_FALSE(slr1.table_.Parse(Tokens(index, {"n", "plus"})));
+    EXPECT_FALSE(slr1.table_.Parse(Tokens(index, {"ap", "n"})));
+    EXPECT_FALSE(slr1.table_.Parse(Tokens(index, {"n", "n"})));
+}
+
+TEST(SLR1__Test, UnitRuleBypassSkipsChainReductions) {
+    // E -> E plus T | T, T -> T times F | F, F -> ap E cp | n
+    Grammar g = ExpressionGrammar();
+    g.st_.PutSymbol("F");
+    g.st_.PutSymbol("times", "*");
+    g.g_["T"] = {{"T", "times", "F"}, {"F"}};
+    g.g_["F"] = {{"ap", "E", "cp"}, {"n"}};
+
+    SLR1Parser plain(g);
+    SLR1Parser bypass(g);
+    bypass.bypass_unit_rules_ = true;
+    ASSERT_TRUE(plain.MakeParser());
+    ASSERT_TRUE(bypass.MakeParser());
+    EXPECT_EQ(plain.unit_bypasses_, 0u);
+    EXPECT_GT(bypass.unit_bypasses_, 0u);
+
+    const std::vector<std::vector<std::string>> inputs{
+        {"n"},
+        {"n", "times", "n", "plus", "n"},
+        {"ap", "n", "plus", "n", "cp", "times", "n"},
+        {"n", "plus"},
+        {"n", "times", "times", "n"},
+        {"ap", "n", "cp", "cp"}};
+    for (const std::vector<std::string>& input : inputs) {
+        const std::vector<int> tokens = Tokens(plain.index_, input);
+        LRTable::ParseStats    before;
+        LRTable::ParseStats    after;
+        const bool             accepted = plain.table_.Parse(tokens, &before);
+        EXPECT_EQ(bypass.table_.Parse(tokens, &after), accepted);
+        if (accepted) {
+            // Every F is reduced to T directly in F's goto
+            EXPECT_LT(after.reductions, before.reductions);
+            EXPECT_EQ(after.shifts, before.shifts);
+        }
+    }
+}
+
+TEST(TableCompression__Test, ClassTableMergesRowsAndColumns) {
+    // Columns 0 and 2 are identical, and so are rows 0 and 2
+    const std::vector<int> dense{1, 5, 1, 0,  //
+                                 2, 5, 2, 7,  //
+                                 1, 5, 1, 0};
+    ClassTable table(dense, 3, 4);
+
+    EXPECT_EQ(table.n_col_classes_, 3u);
+    EXPECT_EQ(table.n_row_classes_, 2u);
+    for (unsigned r = 0; r < 3; ++r) {
+        for (unsigned c = 0; c < 4; ++c) {
+            EXPECT_EQ(table.Lookup(r, c), dense[r * 4 + c]);
+        }
+    }
+}
+
+TEST(TableCompression__Test, LL1AndSLR1ClassTables) {
+    Grammar g;
+    g.st_.PutSymbol("S");
+    g.st_.PutSymbol("E");
+    g.st_.PutSymbol("E'");
+    g.st_.PutSymbol("T");
+    g.st_.PutSymbol("+", "+");
+    g.st_.PutSymbol("(", "(");
+    g.st_.PutSymbol(")", ")");
+    g.st_.PutSymbol("n", "n");
+    g.st_.PutSymbol(g.st_.EPSILON_, g.st_.EPSILON_);
+
+    g.axiom_ = "S";
+
+    g.AddProduction("S", {"E", g.st_.EOL_});
+    g.AddProduction("E", {"T", "E'"});
+    g.AddProduction("E'", {"+", "T", "E'"});
+    g.AddProduction("E'", {g.st_.EPSILON_});
+    g.AddProduction("T", {"(", "E", ")"});
+    g.AddProduction("T", {"n"});
+
+    LL1Parser ll1(g);
+    ASSERT_TRUE(ll1.CreateLL1Table());
+    for (const auto& [nt, row] : ll1.ll1_t_) {
+        for (const auto& [symbol, prods] : row) {
+            EXPECT_EQ(ll1.Predict(ll1.index_.NonTerminalId(nt),
+                                  ll1.index_.TerminalId(symbol)),
+                      ll1.index_.RuleId(nt, prods[0]));
+        }
+    }
+    EXPECT_EQ(ll1.Predict(ll1.index_.NonTerminalId("T"),
+                          ll1.index_.TerminalId("+")),
+              -1);
+
+    SLR1Parser slr1(ExpressionGrammar());
+    ASSERT_TRUE(slr1.MakeParser());
+    const LRTable& table = slr1.table_;
+    for (unsigned st = 0; st < table.n_states_; ++st) {
+        for (unsigned t = 0; t < table.n_terminals_; ++t) {
+            EXPECT_EQ(table.ClassAction(st, t), table.DenseAction(st, t));
+        }
+        for (unsigned nt = 0; nt < table.n_non_terminals_; ++nt) {
+            EXPECT_EQ(table.ClassGoto(st, nt), table.DenseGoto(st, nt));
+        }
+    }
+}
+
+// Same grammars as ExpressionGrammar and LL1AndSLR1ClassTables, with the ids
+// that SymbolIndex assigns to their symbols
+namespace ct_expr {
+enum Tok { EOL, AP, CP, N, PLUS };
+enum Var { S, E, T };
+constexpr ct::Grammar<5, 3, 5, 3> kGrammar{{{
+    {S, {ct::Nt(E), EOL}},
+    {E, {ct::Nt(E), PLUS, ct::Nt(T)}},
+    {E, {ct::Nt(T)}},
+    {T, {AP, ct::Nt(E), CP}},
+    {T, {N}},
+}}};
+static_assert(ct::kSLR1<kGrammar>.Parse(std::vector<int>{N, PLUS, AP, N, CP}));
+static_assert(!ct::kSLR1<kGrammar>.Parse(std::vector<int>{N, PLUS}));
+} // namespace ct_expr
+
+namespace ct_ll1 {
+enum Tok { EOL, AP, CP, PLUS, N };
+enum Var { S, E, E1, T };
+constexpr ct::Grammar<5, 4, 6, 3> kGrammar{{{
+    {S, {ct::Nt(E), EOL}},
+    {E, {ct::Nt(T), ct::Nt(E1)}},
+    {E1, {PLUS, ct::Nt(T), ct::Nt(E1)}},
+    {E1, {}},
+    {T, {AP, ct::Nt(E), CP}},
+    {T, {N}},
+}}};
+static_assert(ct::kLL1<kGrammar>.Parse(std::vector<int>{AP, N, PLUS, N, CP}));
+static_assert(!ct::kLL1<kGrammar>.Parse(std::vector<int>{N, PLUS}));
+} // namespace ct_ll1
+
+TEST(CompileTime__Test, SLR1MatchesRuntimeTables) {
+    using namespace ct_expr;
+    SLR1Parser slr1(ExpressionGrammar());
+    ASSERT_TRUE(slr1.MakeParser());
+    constexpr auto& table = ct::kSLR1<kGrammar>;
+    EXPECT_EQ(table.kStates, slr1.states_.size());
+
+    const std::vector<std::vector<int>> inputs{
+        {N}, {N, PLUS, AP, N, PLUS, N, CP}, {N, PLUS}, {AP, N}, {N, N}, {}};
+    for (const std::vector<int>& input : inputs) {
+        EXPECT_EQ(table.Parse(input), slr1.table_.Parse(input));
+    }
+}
+
+TEST(CompileTime__Test, LL1MatchesRuntimeTable) {
+    using namespace ct_ll1;
+    Grammar g;
+    g.st_.PutSymbol("S");
+    g.st_.PutSymbol("E");
+    g.st_.PutSymbol("E'");
+    g.st_.PutSymbol("T");
+    g.st_.PutSymbol("+", "+");
+    g.st_.PutSymbol("(", "(");
+    g.st_.PutSymbol(")", ")");
+    g.st_.PutSymbol("n", "n");
+    g.st_.PutSymbol(g.st_.EPSILON_, g.st_.EPSILON_);
+
+    g.axiom_ = "S";
+
+    g.AddProduction("S", {"E", g.st_.EOL_});
+    g.AddProduction("E", {"T", "E'"});
+    g.AddProduction("E'", {"+", "T", "E'"});
+    g.AddProduction("E'", {g.st_.EPSILON_});
+    g.AddProduction("T", {"(", "E", ")"});
+    g.AddProduction("T", {"n"});
+
+    LL1Parser ll1(g);
+    ASSERT_TRUE(ll1.CreateLL1Table());
+    const SymbolIndex& index     = ll1.index_;
+    const int          terminals = index.terminals_.size();
+    constexpr auto&    table     = ct::kLL1<kGrammar>;
+    for (unsigned nt = 0; nt < index.non_terminals_.size(); ++nt) {
+        for (int t = 0; t < terminals; ++t) {
+            const int expected = ll1.Predict(nt, t);
+            const int rule     = table.Predict(nt, t);
+            ASSERT_EQ(rule < 0, expected < 0);
+            if (rule < 0) {
+                continue;
+            }
+            std::vector<int> body;
+            for (int s : index.rules_[expected].rhs_) {
+                body.push_back(s < terminals ? s : ct::Nt(s - terminals));
+            }
+            const auto& ct_rule = table.rules[rule];
+            EXPECT_EQ(body, std::vector<int>(ct_rule.rhs.begin(),
+                                             ct_rule.rhs.begin() +
+                                                 ct_rule.length));
+        }
+    }
+}
+
+TEST(GrammarFactory__Test, GenerateIsDeterministic) {
+    GrammarFactory         factory;
+    GrammarFactory::Params params;
+    params.non_terminals = 50;
+    params.rules         = 120;
+
+    Grammar a = factory.Generate(params);
+    Grammar b = factory.Generate(params);
+    EXPECT_EQ(a.g_, b.g_);
+    EXPECT_EQ(a.order, b.order);
+
+    params.seed = 7;
+    Grammar c   = factory.Generate(params);
+    EXPECT_NE(a.g_, c.g_);
+}
+
+TEST(GrammarFactory__Test, GenerateScales) {
+    GrammarFactory         factory;
+    GrammarFactory::Params params;
+    params.non_terminals  = 10000;
+    params.terminals      = 100;
+    params.rules          = 30000;
+    params.nullable_ratio = 0.2;
+
+    Grammar gr = factory.Generate(params);
+    EXPECT_EQ(gr.g_.size(), 10001u);
+    EXPECT_EQ(gr.st_.non_terminals_.size(), 10001u);
+    EXPECT_FALSE(factory.HasUnreachableSymbols(gr));
+    EXPECT_FALSE(factory.IsInfinite(gr));
+    EXPECT_FALSE(factory.HasDirectLeftRecursion(gr));
+
+    size_t rules = 0;
+    for (const auto& [nt, productions] : gr.g_) {
+        rules += productions.size();
+    }
+    EXPECT_LE(rules, 30001u);
+    EXPECT_GT(rules, 29000u);
+}
+
+TEST(GrammarFactory__Test, KeyedGrammarsAreSLR1) {
+    GrammarFactory::Params params;
+    params.non_terminals = 128;
+    params.terminals     = 24;
+    params.rules         = 384;
+    params.keyed         = true;
+    for (std::uint32_t seed : {1u, 2u, 3u}) {
+        params.seed = seed;
+        SLR1Parser slr1(GrammarFactory().Generate(params));
+        EXPECT_TRUE(slr1.MakeParser());
+        EXPECT_TRUE(slr1.conflicts_.empty());
+        EXPECT_FALSE(slr1.gr_.st_.terminals_.contains(slr1.gr_.st_.EPSILON_));
+    }
+}
+
+TEST(GrammarFactory__Test, LevelGrammars) {
+    GrammarFactory factory;
+    factory.Init();
+    for (int level = 1; level <= 7; ++level) {
+        Grammar gr = factory.PickOne(level);
+        EXPECT_EQ(gr.g_.size(), static_cast<size_t>(level) + 1);
+        EXPECT_FALSE(factory.HasUnreachableSymbols(gr));
+        EXPECT_FALSE(factory.IsInfinite(gr));
+    }
+
+    Grammar ll1 = factory.GenLL1Grammar(3);
+    EXPECT_TRUE(LL1Parser(ll1).CreateLL1Table());
+    Grammar slr1 = factory.GenSLR1Grammar(3);
+    EXPECT_TRUE(SLR1Parser(slr1).MakeParser());
+}
+
+/// Whether a non-terminal of the grammar can derive itself as first symbol
+/// through the first symbol of its rules.
+bool HasLeftCornerCycle(const Grammar& gr) {
+    for (const auto& [nt, productions] : gr.g_) {
+        std::vector<std::string>        pending{nt};
+        std::unordered_set<std::string> seen;
+        while (!pending.empty()) {
+            const std::string current = pending.back();
+            pending.pop_back();
+            for (const production& prod : gr.g_.at(current)) {
+                if (prod[0] == nt) {
+                    return true;
+                }
+                if (gr.g_.contains(prod[0]) && seen.insert(prod[0]).second) {
+                    pending.push_back(prod[0]);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+TEST(Transform__Test, IndirectLeftRecursionAndUnitRules) {
+    Grammar gr;
+    for (const std::string nt : {"S", "A", "B"}) {
+        gr.st_.PutSymbol(nt);
+        gr.order.push_back(nt);
+    }
+    for (const std::string t : {"a", "b", "c", "d"}) {
+        gr.st_.PutSymbol(t, t);
+    }
+    gr.axiom_ = "S";
+    gr.AddProduction("S", {"A", gr.st_.EOL_});
+    gr.AddProduction("A", {"B", "a"});
+    gr.AddProduction("A", {"b"});
+    gr.AddProduction("B", {"A", "c"});
+    gr.AddProduction("B", {"d"});
+
+    GrammarFactory factory;
+    factory.RemoveLeftRecursion(gr);
+    EXPECT_FALSE(HasLeftCornerCycle(gr));
+    EXPECT_EQ(gr.g_.at("A"), (std::vector<production>{{"B", "a"}, {"b"}}));
+    EXPECT_EQ(gr.g_.at("B"),
+              (std::vector<production>{{"b", "c", "B'"}, {"d", "B'"}}));
+    EXPECT_EQ(gr.g_.at("B'"),
+              (std::vector<production>{{"a", "c", "B'"}, {"EPSILON"}}));
+    EXPECT_EQ(gr.order, (std::vector<std::string>{"S", "A", "B", "B'"}));
+
+    // A and B derive each other through unit rules, so they are merged, and
+    // D is no longer used once C takes its rules
+    Grammar units;
+    for (const std::string nt : {"S", "A", "B", "C", "D"}) {
+        units.st_.PutSymbol(nt);
+        units.order.push_back(nt);
+    }
+    for (const std::string t : {"a", "b", "c", "d"}) {
+        units.st_.PutSymbol(t, t);
+    }
+    units.axiom_ = "S";
+    units.AddProduction("S", {"A", units.st_.EOL_});
+    units.AddProduction("A", {"B"});
+    units.AddProduction("A", {"a"});
+    units.AddProduction("B", {"A"});
+    units.AddProduction("B", {"C", "b"});
+    units.AddProduction("C", {"c"});
+    units.AddProduction("C", {"D"});
+    units.AddProduction("D", {"d"});
+    factory.RemoveUnitRules(units);
+    EXPECT_EQ(units.g_.size(), 3u);
+    EXPECT_EQ(units.g_.at("A"), (std::vector<production>{{"a"}, {"C", "b"}}));
+    EXPECT_EQ(units.g_.at("C"), (std::vector<production>{{"c"}, {"d"}}));
+    EXPECT_EQ(units.order, (std::vector<std::string>{"S", "A", "C"}));
+}
+
+TEST(Transform__Test, LargeGrammarRoundTrip) {
+    GrammarFactory::Params params;
+    params.non_terminals  = 2000;
+    params.terminals      = 20;
+    params.rules          = 6000;
+    params.nullable_ratio = 0.1;
+    GrammarFactory factory;
+    Grammar        gr = factory.Generate(params);
+
+    // Left recursive cycles through every four non-terminals, and rules
+    // with common prefixes
+    for (unsigned i = 0; i < params.non_terminals; ++i) {
+        const std::string next =
+            "N" + std::to_string(i % 4 == 3 ? i - 3 : i + 1);
+        gr.AddProduction("N" + std::to_string(i), {next, "t1"});
+        gr.AddProduction("N" + std::to_string(i), {"t2", "t3", next});
+        gr.AddProduction("N" + std::to_string(i), {"t2", "t3"});
+    }
+    ASSERT_TRUE(HasLeftCornerCycle(gr));
+
+    factory.RemoveLeftRecursion(gr);
+    factory.RemoveUnitRules(gr);
+    factory.LeftFactorize(gr);
+    EXPECT_FALSE(HasLeftCornerCycle(gr));
+    for (const auto& [nt, productions] : gr.g_) {
+        std::unordered_set<std::string> firsts;
+        for (const production& prod : productions) {
+            EXPECT_TRUE(firsts.insert(prod[0]).second) << nt;
+        }
+    }
+
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "plshell_transform.txt")
+            .string();
+    ASSERT_TRUE(gr.WriteToFile(path));
+    Grammar read;
+    ASSERT_TRUE(read.ReadFromFile(path));
+    std::filesystem::remove(path);
+    EXPECT_EQ(read.axiom_, gr.axiom_);
+    EXPECT_EQ(read.g_, gr.g_);
+    EXPECT_EQ(read.order, gr.order);
+}
+
+TEST(GrammarFactory__Test, PruneRemovesUselessSymbols) {
+    Grammar gr;
+    for (const std::string nt : {"S", "A", "B", "C", "D", "E", "G"}) {
+        gr.st_.PutSymbol(nt);
+        gr.order.push_back(nt);
+    }
+    for (const std::string t : {"a", "b", "c", "d", "e", "g"}) {
+        gr.st_.PutSymbol(t, t);
+    }
+    gr.axiom_ = "S";
+    gr.AddProduction("S", {"A", gr.st_.EOL_});
+    gr.AddProduction("A", {"a", "B"});
+    gr.AddProduction("A", {"C"});
+    gr.AddProduction("A", {"B", "G"});
+    gr.AddProduction("A", {"b"});
+    gr.AddProduction("B", {"B", "b"}); // never ends
+    gr.AddProduction("C", {"c", "D"});
+    gr.AddProduction("D", {"d"});
+    gr.AddProduction("E", {"e"}); // not used
+    gr.AddProduction("G", {"g"}); // only used after B
+
+    GrammarFactory factory;
+    EXPECT_TRUE(factory.HasUnreachableSymbols(gr));
+    EXPECT_TRUE(factory.IsInfinite(gr));
+
+    GrammarFactory::Pruned pruned = factory.Prune(gr);
+    EXPECT_FALSE(pruned.empty_language);
+    EXPECT_EQ(pruned.unproductive, std::vector<std::string>{"B"});
+    std::sort(pruned.unreachable.begin(), pruned.unreachable.end());
+    EXPECT_EQ(pruned.unreachable, (std::vector<std::string>{"E", "G"}));
+    EXPECT_EQ(pruned.rules, 5u);
+    EXPECT_EQ(gr.g_.at("A"), (std::vector<production>{{"C"}, {"b"}}));
+    EXPECT_EQ(gr.order, (std::vector<std::string>{"S", "A", "C", "D"}));
+    EXPECT_FALSE(gr.st_.In("B"));
+    EXPECT_FALSE(factory.HasUnreachableSymbols(gr));
+    EXPECT_FALSE(factory.IsInfinite(gr));
+    EXPECT_EQ(factory.Prune(gr).rules, 0u);
+
+    // Without productive rules for the axiom nothing is removed
+    Grammar empty;
+    empty.st_.PutSymbol("S");
+    empty.st_.PutSymbol("A");
+    empty.axiom_ = "S";
+    empty.AddProduction("S", {"A", empty.st_.EOL_});
+    empty.AddProduction("A", {"A"});
+    EXPECT_TRUE(factory.Prune(empty).empty_language);
+    EXPECT_EQ(empty.g_.size(), 2u);
+}
+
+TEST(Grammar__Test, EbnfSharesHelpers) {
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "plshell_ebnf.txt").string();
+    std::ofstream(path) << "terminal a a;\n"
+                           "terminal b b;\n"
+                           "terminal c c;\n"
+                           "start with S;\n"
+                           ";\n"
+                           "S -> A $;\n"
+                           "A -> (a b)* c | B;\n"
+                           "B -> c (a b)* | c+ b?;\n"
+                           ";\n";
+    Grammar gr;
+    ASSERT_TRUE(gr.ReadFromFile(path));
+
+    EXPECT_EQ(gr.g_.at("A"),
+              (std::vector<production>{{"A_star", "c"}, {"B"}}));
+    EXPECT_EQ(gr.g_.at("A_star"), (std::vector<production>{
+                                      {"a", "b", "A_star"}, {"EPSILON"}}));
+    EXPECT_EQ(gr.g_.at("B"),
+              (std::vector<production>{{"c", "A_star"},
+                                       {"c", "B_star", "B_opt"}}));
+    EXPECT_EQ(gr.g_.at("B_star"),
+              (std::vector<production>{{"c", "B_star"}, {"EPSILON"}}));
+    EXPECT_EQ(gr.g_.at("B_opt"), (std::vector<production>{{"b"}, {"EPSILON"}}));
+    EXPECT_EQ(gr.order, (std::vector<std::string>{"S", "A", "A_star", "B",
+                                                  "B_star", "B_opt"}));
+
+    // The desugared grammar is plain BNF and reads back the same
+    ASSERT_TRUE(gr.WriteToFile(path));
+    Grammar read;
+    ASSERT_TRUE(read.ReadFromFile(path));
+    EXPECT_EQ(read.g_, gr.g_);
+
+    std::ofstream(path) << "terminal a a;\n"
+                           "start with S;\n"
+                           ";\n"
+                           "S -> A $;\n"
+                           "A -> (a | *;\n"
+                           ";\n";
+    EXPECT_FALSE(Grammar().ReadFromFile(path));
+    std::filesystem::remove(path);
+}
+
+TEST(Grammar__Test, ParameterizedRulesAreInstantiatedOnce) {
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "plshell_macros.txt")
+            .string();
+    std::ofstream(path) << "terminal a a;\n"
+                           "terminal b b;\n"
+                           "terminal comma ,;\n"
+                           "start with S;\n"
+                           ";\n"
+                           "S -> list(A) $;\n"
+                           "A -> a sep_list(b, comma) | list(A) b;\n"
+                           "B -> sep_list(b, comma) option(list(a));\n"
+                           "list(X) -> X list(X);\n"
+                           "list(X) ->;\n"
+                           "sep_list(X, sep) -> X (sep X)*;\n"
+                           "option(X) -> X | ;\n"
+                           ";\n";
+    Grammar gr;
+    ASSERT_TRUE(gr.ReadFromFile(path));
+
+    EXPECT_EQ(gr.g_.at("S"), (std::vector<production>{{"list_A", "$"}}));
+    EXPECT_EQ(gr.g_.at("list_A"),
+              (std::vector<production>{{"A", "list_A"}, {"EPSILON"}}));
+    EXPECT_EQ(gr.g_.at("A"), (std::vector<production>{
+                                 {"a", "sep_list_b_comma"}, {"list_A", "b"}}));
+    EXPECT_EQ(gr.g_.at("sep_list_b_comma"),
+              (std::vector<production>{{"b", "sep_list_b_comma_star"}}));
+    EXPECT_EQ(gr.g_.at("B"), (std::vector<production>{
+                                 {"sep_list_b_comma", "option_list_a"}}));
+    EXPECT_EQ(gr.g_.at("option_list_a"),
+              (std::vector<production>{{"list_a"}, {"EPSILON"}}));
+    // One non-terminal per instantiation, and none for the rules themselves
+    EXPECT_EQ(gr.st_.non_terminals_.size(), 8);
+    EXPECT_FALSE(gr.st_.In("list"));
+
+    // Instances are plain non-terminals, so the grammar reads back the same
+    ASSERT_TRUE(gr.WriteToFile(path));
+    Grammar read;
+    ASSERT_TRUE(read.ReadFromFile(path));
+    EXPECT_EQ(read.g_, gr.g_);
+
+    // Wrong arity, a rule without arguments and arguments that never stop
+    // growing are errors
+    for (const char* rules : {"S -> list(a, a) $;\nlist(X) -> X;\n",
+                              "S -> list $;\nlist(X) -> X;\n",
+                              "S -> f(a) $;\nf(X) -> f(list(X));\n"
+                              "list(X) -> X;\n"}) {
+        std::ofstream(path) << "terminal a a;\nstart with S;\n;\n"
+                            << rules << ";\n";
+        EXPECT_FALSE(Grammar().ReadFromFile(path)) << rules;
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(Grammar__Test, ModulesAndCachedFirstSets) {
+    const std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / "plshell_modules";
+    std::filesystem::create_directories(dir);
+    auto write = [&](const std::string& file, const std::string& text) {
+        std::ofstream(dir / file) << text;
+    };
+    write("main.txt", "terminal semi ;;\n"
+                      "import \"expr.txt\";\n"
+                      "import \"list.txt\";\n"
+                      "start with S;\n"
+                      ";\n"
+                      "S -> L $;\n"
+                      "L -> expr.E semi L | list.I;\n"
+                      ";\n");
+    write("expr.txt", "terminal plus \\+;\n"
+                      "import \"atom.txt\";\n"
+                      ";\n"
+                      "E -> atom.A (plus atom.A)*;\n"
+                      ";\n");
+    write("atom.txt", "terminal n [0-9]+;\n"
+                      ";\n"
+                      "A -> n;\n"
+                      ";\n");
+    write("list.txt", "terminal comma ,;\n"
+                      ";\n"
+                      "I -> comma I;\n"
+                      "I ->;\n"
+                      ";\n");
+    const std::string main = (dir / "main.txt").string();
+
+    Grammar gr;
+    ASSERT_TRUE(gr.ReadFromFile(main));
+    ASSERT_EQ(gr.modules_.size(), 4u);
+    EXPECT_EQ(gr.g_.at("L"),
+              (std::vector<production>{{"expr.E", "semi", "L"}, {"list.I"}}));
+    EXPECT_EQ(gr.g_.at("expr.E"),
+              (std::vector<production>{{"atom.A", "expr.E_star"}}));
+    EXPECT_EQ(gr.ModuleOf("expr.E_star"), 1u);
+    EXPECT_EQ(gr.ModuleOf("L"), 0u);
+
+    first_follow::ModuleCache cache;
+    EXPECT_EQ(cache.First(gr), LL1Parser(gr).first_sets_);
+    EXPECT_EQ(cache.analyzed_.size(), 4u);
+    auto reload = [&] {
+        Grammar next;
+        EXPECT_TRUE(next.ReadFromFile(main));
+        const first_follow::SetMap first = cache.First(next);
+        EXPECT_EQ(first, LL1Parser(next).first_sets_);
+        std::vector<std::string> analyzed = cache.analyzed_;
+        std::sort(analyzed.begin(), analyzed.end());
+        return analyzed;
+    };
+    EXPECT_TRUE(reload().empty());
+
+    // Only the edited module and the files that import it are solved again
+    write("atom.txt", "terminal n [0-9]+;\n"
+                      "terminal ap \\(;\n"
+                      "terminal cp \\);\n"
+                      "import \"expr.txt\";\n"
+                      ";\n"
+                      "A -> n | ap expr.E cp;\n"
+                      ";\n");
+    EXPECT_EQ(reload(), (std::vector<std::string>{"", "atom", "expr", "list"}));
+    write("list.txt", "terminal comma ,;\n"
+                      ";\n"
+                      "I -> comma I | semi;\n"
+                      ";\n");
+    EXPECT_EQ(reload(), (std::vector<std::string>{"", "list"}));
+
+    // A module only sees the modules it imports
+    write("list.txt", "terminal comma ,;\n"
+                      ";\n"
+                      "I -> comma expr.E;\n"
+                      ";\n");
+    EXPECT_FALSE(Grammar().ReadFromFile(main));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Trace__Test, RingBufferKeepsNewestBalancedEvents) {
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "plshell_trace.json")
+            .string();
+    ASSERT_TRUE(trace::Start(path, 4));
+    EXPECT_FALSE(trace::Start(path));
+    {
+        trace::Scope outer("Outer");
+        for (int i = 0; i < 3; ++i) {
+            trace::Scope inner("Inner", i);
+        }
+    }
+    EXPECT_EQ(trace::Recorded(), 8u);
+    EXPECT_EQ(trace::Dropped(), 4u);
+    ASSERT_TRUE(trace::Stop());
+    EXPECT_FALSE(trace::Stop());
+
+    // The last 4 events are the end of the second inner scope, the third
+    // inner scope and the end of the outer scope. Both unmatched ends are
+    // left out
+    std::ifstream     in(path);
+    std::stringstream json;
+    json << in.rdbuf();
+    const std::string text = json.str();
+    EXPECT_EQ(text.rfind("{\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(text.find("Outer"), std::string::npos);
+    EXPECT_NE(text.find("\"args\":{\"n\":2}"), std::string::npos);
+    EXPECT_EQ(text.find("\"args\":{\"n\":0}"), std::string::npos);
+    std::filesystem::remove(path);
+}
+
+TEST(JsonWriter__Test, NestedValuesAndEscaping) {
+    std::ostringstream out;
+    JsonWriter         json(out);
+    json.BeginObject();
+    json.Key("name").Value("a \"quoted\"\\path\n");
+    json.Key("ok").Value(true);
+    json.Key("count").Value(3u);
+    json.Key("list").Strings(std::vector<std::string>{"x", "y"});
+    json.Key("empty").BeginArray().EndArray();
+    json.Key("raw").Raw("{\"a\":null}");
+    json.EndObject();
+    EXPECT_EQ(out.str(), "{\"name\":\"a \\\"quoted\\\"\\\\path\\n\","
+                         "\"ok\":true,\"count\":3,\"list\":[\"x\",\"y\"],"
+                         "\"empty\":[],\"raw\":{\"a\":null}}");
+}
+
+TEST(SLR1__Test, ParallelCollectionMatchesSequential) {
+    GrammarFactory::Params params;
+    params.non_terminals = 64;
+    params.terminals     = 16;
+    params.rules         = 192;
+    const Grammar gr     = GrammarFactory().Generate(params);
+
+    SLR1Parser sequential(gr);
+    SLR1Parser parallel(gr);
+    parallel.threads_ = 4;
+    EXPECT_EQ(sequential.MakeParser(), parallel.MakeParser());
+    ASSERT_GT(sequential.states_.size(), 100u);
+    ASSERT_EQ(sequential.states_.size(), parallel.states_.size());
+    // Same item sets with the same ids
+    for (const state& st : sequential.states_) {
+        auto it = parallel.states_.find(st);
+        ASSERT_NE(it, parallel.states_.end());
+        EXPECT_EQ(it->id_, st.id_);
+    }
+    EXPECT_EQ(sequential.transitions_, parallel.transitions_);
+}
+
+TEST(SLR1__Test, AllConflictsAreReported) {
+    Grammar g;
+    g.st_.PutSymbol("S");
+    g.st_.PutSymbol("E");
+    g.st_.PutSymbol("+", "+");
+    g.st_.PutSymbol("*", "*");
+    g.st_.PutSymbol("n", "n");
+    g.axiom_ = "S";
+    g.AddProduction("S", {"E", g.st_.EOL_});
+    g.AddProduction("E", {"E", "+", "E"});
+    g.AddProduction("E", {"E", "*", "E"});
+    g.AddProduction("E", {"n"});
+
+    SLR1Parser slr1(g);
+    EXPECT_FALSE(slr1.MakeParser());
+    // After E + E and after E * E, on both operators
+    ASSERT_EQ(slr1.ConflictCount(), 4u);
+    std::multiset<std::string> symbols;
+    for (const SLR1Parser::Conflict& c : slr1.Conflicts()) {
+        EXPECT_EQ(c.kind, SLR1Parser::Conflict::Kind::ShiftReduce);
+        EXPECT_EQ(c.items.size(), 2u);
+        symbols.insert(c.symbol);
+    }
+    EXPECT_EQ(symbols, (std::multiset<std::string>{"*", "*", "+", "+"}));
+
+    // Rows built in parallel give the same conflicts
+    GrammarFactory::Params params;
+    params.non_terminals = 64;
+    params.terminals     = 8;
+    params.rules         = 192;
+    const Grammar gr     = GrammarFactory().Generate(params);
+    SLR1Parser    sequential(gr);
+    SLR1Parser    parallel(gr);
+    parallel.threads_ = 4;
+    EXPECT_FALSE(sequential.MakeParser());
+    EXPECT_FALSE(parallel.MakeParser());
+    const std::vector<SLR1Parser::Conflict> expected = sequential.Conflicts();
+    const std::vector<SLR1Parser::Conflict> found    = parallel.Conflicts();
+    ASSERT_GT(expected.size(), 1u);
+    ASSERT_EQ(expected.size(), found.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const SLR1Parser::Conflict& a = expected[i];
+        const SLR1Parser::Conflict& b = found[i];
+        EXPECT_EQ(a.state, b.state);
+        EXPECT_EQ(a.symbol, b.symbol);
+        EXPECT_EQ(a.kind, b.kind);
+        EXPECT_EQ(a.items, b.items);
+    }
+}
+
+TEST(SLR1__Test, PrecedenceSolvesShiftReduceConflicts) {
+    Grammar g;
+    g.st_.PutSymbol("S");
+    g.st_.PutSymbol("E");
+    g.st_.PutSymbol("+", "+");
+    g.st_.PutSymbol("*", "*");
+    g.st_.PutSymbol("^", "^");
+    g.st_.PutSymbol("<", "<");
+    g.st_.PutSymbol("n", "n");
+    g.axiom_ = "S";
+    g.AddProduction("S", {"E", g.st_.EOL_});
+    for (const char* op : {"+", "*", "^", "<"}) {
+        g.AddProduction("E", {"E", op, "E"});
+    }
+    g.AddProduction("E", {"n"});
+    using Associativity = Precedence::Associativity;
+    g.precedence_       = {{"<", {1, Associativity::NonAssoc}},
+                           {"+", {2, Associativity::Left}},
+                           {"*", {3, Associativity::Left}},
+                           {"^", {4, Associativity::Right}}};
+
+    SLR1Parser slr1(g);
+    ASSERT_TRUE(slr1.MakeParser());
+    EXPECT_TRUE(slr1.conflicts_.empty());
+
+    // In the state of E -> E op E., a terminal that binds tighter shifts
+    auto after = [&](const std::string& op) {
+        for (const state& st : slr1.states_) {
+            for (const Lr0Item& item : st.items_) {
+                if (item.IsComplete() && item.consequent_.size() == 3 &&
+                    item.consequent_[1] == op) {
+                    return slr1.actions_[st.id_];
+                }
+            }
+        }
+        return SLR1Parser::action_table::mapped_type{};
+    };
+    using Action = SLR1Parser::Action;
+    EXPECT_EQ(after("+").at("+").action, Action::Reduce);
+    EXPECT_EQ(after("+").at("*").action, Action::Shift);
+    EXPECT_EQ(after("*").at("+").action, Action::Reduce);
+    EXPECT_EQ(after("^").at("^").action, Action::Shift);
+    EXPECT_EQ(after("<").at("<").action, Action::Empty);
+
+    const SymbolIndex& index = slr1.index_;
+    EXPECT_TRUE(slr1.table_.Parse(
+        Tokens(index, {"n", "+", "n", "*", "n", "^", "n", "<", "n"})));
+    EXPECT_FALSE(slr1.table_.Parse(Tokens(index, {"n", "<", "n", "<", "n"})));
+
+    // Without precedence on a rule or terminal the conflict stays: after
+    // E ^ E on every operator, and on ^ after the three other rules
+    g.precedence_.erase("^");
+    SLR1Parser partial(g);
+    EXPECT_FALSE(partial.MakeParser());
+    EXPECT_EQ(partial.ConflictCount(), 7u);
+}
+
+TEST(Counterexample__Test, UnifyingAndNonUnifying) {
+    Grammar g;
+    g.st_.PutSymbol("S");
+    g.st_.PutSymbol("E");
+    g.st_.PutSymbol("+", "+");
+    g.st_.PutSymbol("*", "*");
+    g.st_.PutSymbol("n", "n");
+    g.axiom_ = "S";
+    g.AddProduction("S", {"E", g.st_.EOL_});
+    g.AddProduction("E", {"E", "+", "E"});
+    g.AddProduction("E", {"E", "*", "E"});
+    g.AddProduction("E", {"n"});
+    const std::string& eol = g.st_.EOL_;
+
+    // Every conflict of an ambiguous grammar has a unifying example
+    SLR1Parser slr1(g);
+    EXPECT_FALSE(slr1.MakeParser());
+    ASSERT_EQ(slr1.ConflictCount(), 4);
+    counterexample::Finder slr1_finder(slr1.gr_, slr1.first_sets_,
+                                       std::chrono::seconds(10));
+    for (const SLR1Parser::Conflict& c : slr1.Conflicts()) {
+        const counterexample::Example example = slr1_finder.Find(slr1, c);
+        EXPECT_TRUE(example.unifying);
+        EXPECT_FALSE(example.follow_only);
+        EXPECT_EQ(example.first.ToString(eol).size(),
+                  std::string("E + E • + E").size());
+    }
+    const counterexample::Example plus =
+        slr1_finder.Find(slr1, slr1.Conflicts().front());
+    const std::vector<std::string> sentence{
+        "n", plus.first.before[1], "n", counterexample::kDot,
+        plus.first.after[0], "n"};
+    EXPECT_EQ(plus.sentence, sentence);
+
+    LL1Parser ll1(g);
+    EXPECT_FALSE(ll1.CreateLL1Table());
+    const std::vector<production>& cell = ll1.ll1_t_.at("E").at("n");
+    ASSERT_EQ(cell.size(), 3);
+    counterexample::Finder ll1_finder(ll1.gr_, ll1.first_sets_,
+                                      std::chrono::seconds(10));
+    EXPECT_TRUE(ll1_finder.Find("E", "n", cell[0], cell[1]).unifying);
+
+    // S -> L = R | R is LALR(1) but not SLR(1): = is in FOLLOW(R), but a
+    // reduction to R never comes before it
+    Grammar lr;
+    for (const char* nt : {"S", "P", "L", "R"}) {
+        lr.st_.PutSymbol(nt);
+    }
+    for (const char* t : {"=", "*", "id"}) {
+        lr.st_.PutSymbol(t, t);
+    }
+    lr.axiom_ = "S";
+    lr.AddProduction("S", {"P", lr.st_.EOL_});
+    lr.AddProduction("P", {"L", "=", "R"});
+    lr.AddProduction("P", {"R"});
+    lr.AddProduction("L", {"*", "R"});
+    lr.AddProduction("L", {"id"});
+    lr.AddProduction("R", {"L"});
+    SLR1Parser lr_slr1(lr);
+    EXPECT_FALSE(lr_slr1.MakeParser());
+    ASSERT_EQ(lr_slr1.ConflictCount(), 1);
+    counterexample::Finder lr_finder(lr_slr1.gr_, lr_slr1.first_sets_,
+                                     std::chrono::seconds(10));
+    const counterexample::Example example =
+        lr_finder.Find(lr_slr1, lr_slr1.Conflicts()[0]);
+    EXPECT_FALSE(example.unifying);
+    EXPECT_TRUE(example.follow_only);
+    EXPECT_EQ(example.first.ToString(eol), "L • = R");
+    EXPECT_EQ(example.second.ToString(eol), "L •");
+    EXPECT_EQ(example.sentence,
+              (std::vector<std::string>{"id", counterexample::kDot, "=",
+                                        "id"}));
+
+    // Without a budget the searches stop at once: the forms are what is left
+    // of the items, and nothing is claimed about FOLLOW
+    counterexample::Finder expired(lr_slr1.gr_, lr_slr1.first_sets_,
+                                   std::chrono::milliseconds(0));
+    const counterexample::Example partial =
+        expired.Find(lr_slr1, lr_slr1.Conflicts()[0]);
+    EXPECT_FALSE(partial.unifying);
+    EXPECT_TRUE(partial.bounded);
+    EXPECT_FALSE(partial.follow_only);
+    EXPECT_EQ(partial.first.ToString(eol), "• = R");
+    EXPECT_EQ(partial.second.ToString(eol), "•");
+}
+
+TEST(Stats__Test, ParallelPhasesCountWorkerAllocations) {
+    GrammarFactory::Params params;
+    params.non_terminals = 64;
+    params.terminals     = 16;
+    params.rules         = 192;
+    const Grammar gr     = GrammarFactory().Generate(params);
+
+    // Allocations of the canonical collection built on `threads` threads
+    auto collection = [&](unsigned threads) {
+        stats::Reset();
+        SLR1Parser slr1(gr);
+        slr1.threads_ = threads;
+        slr1.MakeParser();
+        const stats::Counters& c = stats::Get(stats::Phase::Collection);
+        EXPECT_EQ(c.calls, 1);
+        EXPECT_EQ(c.iterations, slr1.states_.size());
+        EXPECT_GT(c.bytes, 0);
+        return c.allocations.load();
+    };
+    stats::enabled                 = true;
+    stats::heap_enabled            = true;
+    const std::uint64_t sequential = collection(1);
+    const std::uint64_t parallel   = collection(4);
+    stats::enabled                 = false;
+    stats::heap_enabled            = false;
+    stats::Reset();
+
+    // Nothing is counted while the heap counters are off
+    const std::uint64_t before = stats::HeapAllocations();
+    auto                block  = std::make_unique<std::vector<int>>(64);
+    EXPECT_EQ(stats::HeapAllocations(), before);
+
+    // The states are closed on the workers, and their allocations are part
+    // of the phase
+    EXPECT_GT(sequential, 0);
+    EXPECT_GT(parallel, sequential / 2);
+}
+
+// Checks that `edited` has the automaton of `full` up to the numbering of
+// its states: the same item sets, transitions, action rows and conflicts,
+// and flat tables with the same actions and gotos.
+void ExpectSameAutomaton(const SLR1Parser& full, const SLR1Parser& edited) {
+    ASSERT_EQ(full.states_.size(), edited.states_.size());
+    std::vector<unsigned> ids(full.states_.size());
+    for (const state& st : full.states_) {
+        auto it = edited.states_.find(st);
+        ASSERT_NE(it, edited.states_.end());
+        ids[st.id_] = it->id_;
+    }
+
+    EXPECT_EQ(full.transitions_.size(), edited.transitions_.size());
+    for (const auto& [from, row] : full.transitions_) {
+        auto it = edited.transitions_.find(ids[from]);
+        ASSERT_NE(it, edited.transitions_.end());
+        ASSERT_EQ(row.size(), it->second.size());
+        for (const auto& [symbol, to] : row) {
+            EXPECT_EQ(it->second.at(symbol), ids[to]) << from << symbol;
+        }
+    }
+
+    EXPECT_EQ(full.actions_.size(), edited.actions_.size());
+    for (const auto& [st, row] : full.actions_) {
+        auto it = edited.actions_.find(ids[st]);
+        ASSERT_NE(it, edited.actions_.end());
+        ASSERT_EQ(row.size(), it->second.size());
+        for (const auto& [symbol, action] : row) {
+            const SLR1Parser::s_action& other = it->second.at(symbol);
+            EXPECT_EQ(action.action, other.action) << st << symbol;
+            if (action.item != nullptr && other.item != nullptr) {
+                EXPECT_EQ(*action.item, *other.item) << st << symbol;
+            }
+        }
+    }
+
+    ASSERT_EQ(full.ConflictCount(), edited.ConflictCount());
+    const std::vector<SLR1Parser::Conflict> found = edited.Conflicts();
+    std::map<std::pair<unsigned, std::string>, const SLR1Parser::Conflict*>
+        conflicts;
+    for (const SLR1Parser::Conflict& conflict : found) {
+        conflicts[{conflict.state, conflict.symbol}] = &conflict;
+    }
+    for (const SLR1Parser::Conflict& conflict : full.Conflicts()) {
+        auto it = conflicts.find({ids[conflict.state], conflict.symbol});
+        ASSERT_NE(it, conflicts.end());
+        EXPECT_EQ(conflict.kind, it->second->kind);
+        EXPECT_EQ(conflict.items, it->second->items);
+    }
+
+    const LRTable& a = full.table_;
+    const LRTable& b = edited.table_;
+    ASSERT_EQ(a.n_states_, b.n_states_);
+    if (a.n_states_ == 0) {
+        return;
+    }
+    ASSERT_EQ(full.index_.terminals_, edited.index_.terminals_);
+    ASSERT_EQ(full.index_.non_terminals_, edited.index_.non_terminals_);
+    // Shifts go to the same state, and reductions are by the same rule
+    auto same = [&](int x, int y) {
+        if (LRTable::IsShift(x)) {
+            return LRTable::IsShift(y) &&
+                   ids[LRTable::Target(x)] == LRTable::Target(y);
+        }
+        if (LRTable::IsReduce(x)) {
+            return LRTable::IsReduce(y) &&
+                   a.rule_lhs_[LRTable::Rule(x)] ==
+                       b.rule_lhs_[LRTable::Rule(y)] &&
+                   full.index_.consequents_[LRTable::Rule(x)] ==
+                       edited.index_.consequents_[LRTable::Rule(y)];
+        }
+        return x == y;
+    };
+    for (unsigned st = 0; st < a.n_states_; ++st) {
+        for (unsigned t = 0; t < a.n_terminals_; ++t) {
+            EXPECT_TRUE(same(a.DenseAction(st, t), b.DenseAction(ids[st], t)));
+            EXPECT_TRUE(same(a.Action(st, t), b.Action(ids[st], t)));
+            EXPECT_TRUE(
+                same(a.ClassAction(st, t), b.ClassAction(ids[st], t)));
+        }
+        for (unsigned nt = 0; nt < a.n_non_terminals_; ++nt) {
+            const int x = a.Goto(st, nt);
+            const int y = b.Goto(ids[st], nt);
+            EXPECT_EQ(x < 0 ? -1 : static_cast<int>(ids[x]), y);
+            EXPECT_EQ(a.ClassGoto(st, nt) < 0 ? -1
+                                              : static_cast<int>(
+                                                    ids[a.ClassGoto(st, nt)]),
+                      b.ClassGoto(ids[st], nt));
+        }
+    }
+}
+
+TEST(Incremental__Test, EditsMatchFullRebuild) {
+    GrammarFactory::Params params;
+    params.non_terminals  = 48;
+    params.terminals      = 8;
+    params.rules          = 120;
+    params.nullable_ratio = 0.2;
+    Grammar gr            = GrammarFactory().Generate(params);
+
+    LL1Parser ll1(gr);
+    ll1.CreateLL1Table();
+    SLR1Parser slr1(gr);
+    slr1.MakeParser();
+
+    std::mt19937 rng(3);
+    std::vector<std::string> non_terminals;
+    std::vector<std::string> symbols;
+    for (const auto& [nt, productions] : gr.g_) {
+        if (nt != gr.axiom_) {
+            non_terminals.push_back(nt);
+        }
+    }
+    std::sort(non_terminals.begin(), non_terminals.end());
+    symbols = non_terminals;
+    for (const std::string& t : gr.st_.terminals_) {
+        if (t != gr.st_.EOL_ && t != gr.st_.EPSILON_) {
+            symbols.push_back(t);
+        }
+    }
+    std::sort(symbols.begin(), symbols.end());
+
+    for (int edit = 0; edit < 40; ++edit) {
+        const std::string& nt =
+            non_terminals[rng() % non_terminals.size()];
+        production prod;
+        bool       added = rng() % 2 == 0;
+        if (added) {
+            for (unsigned i = rng() % 4; i > 0; --i) {
+                prod.push_back(symbols[rng() % symbols.size()]);
+            }
+            if (prod.empty()) {
+                prod.push_back(gr.st_.EPSILON_);
+            }
+            added = gr.InsertRule(nt, prod);
+            EXPECT_EQ(ll1.AddRule(nt, prod), added);
+            EXPECT_EQ(slr1.AddRule(nt, prod), added);
+        } else {
+            const std::vector<production>& rules = gr.g_.at(nt);
+            prod = rules[rng() % rules.size()];
+            added = gr.RemoveRule(nt, prod);
+            EXPECT_EQ(ll1.RemoveRule(nt, prod), added);
+            EXPECT_EQ(slr1.RemoveRule(nt, prod), added);
+        }
+
+        LL1Parser full_ll1(gr);
+        EXPECT_EQ(full_ll1.CreateLL1Table(), ll1.IsLL1());
+        for (const auto& [a, productions] : gr.g_) {
+            EXPECT_EQ(ll1.first_sets_.at(a), full_ll1.first_sets_.at(a)) << a;
+            EXPECT_EQ(ll1.follow_sets_.at(a), full_ll1.follow_sets_.at(a))
+                << a;
+            EXPECT_EQ(ll1.ll1_t_.at(a), full_ll1.ll1_t_.at(a)) << a;
+        }
+        EXPECT_EQ(ll1.ll1_t_.size(), full_ll1.ll1_t_.size());
+
+        SLR1Parser full_slr1(gr);
+        EXPECT_EQ(full_slr1.MakeParser(), slr1.conflicts_.empty());
+        ExpectSameAutomaton(full_slr1, slr1);
+    }
+}
+
+TEST(Incremental__Test, EditKeepsUntouchedStates) {
+    SLR1Parser slr1(ExpressionGrammar());
+    ASSERT_TRUE(slr1.MakeParser());
+
+    // The states without items of T cannot change. T is the last
+    // non-terminal, so a rule added to it does not move the other rule ids
+    struct Row {
+        const state*                    st;
+        std::unordered_set<Lr0Item>     items;
+        std::map<std::string, unsigned> transitions;
+        std::vector<std::string>        actions;
+        std::vector<int>                flat;
+    };
+    auto describe = [&](unsigned id) {
+        std::vector<std::string> actions;
+        if (auto row = slr1.actions_.find(id); row != slr1.actions_.end()) {
+            for (const auto& [symbol, action] : row->second) {
+                actions.push_back(
+                    symbol + std::to_string(static_cast<int>(action.action)) +
+                    (action.item ? action.item->ToString() : ""));
+            }
+        }
+        return actions;
+    };
+    auto transitions = [&](unsigned id) {
+        auto row = slr1.transitions_.find(id);
+        return row == slr1.transitions_.end()
+                   ? std::map<std::string, unsigned>{}
+                   : row->second;
+    };
+    auto flat = [&](unsigned id) {
+        const LRTable&   table = slr1.table_;
+        std::vector<int> cells;
+        for (unsigned t = 0; t < table.n_terminals_; ++t) {
+            cells.push_back(table.DenseAction(id, t));
+            cells.push_back(table.Action(id, t));
+        }
+        for (unsigned nt = 0; nt < table.n_non_terminals_; ++nt) {
+            cells.push_back(table.DenseGoto(id, nt));
+            cells.push_back(table.Goto(id, nt));
+        }
+        return cells;
+    };
+    std::map<unsigned, Row> untouched;
+    for (const state& st : slr1.states_) {
+        if (std::none_of(st.items_.begin(), st.items_.end(),
+                         [](const Lr0Item& item) {
+                             return item.antecedent_ == "T";
+                         })) {
+            untouched[st.id_] = {&st, st.items_, transitions(st.id_),
+                                 describe(st.id_), flat(st.id_)};
+        }
+    }
+    ASSERT_FALSE(untouched.empty());
+
+    ASSERT_TRUE(slr1.AddRule("T", {"n", "ap", "E", "cp"}));
+    for (const auto& [id, row] : untouched) {
+        auto it = slr1.states_.find({row.items, 0});
+        ASSERT_NE(it, slr1.states_.end());
+        EXPECT_EQ(it->id_, id);
+        // The node itself was kept, so its items were not built again
+        EXPECT_EQ(&*it, row.st);
+        EXPECT_EQ(transitions(id), row.transitions);
+        EXPECT_EQ(describe(id), row.actions);
+        EXPECT_EQ(flat(id), row.flat);
+    }
+
+    Grammar edited = ExpressionGrammar();
+    ASSERT_TRUE(edited.InsertRule("T", {"n", "ap", "E", "cp"}));
+    SLR1Parser full(edited);
+    ASSERT_TRUE(full.MakeParser());
+    ExpectSameAutomaton(full, slr1);
+    EXPECT_TRUE(slr1.table_.Parse(
+        Tokens(slr1.index_, {"n", "ap", "n", "cp", "plus", "n"})));
+
+    ASSERT_TRUE(slr1.RemoveRule("T", {"n", "ap", "E", "cp"}));
+    SLR1Parser original(ExpressionGrammar());
+    ASSERT_TRUE(original.MakeParser());
+    ExpectSameAutomaton(original, slr1);
+    EXPECT_FALSE(slr1.table_.Parse(
+        Tokens(slr1.index_, {"n", "ap", "n", "cp", "plus", "n"})));
+}
+
+TEST(Incremental__Test, EditsPatchTheFlatTables) {
+    // Rules of a keyed grammar start with their own terminal, so it stays
+    // SLR(1) when rules are removed and added back, and every edit patches
+    // the flat tables, dropping states and moving rule ids
+    GrammarFactory::Params params;
+    params.non_terminals = 32;
+    params.terminals     = 8;
+    params.rules         = 96;
+    params.keyed         = true;
+    Grammar    gr        = GrammarFactory().Generate(params);
+    SLR1Parser slr1(gr);
+    ASSERT_TRUE(slr1.MakeParser());
+
+    std::mt19937                                    rng(5);
+    std::vector<std::pair<std::string, production>> removed;
+    for (int edit = 0; edit < 30; ++edit) {
+        if (removed.empty() || rng() % 3 != 0) {
+            auto rules = std::next(gr.g_.begin(), rng() % gr.g_.size());
+            if (rules->first == gr.axiom_) {
+                continue;
+            }
+            const production prod =
+                rules->second[rng() % rules->second.size()];
+            const bool done = gr.RemoveRule(rules->first, prod);
+            EXPECT_EQ(slr1.RemoveRule(rules->first, prod), done);
+            if (done) {
+                removed.emplace_back(rules->first, prod);
+            }
+        } else {
+            auto [nt, prod] = removed.back();
+            removed.pop_back();
+            ASSERT_TRUE(gr.InsertRule(nt, prod));
+            ASSERT_TRUE(slr1.AddRule(nt, prod));
+        }
+        ASSERT_TRUE(slr1.conflicts_.empty());
+        SLR1Parser full(gr);
+        ASSERT_TRUE(full.MakeParser());
+        ExpectSameAutomaton(full, slr1);
+    }
+}
+
+TEST(Incremental__Test, EditsToReachesTheOtherGrammar) {
+    GrammarFactory::Params params;
+    params.non_terminals  = 24;
+    params.terminals      = 6;
+    params.rules          = 60;
+    params.nullable_ratio = 0.2;
+    const Grammar base    = GrammarFactory().Generate(params);
+
+    // A saved file: a rule replaced, a new non-terminal used by an old one,
+    // and a non-terminal that is no longer used nor defined
+    Grammar next = base;
+    ASSERT_TRUE(next.InsertRule("N1", {"t0", "t1"}));
+    ASSERT_TRUE(next.RemoveRule("N1", next.g_.at("N1").front()));
+    ASSERT_TRUE(next.InsertRule("Fresh", {"t2", "N3"}));
+    ASSERT_TRUE(next.InsertRule("N2", {"Fresh", "t3"}));
+    for (const auto& [nt, productions] : base.g_) {
+        for (const production& prod : productions) {
+            if (nt != base.axiom_ && nt != "N5" &&
+                std::find(prod.begin(), prod.end(), "N5") != prod.end()) {
+                next.RemoveRule(nt, prod);
+            }
+        }
+    }
+    while (next.g_.contains("N5") &&
+           next.RemoveRule("N5", next.g_.at("N5").front())) {
+    }
+
+    std::vector<RuleEdit> edits;
+    ASSERT_TRUE(base.EditsTo(next, edits));
+    Grammar edited = base;
+    for (const RuleEdit& edit : edits) {
+        ASSERT_TRUE(edited.Apply(edit));
+    }
+    SortProductions(edited);
+    Grammar sorted = next;
+    SortProductions(sorted);
+    EXPECT_EQ(edited.g_, sorted.g_);
+
+    LL1Parser ll1(base);
+    ll1.CreateLL1Table();
+    EXPECT_TRUE(ll1.EditRules(edits));
+    LL1Parser full_ll1(next);
+    EXPECT_EQ(full_ll1.CreateLL1Table(), ll1.IsLL1());
+    EXPECT_EQ(ll1.first_sets_, full_ll1.first_sets_);
+    EXPECT_EQ(ll1.follow_sets_, full_ll1.follow_sets_);
+    EXPECT_EQ(ll1.ll1_t_, full_ll1.ll1_t_);
+
+    SLR1Parser slr1(base);
+    slr1.MakeParser();
+    EXPECT_TRUE(slr1.EditRules(edits));
+    SLR1Parser full_slr1(next);
+    EXPECT_EQ(full_slr1.MakeParser(), slr1.conflicts_.empty());
+    ExpectSameAutomaton(full_slr1, slr1);
+
+    // A new terminal cannot be reached by editing rules
+    next.st_.PutSymbol("t99", "z");
+    EXPECT_FALSE(base.EditsTo(next, edits));
+}
+
+TEST(FirstFollow__Test, ParallelMatchesSequential) {
+    // Large recursion depths and many nullable symbols give big cycles
+    // through nullable prefixes and suffixes
+    std::vector<Grammar> grammars;
+    for (unsigned n : {8u, 64u, 512u}) {
+        for (std::uint32_t seed : {1u, 2u, 3u}) {
+            GrammarFactory::Params params;
+            params.non_terminals   = n;
+            params.terminals       = 4 + n / 8;
+            params.rules           = 3 * n;
+            params.nullable_ratio  = 0.1 * seed;
+            params.recursion_depth = 2 + n / 16;
+            params.seed            = seed;
+            grammars.push_back(GrammarFactory().Generate(params));
+        }
+    }
+    for (const Grammar& gr : grammars) {
+        const SLR1Parser         sequential(gr);
+        const first_follow::Sets sets = first_follow::Compute(gr, 4);
+        ASSERT_EQ(sets.first.size(), gr.g_.size());
+        ASSERT_EQ(sets.follow.size(), gr.g_.size());
+        for (const auto& [nt, productions] : gr.g_) {
+            EXPECT_EQ(sets.first.at(nt), sequential.first_sets_.at(nt)) << nt;
+            EXPECT_EQ(sets.follow.at(nt), sequential.follow_sets_.at(nt))
+                << nt;
+        }
+    }
+}
+
+TEST(Arena__Test, ScopesNestAndRestore) {
+    std::pmr::memory_resource* heap = arena::Current();
+    EXPECT_EQ(heap, std::pmr::get_default_resource());
+    arena::Arena outer;
+    {
+        const arena::Scope outer_scope(outer);
+        EXPECT_EQ(arena::Current(), outer.Resource());
+        std::pmr::vector<int> values(arena::Current());
+        for (int i = 0; i < 1000; ++i) {
+            values.push_back(i);
+        }
+        EXPECT_EQ(values.get_allocator().resource(), outer.Resource());
+        {
+            arena::Arena       inner;
+            const arena::Scope inner_scope(inner);
+            EXPECT_EQ(arena::Current(), inner.Resource());
+        }
+        EXPECT_EQ(arena::Current(), outer.Resource());
+        // Other threads keep their own arena
+        std::thread([] {
+            EXPECT_EQ(arena::Current(), std::pmr::get_default_resource());
+        }).join();
+    }
+    EXPECT_EQ(arena::Current(), heap);
+}
+
+TEST(ThreadPool__Test, NestedTasksAndExceptions) {
+    ThreadPool       pool(4);
+    std::atomic<int> sum{0};
+    for (int i = 0; i < 100; ++i) {
+        pool.Submit([&pool, &sum, i] {
+            // Tasks submitted by a worker go to its own deque and can be
+            // stolen by the others
+            for (int j = 0; j < 10; ++j) {
+                pool.Submit([&sum, i] { sum += i; });
+            }
+        });
+    }
+    pool.Wait();
+    EXPECT_EQ(sum, 10 * (99 * 100 / 2));
+
+    pool.Submit([] { throw std::runtime_error("task failed"); });
+    EXPECT_THROW(pool.Wait(), std::runtime_error);
+    pool.Submit([&sum] { sum = 0; });
+    EXPECT_NO_THROW(pool.Wait());
+    EXPECT_EQ(sum, 0);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();